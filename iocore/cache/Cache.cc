@@ -80,6 +80,8 @@ int cache_config_enable_checksum = 0;
 int cache_config_alt_rewrite_max_size = 4096;
 int cache_config_read_while_writer = 0;
 int cache_config_mutex_retry_delay = 2;
+int cache_config_agg_write_buffers = 1;
+int cache_config_agg_write_high_water = AGG_HIGH_WATER;
 #ifdef HTTP_CACHE
 static int enable_cache_empty_http_doc = 0;
 /// Fix up a specific known problem with the 4.2.0 release.
@@ -747,6 +749,7 @@ CacheProcessor::start_internal(int flags)
 
         gdisks[gndisks] = new CacheDisk();
         gdisks[gndisks]->forced_volume_num = sd->forced_volume_num;
+        gdisks[gndisks]->agg_buffers = sd->agg_buffers;
         if (sd->hash_base_string)
           gdisks[gndisks]->hash_base_string = ats_strdup(sd->hash_base_string);
 
@@ -1288,6 +1291,8 @@ Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
   vol_init_data(this);
   data_blocks = (len - (start - skip)) / STORE_BLOCK_SIZE;
   hit_evacuate_window = (data_blocks * cache_config_hit_evacuate_percent) / 100;
+  agg_buffers_set(disk->agg_buffers > 0 ? disk->agg_buffers : cache_config_agg_write_buffers);
+  agg_high_water = cache_config_agg_write_high_water;
 
   evacuate_size = (int)(len / EVACUATION_BUCKET_SIZE) + 2;
   int evac_len = (int)evacuate_size * sizeof(DLL<EvacuationBlock>);
@@ -2374,7 +2379,7 @@ static void
 unmarshal_helper(Doc *doc, Ptr<IOBufferData> &buf, int &okay)
 {
   char *tmp = doc->hdr();
-  int len = doc->hlen;
+  int len = CacheHTTPInfoVector::alternates_length(tmp, doc->hlen, doc->flags & DOC_FLAG_VARY_INDEX);
   while (len > 0) {
     int r = HTTPInfo::unmarshal(tmp, len, buf._ptr());
     if (r < 0) {
@@ -2466,7 +2471,7 @@ upgrade_doc_version(Ptr<IOBufferData> &buf)
       // put in the aggregation buffer.
       n_doc->v_major = 0;
       n_doc->v_minor = 0;
-      n_doc->unused = 0; // force to zero to make future use easier.
+      n_doc->flags = 0;
     }
   }
   return zret;
@@ -2709,6 +2714,14 @@ CacheVC::handleRead(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
     buf = vol->first_fragment_data;
     goto LmemHit;
   }
+  // check if the writer we are following still has it
+  if (f.read_from_writer_called) {
+    OpenDirEntry *wod = vol->open_read(&first_key);
+    if (wod && (buf = wod->fragment_get(read_key, o))) {
+      CACHE_INCREMENT_DYN_STAT(cache_read_writer_fragment_hits_stat);
+      goto LmemHit;
+    }
+  }
 #if TS_USE_INTERIM_CACHE == 1
 LinterimRead:
   if (f.read_from_interim) {
@@ -2743,9 +2756,9 @@ LinterimRead:
   if (dir_agg_buf_valid(vol, &dir)) {
     int agg_offset = vol_offset(vol, &dir) - vol->header->write_pos;
     buf = new_IOBufferData(iobuffer_size_to_index(io.aiocb.aio_nbytes, MAX_BUFFER_SIZE_INDEX), MEMALIGNED);
-    ink_assert((agg_offset + io.aiocb.aio_nbytes) <= (unsigned)vol->agg_buf_pos);
+    ink_assert((agg_offset + io.aiocb.aio_nbytes) <= (unsigned)vol->agg_pending_len());
     char *doc = buf->data();
-    char *agg = vol->agg_buffer + agg_offset;
+    char *agg = vol->agg_buffer_at(vol_offset(vol, &dir));
     memcpy(doc, agg, io.aiocb.aio_nbytes);
     io.aio_result = io.aiocb.aio_nbytes;
     SET_HANDLER(&CacheVC::handleReadDone);
@@ -3472,6 +3485,7 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("frags_per_doc.3+", cache_three_plus_plus_fragment_document_count_stat);
   REG_INT("read_busy.success", cache_read_busy_success_stat);
   REG_INT("read_busy.failure", cache_read_busy_failure_stat);
+  REG_INT("read_busy.fragment_hits", cache_read_writer_fragment_hits_stat);
   REG_INT("write_bytes_stat", cache_write_bytes_stat);
   REG_INT("vector_marshals", cache_hdr_vector_marshal_stat);
   REG_INT("hdr_marshals", cache_hdr_marshal_stat);
@@ -3482,6 +3496,9 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("sync.count", cache_directory_sync_count_stat);
   REG_INT("sync.bytes", cache_directory_sync_bytes_stat);
   REG_INT("sync.time", cache_directory_sync_time_stat);
+  REG_INT("agg_write.queue_time", cache_agg_write_queue_time_stat);
+  REG_INT("agg_write.flush_count", cache_agg_write_flush_count_stat);
+  REG_INT("agg_write.flush_time", cache_agg_write_flush_time_stat);
 }
 
 
@@ -3553,6 +3570,14 @@ ink_cache_init(ModuleVersion v)
   REC_EstablishStaticConfigInt32(cache_config_agg_write_backlog, "proxy.config.cache.agg_write_backlog");
   Debug("cache_init", "proxy.config.cache.agg_write_backlog = %d", cache_config_agg_write_backlog);
 
+  REC_ReadConfigInt32(cache_config_agg_write_buffers, "proxy.config.cache.agg_write_buffers");
+  Debug("cache_init", "proxy.config.cache.agg_write_buffers = %d", cache_config_agg_write_buffers);
+
+  REC_ReadConfigInt32(cache_config_agg_write_high_water, "proxy.config.cache.agg_write_high_water");
+  if (cache_config_agg_write_high_water <= 0 || cache_config_agg_write_high_water > AGG_SIZE)
+    cache_config_agg_write_high_water = AGG_HIGH_WATER;
+  Debug("cache_init", "proxy.config.cache.agg_write_high_water = %d", cache_config_agg_write_high_water);
+
   REC_EstablishStaticConfigInt32(cache_config_enable_checksum, "proxy.config.cache.enable_checksum");
   Debug("cache_init", "proxy.config.cache.enable_checksum = %d", cache_config_enable_checksum);
 
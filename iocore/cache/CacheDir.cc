@@ -98,6 +98,8 @@ OpenDir::open_write(CacheVC *cont, int allow_if_writers, int max_writers)
   od->move_resident_alt = 0;
   od->reading_vec = 0;
   od->writing_vec = 0;
+  od->share_fragments = 0;
+  od->next_fragment = 0;
   dir_clear(&od->first_dir);
   cont->od = od;
   cont->write_vector = &od->vector;
@@ -143,6 +145,7 @@ OpenDir::close_write(CacheVC *cont)
     delayed_readers.append(cont->od->readers);
     signal_readers(0, 0);
     cont->od->vector.clear();
+    cont->od->fragments_clear();
     THREAD_FREE(cont->od, openDirEntryAllocator, cont->mutex->thread_holding);
   }
   cont->od = NULL;
@@ -171,6 +174,32 @@ OpenDirEntry::wait(CacheVC *cont, int msec)
   return EVENT_CONT;
 }
 
+IOBufferData *
+OpenDirEntry::fragment_get(CacheKey *key, int64_t offset)
+{
+  for (int i = 0; i < OPEN_DIR_FRAGMENTS; i++)
+    if (fragments[i].data && fragments[i].offset == offset && fragments[i].key == *key)
+      return fragments[i].data;
+  return NULL;
+}
+
+void
+OpenDirEntry::fragment_put(CacheKey *key, int64_t offset, IOBufferData *data)
+{
+  WriterFragment *f = &fragments[next_fragment];
+  f->key = *key;
+  f->offset = offset;
+  f->data = data;
+  next_fragment = (next_fragment + 1) % OPEN_DIR_FRAGMENTS;
+}
+
+void
+OpenDirEntry::fragments_clear()
+{
+  for (int i = 0; i < OPEN_DIR_FRAGMENTS; i++)
+    fragments[i].data = NULL;
+}
+
 //
 // Cache Directory
 //
@@ -1040,20 +1069,30 @@ sync_cache_dir_on_shutdown(void)
     // check if we have data in the agg buffer
     // dont worry about the cachevc s in the agg queue
     // directories have not been inserted for these writes
-    if (d->agg_buf_pos) {
+    if (d->agg_pending_len()) {
       Debug("cache_dir_sync", "Dir %s: flushing agg buffer first", d->hash_text.get());
 
       // set write limit
-      d->header->agg_pos = d->header->write_pos + d->agg_buf_pos;
+      d->header->agg_pos = d->header->write_pos + d->agg_pending_len();
 
-      int r = pwrite(d->fd, d->agg_buffer, d->agg_buf_pos, d->header->write_pos);
-      if (r != d->agg_buf_pos) {
-        ink_assert(!"flusing agg buffer failed");
-        continue;
+      if (d->agg_flush_len) {
+        int r = pwrite(d->fd, d->agg_flush_buffer, d->agg_flush_len, d->header->write_pos);
+        if (r != d->agg_flush_len) {
+          ink_assert(!"flusing agg buffer failed");
+          continue;
+        }
+      }
+      if (d->agg_buf_pos) {
+        int r = pwrite(d->fd, d->agg_buffer, d->agg_buf_pos, d->header->write_pos + d->agg_flush_len);
+        if (r != d->agg_buf_pos) {
+          ink_assert(!"flusing agg buffer failed");
+          continue;
+        }
       }
       d->header->last_write_pos = d->header->write_pos;
-      d->header->write_pos += d->agg_buf_pos;
+      d->header->write_pos += d->agg_pending_len();
       ink_assert(d->header->write_pos == d->header->agg_pos);
+      d->agg_flush_len = 0;
       d->agg_buf_pos = 0;
       d->header->write_serial++;
     }
@@ -34,6 +34,18 @@ static vec_info default_vec_info;
 #ifdef HTTP_CACHE
 static CacheHTTPInfo default_http_info;
 
+// The Vary index follows the marshalled alternates of a vector: one
+// digest per alternate, then a trailer giving the digest count. Whether a
+// vector has an index is recorded out of band (DOC_FLAG_VARY_INDEX), the
+// trailer is only used to size an index known to be there.
+#define CACHE_VARY_INDEX_MAGIC 0x56415259 // "VARY"
+#define CACHE_VARY_INDEX_SIZE(_n) ((int)(ROUND((_n) * sizeof(VaryDigest), HDR_PTR_SIZE) + sizeof(CacheVaryIndexTrailer)))
+
+struct CacheVaryIndexTrailer {
+  uint32_t count;
+  uint32_t magic;
+};
+
 CacheHTTPInfoVector::CacheHTTPInfoVector() : magic(NULL), data(&default_vec_info, 4), xcount(0)
 {
 }
@@ -62,6 +74,7 @@ CacheHTTPInfoVector::insert(CacheHTTPInfo *info, int index)
     index = xcount++;
 
   data(index).alternate.copy_shallow(info);
+  vary_digest_compute(index);
   return index;
 }
 
@@ -81,7 +94,7 @@ CacheHTTPInfoVector::detach(int idx, CacheHTTPInfo *r)
   data[idx].alternate.destroy();
 
   for (i = idx; i < (xcount - 1); i++) {
-    data[i] = data[i + i];
+    data[i] = data[i + 1];
   }
 
   xcount -= 1;
@@ -165,7 +178,7 @@ CacheHTTPInfoVector::print(char *buffer, size_t buf_size, bool temps)
   -------------------------------------------------------------------------*/
 
 int
-CacheHTTPInfoVector::marshal_length()
+CacheHTTPInfoVector::marshal_length(bool vary_index)
 {
   int length = 0;
 
@@ -173,13 +186,13 @@ CacheHTTPInfoVector::marshal_length()
     length += data[i].alternate.marshal_length();
   }
 
-  return length;
+  return vary_index ? length + vary_index_length() : length;
 }
 
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 int
-CacheHTTPInfoVector::marshal(char *buf, int length)
+CacheHTTPInfoVector::marshal(char *buf, int length, bool vary_index)
 {
   char *start = buf;
   int count = 0;
@@ -187,11 +200,11 @@ CacheHTTPInfoVector::marshal(char *buf, int length)
   ink_assert(!(((intptr_t)buf) & 3)); // buf must be aligned
 
   for (int i = 0; i < xcount; i++) {
-    int tmp = data[i].alternate.marshal(buf, length);
-    length -= tmp;
-    buf += tmp;
+    buf += data[i].alternate.marshal(buf, length - (buf - start));
     count++;
   }
+  if (vary_index)
+    buf += vary_index_marshal(buf, length - (buf - start));
 
   GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_hdr_vector_marshal_stat, 1);
   GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_hdr_marshal_stat, count);
@@ -200,16 +213,17 @@ CacheHTTPInfoVector::marshal(char *buf, int length)
 }
 
 int
-CacheHTTPInfoVector::unmarshal(const char *buf, int length, RefCountObj *block_ptr)
+CacheHTTPInfoVector::unmarshal(const char *buf, int length, bool vary_index, RefCountObj *block_ptr)
 {
   ink_assert(!(((intptr_t)buf) & 3)); // buf must be aligned
 
   const char *start = buf;
+  int alt_length = alternates_length(buf, length, vary_index);
   CacheHTTPInfo info;
   xcount = 0;
 
-  while (length - (buf - start) > (int)sizeof(HTTPCacheAlt)) {
-    int tmp = HTTPInfo::unmarshal((char *)buf, length - (buf - start), block_ptr);
+  while (alt_length - (buf - start) > 0) {
+    int tmp = HTTPInfo::unmarshal((char *)buf, alt_length - (buf - start), block_ptr);
     if (tmp < 0) {
       return -1;
     }
@@ -217,8 +231,11 @@ CacheHTTPInfoVector::unmarshal(const char *buf, int length, RefCountObj *block_p
     buf += tmp;
 
     data(xcount).alternate = info;
+    data(xcount).vary.flags = 0;
+    data(xcount).vary_known = false;
     xcount++;
   }
+  buf += vary_index_unmarshal(buf, length - (buf - start));
 
   return ((caddr_t)buf - (caddr_t)start);
 }
@@ -227,18 +244,19 @@ CacheHTTPInfoVector::unmarshal(const char *buf, int length, RefCountObj *block_p
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 uint32_t
-CacheHTTPInfoVector::get_handles(const char *buf, int length, RefCountObj *block_ptr)
+CacheHTTPInfoVector::get_handles(const char *buf, int length, bool vary_index, RefCountObj *block_ptr)
 {
   ink_assert(!(((intptr_t)buf) & 3)); // buf must be aligned
 
   const char *start = buf;
+  int alt_length = alternates_length(buf, length, vary_index);
   CacheHTTPInfo info;
   xcount = 0;
 
   vector_buf = block_ptr;
 
-  while (length - (buf - start) > (int)sizeof(HTTPCacheAlt)) {
-    int tmp = info.get_handle((char *)buf, length - (buf - start));
+  while (alt_length - (buf - start) > 0) {
+    int tmp = info.get_handle((char *)buf, alt_length - (buf - start));
     if (tmp < 0) {
       ink_assert(!"CacheHTTPInfoVector::unmarshal get_handle() failed");
       return (uint32_t)-1;
@@ -246,12 +264,117 @@ CacheHTTPInfoVector::get_handles(const char *buf, int length, RefCountObj *block
     buf += tmp;
 
     data(xcount).alternate = info;
+    data(xcount).vary.flags = 0;
+    data(xcount).vary_known = false;
     xcount++;
   }
+  buf += vary_index_unmarshal(buf, length - (buf - start));
 
   return ((caddr_t)buf - (caddr_t)start);
 }
 
+/*-------------------------------------------------------------------------
+  The Vary digest of an alternate is computed when it is inserted, or on
+  the first marshal of a vector read without an index, and moves with the
+  alternate when others are removed.
+  -------------------------------------------------------------------------*/
+void
+CacheHTTPInfoVector::vary_digest_compute(int idx)
+{
+  CacheHTTPInfo *alt = &data[idx].alternate;
+
+  data[idx].vary.flags = 0;
+  if (alt->valid() && alt->request_get()->valid() && alt->response_get()->valid())
+    HttpTransactCache::CalcVaryDigest(alt->response_get(), alt->request_get(), &data[idx].vary);
+  data[idx].vary_known = true;
+}
+
+/*-------------------------------------------------------------------------
+  Return the size of the index that will carry the alternates' digests,
+  or 0 if no alternate has a usable Vary header (so vectors without Vary
+  keep their old layout).
+  -------------------------------------------------------------------------*/
+int
+CacheHTTPInfoVector::vary_index_length()
+{
+  int nvalid = 0;
+
+  for (int i = 0; i < xcount; i++) {
+    if (!data[i].vary_known)
+      vary_digest_compute(i);
+    if (data[i].vary.flags & VaryDigest::VALID)
+      nvalid++;
+  }
+
+  return nvalid ? CACHE_VARY_INDEX_SIZE(xcount) : 0;
+}
+
+int
+CacheHTTPInfoVector::vary_index_marshal(char *buf, int length)
+{
+  int len = vary_index_length();
+
+  if (!len)
+    return 0;
+  ink_release_assert(len <= length);
+  memset(buf, 0, len);
+
+  VaryDigest *digest = (VaryDigest *)buf;
+  for (int i = 0; i < xcount; i++) {
+    digest[i] = data[i].vary;
+  }
+
+  CacheVaryIndexTrailer *trailer = (CacheVaryIndexTrailer *)(buf + len - sizeof(CacheVaryIndexTrailer));
+  trailer->count = xcount;
+  trailer->magic = CACHE_VARY_INDEX_MAGIC;
+  return len;
+}
+
+int
+CacheHTTPInfoVector::vary_index_unmarshal(const char *buf, int length)
+{
+  if (length <= 0 || length != alternates_index_length(buf, length) ||
+      ((const CacheVaryIndexTrailer *)(buf + length - sizeof(CacheVaryIndexTrailer)))->count != (uint32_t)xcount)
+    return 0;
+
+  const VaryDigest *digest = (const VaryDigest *)buf;
+  for (int i = 0; i < xcount; i++) {
+    data[i].vary = digest[i];
+    data[i].vary_known = true;
+  }
+  return length;
+}
+
+/*-------------------------------------------------------------------------
+  Size of the Vary index at the end of the @a length byte vector header
+  at @a buf, which must have been written with one. Returns 0 if the
+  trailer does not describe an index that fits.
+  -------------------------------------------------------------------------*/
+int
+CacheHTTPInfoVector::alternates_index_length(const char *buf, int length)
+{
+  if (length < (int)sizeof(CacheVaryIndexTrailer))
+    return 0;
+
+  const CacheVaryIndexTrailer *trailer = (const CacheVaryIndexTrailer *)(buf + length - sizeof(CacheVaryIndexTrailer));
+  if (trailer->magic != CACHE_VARY_INDEX_MAGIC || trailer->count > (uint32_t)length / sizeof(VaryDigest))
+    return 0;
+
+  int len = CACHE_VARY_INDEX_SIZE(trailer->count);
+  return len <= length ? len : 0;
+}
+
+/*-------------------------------------------------------------------------
+  Bytes of the @a length byte vector header at @a buf taken up by the
+  marshalled alternates, that is everything before the Vary index if
+  @a vary_index says there is one.
+  -------------------------------------------------------------------------*/
+int
+CacheHTTPInfoVector::alternates_length(const char *buf, int length, bool vary_index)
+{
+  return vary_index ? length - alternates_index_length(buf, length) : length;
+}
+
 #else // HTTP_CACHE
 
 CacheHTTPInfoVector::CacheHTTPInfoVector() : data(&default_vec_info, 4), xcount(0)
@@ -315,7 +438,7 @@ CacheHTTPInfoVector::print(char * /* buffer ATS_UNUSED */, size_t /* buf_size AT
   -------------------------------------------------------------------------*/
 
 int
-CacheHTTPInfoVector::marshal_length()
+CacheHTTPInfoVector::marshal_length(bool /* vary_index ATS_UNUSED */)
 {
   ink_assert(0);
   return 0;
@@ -324,14 +447,14 @@ CacheHTTPInfoVector::marshal_length()
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 int
-CacheHTTPInfoVector::marshal(char * /* buf ATS_UNUSED */, int length)
+CacheHTTPInfoVector::marshal(char * /* buf ATS_UNUSED */, int length, bool /* vary_index ATS_UNUSED */)
 {
   ink_assert(0);
   return length;
 }
 
 int
-CacheHTTPInfoVector::unmarshal(const char * /* buf ATS_UNUSED */, int /* length ATS_UNUSED */,
+CacheHTTPInfoVector::unmarshal(const char * /* buf ATS_UNUSED */, int /* length ATS_UNUSED */, bool /* vary_index ATS_UNUSED */,
                                RefCountObj * /* block_ptr ATS_UNUSED */)
 {
   ink_assert(0);
@@ -342,11 +465,46 @@ CacheHTTPInfoVector::unmarshal(const char * /* buf ATS_UNUSED */, int /* length
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 uint32_t
-CacheHTTPInfoVector::get_handles(const char * /* buf ATS_UNUSED */, int /* length ATS_UNUSED */,
+CacheHTTPInfoVector::get_handles(const char * /* buf ATS_UNUSED */, int /* length ATS_UNUSED */, bool /* vary_index ATS_UNUSED */,
                                  RefCountObj * /* block_ptr ATS_UNUSED */)
 {
   ink_assert(0);
   return 0;
 }
 
+void
+CacheHTTPInfoVector::vary_digest_compute(int /* idx ATS_UNUSED */)
+{
+}
+
+int
+CacheHTTPInfoVector::vary_index_length()
+{
+  return 0;
+}
+
+int
+CacheHTTPInfoVector::vary_index_marshal(char * /* buf ATS_UNUSED */, int /* length ATS_UNUSED */)
+{
+  return 0;
+}
+
+int
+CacheHTTPInfoVector::vary_index_unmarshal(const char * /* buf ATS_UNUSED */, int /* length ATS_UNUSED */)
+{
+  return 0;
+}
+
+int
+CacheHTTPInfoVector::alternates_index_length(const char * /* buf ATS_UNUSED */, int /* length ATS_UNUSED */)
+{
+  return 0;
+}
+
+int
+CacheHTTPInfoVector::alternates_length(const char * /* buf ATS_UNUSED */, int length, bool /* vary_index ATS_UNUSED */)
+{
+  return length;
+}
+
 #endif // HTTP_CACHE
@@ -165,7 +165,7 @@ Lcallreturn:
 uint32_t
 CacheVC::load_http_info(CacheHTTPInfoVector *info, Doc *doc, RefCountObj *block_ptr)
 {
-  uint32_t zret = info->get_handles(doc->hdr(), doc->hlen, block_ptr);
+  uint32_t zret = info->get_handles(doc->hdr(), doc->hlen, doc->flags & DOC_FLAG_VARY_INDEX, block_ptr);
   if (cache_config_compatibility_4_2_0_fixup && // manual override not engaged
       !this->f.doc_from_ram_cache &&            // it's already been done for ram cache fragments
       vol->header->version.ink_major == 23 && vol->header->version.ink_minor == 0) {
@@ -322,8 +322,12 @@ CacheVC::openReadFromWriter(int event, Event *e)
     write_vc = NULL;
     SET_HANDLER(&CacheVC::openReadStartHead);
     return openReadStartHead(event, e);
-  } else
+  } else {
     ink_assert(od == vol->open_read(&first_key));
+    // have the writer keep its fragments for us
+    if (cache_config_read_while_writer && frag_type == CACHE_FRAG_TYPE_HTTP)
+      od->share_fragments = 1;
+  }
   if (!write_vc) {
     int ret = openReadChooseWriter(event, e);
     if (ret < 0) {
@@ -239,7 +239,7 @@ CacheVC::scanObject(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
     }
     {
       char *tmp = doc->hdr();
-      int len = doc->hlen;
+      int len = CacheHTTPInfoVector::alternates_length(tmp, doc->hlen, doc->flags & DOC_FLAG_VARY_INDEX);
       while (len > 0) {
         int r = HTTPInfo::unmarshal(tmp, len, buf._ptr());
         if (r < 0) {
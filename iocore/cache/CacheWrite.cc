@@ -205,11 +205,12 @@ CacheVC::handleWrite(int event, Event * /* e ATS_UNUSED */)
     return handleEvent(AIO_EVENT_DONE, 0);
   }
   ink_assert(agg_len <= AGG_SIZE);
+  agg_enqueue_time = ink_get_hrtime();
   if (f.evac_vector)
     vol->agg.push(this);
   else
     vol->agg.enqueue(this);
-  if (!vol->is_io_in_progress())
+  if (!vol->is_io_in_progress() || vol->agg_fill_while_flushing())
     return vol->aggWrite(event, this);
   return EVENT_CONT;
 }
@@ -312,6 +313,11 @@ Vol::aggWriteDone(int event, Event *e)
     eventProcessor.schedule_in(this, HRTIME_MSECONDS(cache_config_mutex_retry_delay));
     return EVENT_CONT;
   }
+  {
+    Vol *vol = this;
+    CACHE_INCREMENT_DYN_STAT(cache_agg_write_flush_count_stat);
+    CACHE_SUM_DYN_STAT(cache_agg_write_flush_time_stat, ink_get_hrtime() - agg_flush_start);
+  }
   if (io.ok()) {
     header->last_write_pos = header->write_pos;
     header->write_pos += io.aiocb.aio_nbytes;
@@ -321,7 +327,7 @@ Vol::aggWriteDone(int event, Event *e)
     ink_assert(header->write_pos == header->agg_pos);
     if (header->write_pos + EVACUATION_SIZE > scan_pos)
       periodic_scan();
-    agg_buf_pos = 0;
+    agg_flush_len = 0;
     header->write_serial++;
   } else {
     // delete all the directory entries that we inserted
@@ -331,14 +337,17 @@ Vol::aggWriteDone(int event, Event *e)
           hash_text.get(), (uint64_t)io.aiocb.aio_offset, (uint64_t)io.aiocb.aio_offset + io.aiocb.aio_nbytes,
           (uint64_t)io.aiocb.aio_offset / CACHE_BLOCK_SIZE,
           (uint64_t)(io.aiocb.aio_offset + io.aiocb.aio_nbytes) / CACHE_BLOCK_SIZE);
+    // write_pos does not move, so anything copied into the fill buffer
+    // while this write was in flight is now at the wrong offset as well.
     Dir del_dir;
     dir_clear(&del_dir);
-    for (int done = 0; done < agg_buf_pos;) {
-      Doc *doc = (Doc *)(agg_buffer + done);
+    for (int done = 0; done < agg_pending_len();) {
+      Doc *doc = (Doc *)agg_buffer_at(header->write_pos + done);
       dir_set_offset(&del_dir, header->write_pos + done);
       dir_delete(&doc->key, this, &del_dir);
       done += round_to_approx_size(doc->len);
     }
+    agg_flush_len = 0;
     agg_buf_pos = 0;
   }
   set_io_not_in_progress();
@@ -352,11 +361,13 @@ Vol::aggWriteDone(int event, Event *e)
       break;
     }
   }
-  if (dir_sync_waiting) {
+  // the sync has to wait for whatever was copied into the fill buffer
+  // before it started waiting
+  if (dir_sync_waiting && !agg_buf_pos) {
     dir_sync_waiting = 0;
     cacheDirSync->handleEvent(EVENT_IMMEDIATE, 0);
   }
-  if (agg.head || sync.head)
+  if (agg.head || sync.head || agg_buf_pos)
     return aggWrite(event, e);
   return EVENT_CONT;
 }
@@ -582,6 +593,7 @@ Vol::evacuateWrite(CacheVC *evacuator, int event, Event *e)
   for (; cur && cur->f.evacuator; cur = (CacheVC *)cur->link.next)
     after = cur;
   ink_assert(evacuator->agg_len <= AGG_SIZE);
+  evacuator->agg_enqueue_time = ink_get_hrtime();
   agg.insert(evacuator, after);
   return aggWrite(event, e);
 }
@@ -719,7 +731,7 @@ static int
 agg_copy(char *p, CacheVC *vc)
 {
   Vol *vol = vc->vol;
-  off_t o = vol->header->write_pos + vol->agg_buf_pos;
+  off_t o = vol->header->write_pos + vol->agg_pending_len();
 
   if (!vc->f.evacuator) {
     Doc *doc = (Doc *)p;
@@ -744,11 +756,13 @@ agg_copy(char *p, CacheVC *vc)
     doc->doc_type = vc->frag_type;
     doc->v_major = CACHE_DB_MAJOR_VERSION;
     doc->v_minor = CACHE_DB_MINOR_VERSION;
-    doc->unused = 0; // force this for forward compatibility.
+    doc->flags = 0;
     doc->total_len = vc->total_len;
     doc->first_key = vc->first_key;
     doc->sync_serial = vol->header->sync_serial;
-    vc->write_serial = doc->write_serial = vol->header->write_serial;
+    // a sync writer is called back once the write after the one its
+    // fragment goes out in is done, so use the serial of that write
+    vc->write_serial = doc->write_serial = vol->agg_write_serial();
     doc->checksum = DOC_NO_CHECKSUM;
     if (vc->pin_in_cache) {
       dir_set_pinned(&vc->dir, 1);
@@ -801,6 +815,8 @@ agg_copy(char *p, CacheVC *vc)
         }
         ink_assert(!(((uintptr_t)&doc->hdr()[0]) & HDR_PTR_ALIGNMENT_MASK));
         ink_assert(vc->header_len == vc->write_vector->marshal(doc->hdr(), vc->header_len));
+        if (vc->write_vector->vary_index_length())
+          doc->flags |= DOC_FLAG_VARY_INDEX;
       } else
 #endif
         memcpy(doc->hdr(), vc->header_to_write, vc->header_len);
@@ -841,6 +857,14 @@ agg_copy(char *p, CacheVC *vc)
     if (vc->frag_type == CACHE_FRAG_TYPE_HTTP && vc->f.single_fragment)
       ink_assert(doc->hlen);
 
+    // readers following this writer take the fragment from here
+    if (vc->write_len && vc->od && vc->od->share_fragments &&
+        vc->agg_len <= (uint32_t)BUFFER_SIZE_FOR_INDEX(MAX_BUFFER_SIZE_INDEX)) {
+      IOBufferData *d = new_IOBufferData(iobuffer_size_to_index(vc->agg_len, MAX_BUFFER_SIZE_INDEX), MEMALIGNED);
+      memcpy(d->data(), doc, doc->len);
+      vc->od->fragment_put(&doc->key, dir_offset(&vc->dir), d);
+    }
+
     if (res_alt_blk)
       res_alt_blk->free();
 
@@ -857,7 +881,7 @@ agg_copy(char *p, CacheVC *vc)
     }
 
     doc->sync_serial = vc->vol->header->sync_serial;
-    doc->write_serial = vc->vol->header->write_serial;
+    doc->write_serial = vc->vol->agg_write_serial();
 
     memcpy(p, doc, doc->len);
 
@@ -925,6 +949,23 @@ Vol::periodic_scan()
   scan_pos += len / PIN_SCAN_EVERY;
 }
 
+/* Set the number of aggregation buffers for this volume, 1 or 2.
+   With two, fragments are copied into one buffer while the other is
+   being written, so writers do not wait for the disk.
+   */
+void
+Vol::agg_buffers_set(int n)
+{
+  ink_assert(!agg_pending_len());
+  if (n > 1 && agg_flush_buffer == agg_buffer) {
+    agg_flush_buffer = (char *)ats_memalign(ats_pagesize(), AGG_SIZE);
+    memset(agg_flush_buffer, 0, AGG_SIZE);
+  } else if (n <= 1 && agg_flush_buffer != agg_buffer) {
+    ats_memalign_free(agg_flush_buffer);
+    agg_flush_buffer = agg_buffer;
+  }
+}
+
 void
 Vol::agg_wrap()
 {
@@ -952,10 +993,12 @@ Vol::agg_wrap()
 int
 Vol::aggWrite(int event, void * /* e ATS_UNUSED */)
 {
-  ink_assert(!is_io_in_progress());
+  ink_assert(!is_io_in_progress() || agg_fill_while_flushing());
 
   Que(CacheVC, link) tocall;
   CacheVC *c;
+  off_t end;
+  ink_hrtime now = ink_get_hrtime();
 
   cancel_trigger();
 
@@ -965,13 +1008,18 @@ Lagain:
     int writelen = c->agg_len;
     // [amc] this is checked multiple places, on here was it strictly less.
     ink_assert(writelen <= AGG_SIZE);
-    if (agg_buf_pos + writelen > AGG_SIZE || header->write_pos + agg_buf_pos + writelen > (skip + len))
+    if (agg_buf_pos + writelen > AGG_SIZE || header->write_pos + agg_pending_len() + writelen > (skip + len))
       break;
-    DDebug("agg_read", "copying: %d, %" PRIu64 ", key: %d", agg_buf_pos, header->write_pos + agg_buf_pos, c->first_key.slice32(0));
+    DDebug("agg_read", "copying: %d, %" PRIu64 ", key: %d", agg_buf_pos, header->write_pos + agg_pending_len(),
+           c->first_key.slice32(0));
     int wrotelen = agg_copy(agg_buffer + agg_buf_pos, c);
     ink_assert(writelen == wrotelen);
     agg_todo_size -= writelen;
     agg_buf_pos += writelen;
+    {
+      Vol *vol = this;
+      CACHE_SUM_DYN_STAT(cache_agg_write_queue_time_stat, now - c->agg_enqueue_time);
+    }
     CacheVC *n = (CacheVC *)c->link.next;
     agg.dequeue();
     if (c->f.sync && c->f.use_first_key) {
@@ -986,6 +1034,10 @@ Lagain:
     c = n;
   }
 
+  // the rest has to wait for the write in flight
+  if (agg_flush_len)
+    goto Lwait;
+
   // if we got nothing...
   if (!agg_buf_pos) {
     if (!agg.head && !sync.head) // nothing to get
@@ -1012,7 +1064,7 @@ Lagain:
   }
 
   // evacuate space
-  off_t end = header->write_pos + agg_buf_pos + EVACUATION_SIZE;
+  end = header->write_pos + agg_buf_pos + EVACUATION_SIZE;
   if (evac_range(header->write_pos, end, !header->phase) < 0)
     goto Lwait;
   if (end > skip + len)
@@ -1021,7 +1073,7 @@ Lagain:
 
   // if agg.head, then we are near the end of the disk, so
   // write down the aggregation in whatever size it is.
-  if (agg_buf_pos < AGG_HIGH_WATER && !agg.head && !sync.head && !dir_sync_waiting)
+  if (agg_buf_pos < agg_high_water && !agg.head && !sync.head && !dir_sync_waiting)
     goto Lwait;
 
   // write sync marker
@@ -1040,10 +1092,21 @@ Lagain:
   // set write limit
   header->agg_pos = header->write_pos + agg_buf_pos;
 
+  // hand the buffer off to the write, and if we have a spare start
+  // filling that instead
+  agg_flush_len = agg_buf_pos;
+  agg_buf_pos = 0;
+  if (agg_flush_buffer != agg_buffer) {
+    char *b = agg_flush_buffer;
+    agg_flush_buffer = agg_buffer;
+    agg_buffer = b;
+  }
+  agg_flush_start = ink_get_hrtime();
+
   io.aiocb.aio_fildes = fd;
   io.aiocb.aio_offset = header->write_pos;
-  io.aiocb.aio_buf = agg_buffer;
-  io.aiocb.aio_nbytes = agg_buf_pos;
+  io.aiocb.aio_buf = agg_flush_buffer;
+  io.aiocb.aio_nbytes = agg_flush_len;
   io.action = this;
   /*
     Callback on AIO thread so that we can issue a new write ASAP
@@ -33,7 +33,7 @@
 #define CACHE_ALT_REMOVED -2
 
 #define CACHE_DB_MAJOR_VERSION 24
-#define CACHE_DB_MINOR_VERSION 0
+#define CACHE_DB_MINOR_VERSION 1
 
 #define CACHE_DIR_MAJOR_VERSION 18
 #define CACHE_DIR_MINOR_VERSION 0
@@ -68,6 +68,7 @@ struct Span {
   unsigned alignment;
   span_diskid_t disk_id;
   int forced_volume_num; ///< Force span in to specific volume.
+  int agg_buffers;       ///< Aggregation buffers per stripe, 0 for the global setting.
 private:
   bool is_mmapable_internal;
 
@@ -145,10 +146,12 @@ public:
   void hash_base_string_set(char const *s);
   /// Set the volume number.
   void volume_number_set(int n);
+  /// Set the number of aggregation buffers.
+  void agg_buffers_set(int n);
 
   Span()
     : blocks(0), offset(0), hw_sector_size(DEFAULT_HW_SECTOR_SIZE), alignment(0), forced_volume_num(-1),
-      is_mmapable_internal(false), file_pathname(false)
+      agg_buffers(0), is_mmapable_internal(false), file_pathname(false)
   {
     disk_id[0] = disk_id[1] = 0;
   }
@@ -258,6 +261,7 @@ struct Store {
   /// Additional configuration key values.
   static char const VOLUME_KEY[];
   static char const HASH_BASE_STRING_KEY[];
+  static char const AGG_BUFFERS_KEY[];
 };
 
 // store either free or in the cache, can be stolen for reconfiguration
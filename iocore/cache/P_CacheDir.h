@@ -109,6 +109,7 @@ struct CacheVC;
 // OpenDir
 
 #define OPEN_DIR_BUCKETS 256
+#define OPEN_DIR_FRAGMENTS 4 // recent fragments shared with readers
 
 struct EvacuationBlock;
 typedef uint32_t DirInfo;
@@ -265,10 +266,23 @@ struct OpenDirEntry {
   bool move_resident_alt;                          // if set, single_doc_dir is inserted.
   volatile bool reading_vec;                       // somebody is currently reading the vector
   volatile bool writing_vec;                       // somebody is currently writing the vector
+  bool share_fragments;                            // readers are following the writer
+  int next_fragment;                               // next slot in fragments to replace
+
+  // The most recently written fragments, kept while readers are following
+  // the writer so that they share the data rather than each reading it back.
+  struct WriterFragment {
+    CacheKey key;
+    int64_t offset; // dir_offset() of the fragment
+    Ptr<IOBufferData> data;
+  } fragments[OPEN_DIR_FRAGMENTS];
 
   LINK(OpenDirEntry, link);
 
   int wait(CacheVC *c, int msec);
+  IOBufferData *fragment_get(CacheKey *key, int64_t offset);
+  void fragment_put(CacheKey *key, int64_t offset, IOBufferData *data);
+  void fragments_clear();
 
   bool
   has_multiple_writers()
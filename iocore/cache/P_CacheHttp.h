@@ -28,6 +28,7 @@
 #ifdef HTTP_CACHE
 #include "HTTP.h"
 #include "URL.h"
+#include "HttpTransactCache.h"
 
 
 typedef URL CacheURL;
@@ -46,10 +47,17 @@ enum {
 struct CacheHTTPInfo {
 };
 
+struct VaryDigest {
+  enum { VALID = 1 };
+  uint32_t flags;
+};
+
 #endif // HTTP_CACHE
 
 struct vec_info {
   CacheHTTPInfo alternate;
+  VaryDigest vary;
+  bool vary_known; ///< @a vary has been computed or read for @a alternate.
 };
 
 struct CacheHTTPInfoVector {
@@ -76,10 +84,23 @@ struct CacheHTTPInfoVector {
   }
   void print(char *buffer, size_t buf_size, bool temps = true);
 
-  int marshal_length();
-  int marshal(char *buf, int length);
-  uint32_t get_handles(const char *buf, int length, RefCountObj *block_ptr = NULL);
-  int unmarshal(const char *buf, int length, RefCountObj *block_ptr);
+  int marshal_length(bool vary_index = true);
+  int marshal(char *buf, int length, bool vary_index = true);
+  uint32_t get_handles(const char *buf, int length, bool vary_index, RefCountObj *block_ptr = NULL);
+  int unmarshal(const char *buf, int length, bool vary_index, RefCountObj *block_ptr);
+
+  /// Vary digest of alternate @a idx, or NULL if none is known.
+  VaryDigest *vary_digest_get(int idx);
+  void vary_digest_compute(int idx);
+  int vary_index_length();
+  int vary_index_marshal(char *buf, int length);
+  int vary_index_unmarshal(const char *buf, int length);
+
+  /// Size of the Vary index at the end of a marshalled vector written with one, 0 if it is malformed.
+  static int alternates_index_length(const char *buf, int length);
+  /// Bytes of a marshalled vector before its Vary index, i.e. taken by the alternates.
+  /// @a vary_index says whether the vector was written with an index.
+  static int alternates_length(const char *buf, int length, bool vary_index);
 
   CacheArray<vec_info> data;
   int xcount;
@@ -94,4 +115,12 @@ CacheHTTPInfoVector::get(int idx)
   return &data[idx].alternate;
 }
 
+TS_INLINE VaryDigest *
+CacheHTTPInfoVector::vary_digest_get(int idx)
+{
+  ink_assert(idx >= 0);
+  ink_assert(idx < xcount);
+  return (data[idx].vary.flags & VaryDigest::VALID) ? &data[idx].vary : NULL;
+}
+
 #endif /* __CACHE_HTTP_H__ */
@@ -153,6 +153,7 @@ enum {
   cache_three_plus_plus_fragment_document_count_stat,
   cache_read_busy_success_stat,
   cache_read_busy_failure_stat,
+  cache_read_writer_fragment_hits_stat,
   cache_gc_bytes_evacuated_stat,
   cache_gc_frags_evacuated_stat,
   cache_write_bytes_stat,
@@ -163,6 +164,9 @@ enum {
   cache_directory_sync_count_stat,
   cache_directory_sync_time_stat,
   cache_directory_sync_bytes_stat,
+  cache_agg_write_queue_time_stat,
+  cache_agg_write_flush_count_stat,
+  cache_agg_write_flush_time_stat,
   cache_stat_count
 };
 
@@ -226,6 +230,8 @@ extern int cache_config_hit_evacuate_size_limit;
 extern int cache_config_force_sector_size;
 extern int cache_config_target_fragment_size;
 extern int cache_config_mutex_retry_delay;
+extern int cache_config_agg_write_buffers;
+extern int cache_config_agg_write_high_water;
 #if TS_USE_INTERIM_CACHE == 1
 extern int good_interim_disks;
 #endif
@@ -437,6 +443,7 @@ struct CacheVC : public CacheVConnection {
   int frag_len;          // for communicating with agg_copy
   uint32_t write_len;    // for communicating with agg_copy
   uint32_t agg_len;      // for communicating with aggWrite
+  ink_hrtime agg_enqueue_time; // when queued for aggWrite, for queue time stats
   uint32_t write_serial; // serial of the final write for SYNC
   Vol *vol;
   Dir *last_collision;
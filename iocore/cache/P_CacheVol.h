@@ -389,6 +389,12 @@ struct InterimCacheVol : public Continuation {
 
   int aggWrite(int event, void *e);
   int aggWriteDone(int event, void *e);
+  // interim volumes are single buffered
+  int
+  agg_pending_len() const
+  {
+    return agg_buf_pos;
+  }
   uint32_t
   round_to_approx_size(uint32_t l)
   {
@@ -457,9 +463,16 @@ struct Vol : public Continuation {
   Queue<CacheVC, Continuation::Link_link> agg;
   Queue<CacheVC, Continuation::Link_link> stat_cache_vcs;
   Queue<CacheVC, Continuation::Link_link> sync;
-  char *agg_buffer;
+  char *agg_buffer; // buffer being filled
   int agg_todo_size;
   int agg_buf_pos;
+  // When double buffered, the aggregation buffer being written is swapped
+  // out to agg_flush_buffer so that agg_buffer can keep filling. With a
+  // single buffer both point to the same memory.
+  char *agg_flush_buffer;
+  int agg_flush_len; // bytes in flight at header->write_pos, 0 if none
+  int agg_high_water;
+  ink_hrtime agg_flush_start;
 
   Event *trigger;
 
@@ -592,6 +605,27 @@ struct Vol : public Continuation {
   int aggWriteDone(int event, Event *e);
   int aggWrite(int event, void *e);
   void agg_wrap();
+  void agg_buffers_set(int n);
+
+  // Can fragments be copied into agg_buffer while an aggregation write is in flight?
+  bool
+  agg_fill_while_flushing() const
+  {
+    return agg_flush_len && agg_flush_buffer != agg_buffer && !dir_sync_waiting;
+  }
+  // Bytes written to the aggregation buffers but not yet to disk.
+  int
+  agg_pending_len() const
+  {
+    return agg_flush_len + agg_buf_pos;
+  }
+  // Serial of the aggregation write agg_buffer will go out in. That is the next one if a write is in flight.
+  uint32_t
+  agg_write_serial() const
+  {
+    return agg_flush_len ? header->write_serial + 1 : header->write_serial;
+  }
+  char *agg_buffer_at(off_t o);
 
   int evacuateWrite(CacheVC *evacuator, int event, Event *e);
   int evacuateDocReadDone(int event, Event *e);
@@ -608,17 +642,23 @@ struct Vol : public Continuation {
 
   Vol()
     : Continuation(new_ProxyMutex()), path(NULL), fd(-1), dir(0), buckets(0), recover_pos(0), prev_recover_pos(0), scan_pos(0),
-      skip(0), start(0), len(0), data_blocks(0), hit_evacuate_window(0), agg_todo_size(0), agg_buf_pos(0), trigger(0),
-      evacuate_size(0), disk(NULL), last_sync_serial(0), last_write_serial(0), recover_wrapped(false), dir_sync_waiting(0),
-      dir_sync_in_progress(0), writing_end_marker(0)
+      skip(0), start(0), len(0), data_blocks(0), hit_evacuate_window(0), agg_todo_size(0), agg_buf_pos(0), agg_flush_len(0),
+      agg_high_water(AGG_HIGH_WATER), agg_flush_start(0), trigger(0), evacuate_size(0), disk(NULL), last_sync_serial(0),
+      last_write_serial(0), recover_wrapped(false), dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0)
   {
     open_dir.mutex = mutex;
     agg_buffer = (char *)ats_memalign(ats_pagesize(), AGG_SIZE);
     memset(agg_buffer, 0, AGG_SIZE);
+    agg_flush_buffer = agg_buffer;
     SET_HANDLER(&Vol::aggWrite);
   }
 
-  ~Vol() { ats_memalign_free(agg_buffer); }
+  ~Vol()
+  {
+    if (agg_flush_buffer != agg_buffer)
+      ats_memalign_free(agg_flush_buffer);
+    ats_memalign_free(agg_buffer);
+  }
 };
 
 struct AIO_Callback_handler : public Continuation {
@@ -641,6 +681,11 @@ struct CacheVol {
   CacheVol() : vol_number(-1), scheme(0), size(0), num_vols(0), vols(NULL), disk_vols(0), vol_rsb(0) {}
 };
 
+/// Doc::flags bits.
+enum {
+  DOC_FLAG_VARY_INDEX = 1, ///< The HTTP vector header ends with a Vary index.
+};
+
 // Note : hdr() needs to be 8 byte aligned.
 // If you change this, change sizeofDoc above
 struct Doc {
@@ -653,7 +698,7 @@ struct Doc {
   uint32_t doc_type : 8; ///< Doc type - indicates the format of this structure and its content.
   uint32_t v_major : 8;  ///< Major version number.
   uint32_t v_minor : 8;  ///< Minor version number.
-  uint32_t unused : 8;   ///< Unused, forced to zero.
+  uint32_t flags : 8;    ///< DOC_FLAG_* bits, zero in docs from before they existed.
   uint32_t sync_serial;
   uint32_t write_serial;
   uint32_t pinned; // pinned until
@@ -704,7 +749,7 @@ vol_direntries(Vol *d)
 
 #define vol_out_of_phase_write_valid(d, e) (dir_offset(e) - 1 >= ((d->header->agg_pos - d->start + AGG_SIZE) / CACHE_BLOCK_SIZE))
 
-#define vol_in_phase_valid(d, e) (dir_offset(e) - 1 < ((d->header->write_pos + d->agg_buf_pos - d->start) / CACHE_BLOCK_SIZE))
+#define vol_in_phase_valid(d, e) (dir_offset(e) - 1 < ((d->header->write_pos + d->agg_pending_len() - d->start) / CACHE_BLOCK_SIZE))
 
 #define vol_offset_to_offset(d, pos) (d->start + pos * CACHE_BLOCK_SIZE - CACHE_BLOCK_SIZE)
 
@@ -715,7 +760,7 @@ vol_direntries(Vol *d)
 #define vol_offset(d, e) ((d)->start + (off_t)((off_t)dir_offset(e) * CACHE_BLOCK_SIZE) - CACHE_BLOCK_SIZE)
 
 #define vol_in_phase_agg_buf_valid(d, e) \
-  ((vol_offset(d, e) >= d->header->write_pos) && vol_offset(d, e) < (d->header->write_pos + d->agg_buf_pos))
+  ((vol_offset(d, e) >= d->header->write_pos) && vol_offset(d, e) < (d->header->write_pos + d->agg_pending_len()))
 
 #define vol_transistor_range_valid(d, e)                                                                                  \
   ((d->header->agg_pos + d->transistor_range_threshold < d->start + d->len) ?                                             \
@@ -747,7 +792,7 @@ vol_out_of_phase_write_valid(Vol *d, Dir *e)
 TS_INLINE int
 vol_in_phase_valid(Vol *d, Dir *e)
 {
-  return (dir_offset(e) - 1 < ((d->header->write_pos + d->agg_buf_pos - d->start) / CACHE_BLOCK_SIZE));
+  return (dir_offset(e) - 1 < ((d->header->write_pos + d->agg_pending_len() - d->start) / CACHE_BLOCK_SIZE));
 }
 
 TS_INLINE off_t
@@ -777,7 +822,7 @@ vol_dir_segment(Vol *d, int s)
 TS_INLINE int
 vol_in_phase_agg_buf_valid(Vol *d, Dir *e)
 {
-  return (vol_offset(d, e) >= d->header->write_pos && vol_offset(d, e) < (d->header->write_pos + d->agg_buf_pos));
+  return (vol_offset(d, e) >= d->header->write_pos && vol_offset(d, e) < (d->header->write_pos + d->agg_pending_len()));
 }
 #endif
 // length of the partition not including the offset of location 0.
@@ -882,6 +927,18 @@ Vol::within_hit_evacuate_window(Dir *xdir)
     return -delta > (data_blocks - hit_evacuate_window) && -delta < data_blocks;
 }
 
+// Location in the aggregation buffers of the fragment at disk offset @a o,
+// which must be within [header->write_pos, header->write_pos + agg_pending_len()).
+TS_INLINE char *
+Vol::agg_buffer_at(off_t o)
+{
+  off_t agg_offset = o - header->write_pos;
+  ink_assert(agg_offset >= 0 && agg_offset < agg_pending_len());
+  if (agg_offset < agg_flush_len)
+    return agg_flush_buffer + agg_offset;
+  return agg_buffer + (agg_offset - agg_flush_len);
+}
+
 TS_INLINE uint32_t
 Vol::round_to_approx_size(uint32_t l)
 {
@@ -131,13 +131,19 @@ verify_peters_data(char *ap, int l)
 //  periodic event.  This a mechanism to avoid the latency on control
 //  messages by allowing them to be pushed immediately.
 //
+//  When proxy.config.cluster.write_batch_usecs is non-zero, thread
+//  stealing is disabled and control messages are instead held for up to
+//  that many microseconds so that many small messages to the same peer
+//  share one header and one writev().  A batch is flushed early once it
+//  fills a reasonable fraction of the iovec or control data area.
+//
 /*************************************************************************/
 
 ClusterHandler::ClusterHandler()
   : net_vc(0), thread(0), ip(0), port(0), hostname(NULL), machine(NULL), ifd(-1), id(-1), dead(true), downing(false), active(false),
     on_stolen_thread(false), n_channels(0), channels(NULL), channel_data(NULL), connector(false),
     cluster_connect_state(ClusterHandler::CLCON_INITIAL), needByteSwap(false), configLookupFails(0), cluster_periodic_event(0),
-    read(this, true), write(this, false), current_time(0), last(0), last_report(0), n_since_last_report(0),
+    write_batch_event(0), read(this, true), write(this, false), current_time(0), last(0), last_report(0), n_since_last_report(0),
     last_cluster_op_enable(0), last_trace_dump(0), clm(0), disable_remote_cluster_ops(0), pw_write_descriptors_built(0),
     pw_freespace_descriptors_built(0), pw_controldata_descriptors_built(0), pw_time_expired(0), started_on_stolen_thread(false),
     control_message_write(false)
@@ -1817,6 +1823,53 @@ ClusterHandler::add_small_controlmsg_descriptors()
   return 1;
 }
 
+bool
+ClusterHandler::control_batch_ready(ink_hrtime now)
+{
+  //
+  // Decide whether the queued control messages should go out in this
+  // write or be held to accumulate a larger batch.
+  //
+  if (cluster_write_batch_usecs <= 0) {
+    return true;
+  }
+  int msgs = 0;
+  int bytes = 0;
+  ink_hrtime oldest = 0;
+
+  for (int q = 0; q < CLUSTER_CMSG_QUEUES; ++q) {
+    // Move elements from global outgoing_control to local queue
+    OutgoingControl *c = (OutgoingControl *)ink_atomiclist_popall(&outgoing_control_al[q]);
+    OutgoingControl *c_next;
+    while (c) {
+      c_next = (OutgoingControl *)c->link.next;
+      c->link.next = NULL;
+      outgoing_control[q].push(c);
+      c = c_next;
+    }
+    for (c = outgoing_control[q].head; c; c = (OutgoingControl *)c->link.next) {
+      msgs++;
+      bytes += c->len + sizeof(int32_t) * 2 + 7;
+      if (!oldest || c->submit_time < oldest) {
+        oldest = c->submit_time;
+      }
+    }
+  }
+  if (!msgs || msgs >= (MAX_TCOUNT / 2) || bytes >= (CONTROL_DATA / 2)) {
+    return true;
+  }
+  ink_hrtime budget = HRTIME_USECONDS(cluster_write_batch_usecs);
+  if ((now - oldest) >= budget) {
+    return true;
+  }
+  // Hold the batch; make sure we come back when the oldest message is due.
+  if (!write_batch_event) {
+    write_batch_event = thread->schedule_in(this, budget - (now - oldest));
+  }
+  CLUSTER_INCREMENT_DYN_STAT(CLUSTER_WRITE_BATCH_DELAYS_STAT);
+  return false;
+}
+
 struct DestructorLock {
   DestructorLock(EThread *thread)
   {
@@ -2234,6 +2287,14 @@ ClusterHandler::steal_thread(EThread *t)
   // Attempt to push the control message now instead of waiting
   // for the periodic event to process it.
   //
+  if (cluster_write_batch_usecs > 0) {
+    // Batching; the caller holds our mutex, so arm the flush event and
+    // let the cluster thread coalesce this message with others.
+    if (thread && !write_batch_event) {
+      write_batch_event = thread->schedule_in(this, HRTIME_USECONDS(cluster_write_batch_usecs));
+    }
+    return;
+  }
   if (t != thread &&      // different thread to steal
       write.to_do <= 0 && // currently not trying to send data
       // nothing big outstanding
@@ -2363,6 +2424,9 @@ ClusterHandler::mainClusterEvent(int event, Event *e)
     }
   }
 
+  if (event == EVENT_INTERVAL && e == write_batch_event) {
+    write_batch_event = NULL;
+  }
   on_stolen_thread = (event == CLUSTER_EVENT_STEAL_THREAD);
   bool io_callback = (event == EVENT_IMMEDIATE);
 
@@ -2772,8 +2836,14 @@ ClusterHandler::process_write(ink_hrtime now, bool only_write_control_msgs)
           /////////////////////////////////////////////////////////////
 
           // Control message descriptors
+          bool control_held = false;
           if (pw_controldata_descriptors_built) {
-            pw_controldata_descriptors_built = build_controlmsg_descriptors();
+            if (control_batch_ready(now)) {
+              pw_controldata_descriptors_built = build_controlmsg_descriptors();
+            } else {
+              control_held = true;
+              pw_controldata_descriptors_built = 0;
+            }
           }
           // Write data descriptors
           if (pw_write_descriptors_built) {
@@ -2783,6 +2853,10 @@ ClusterHandler::process_write(ink_hrtime now, bool only_write_control_msgs)
           if (pw_freespace_descriptors_built) {
             pw_freespace_descriptors_built = build_freespace_descriptors();
           }
+          // A held batch rides along for free if this write is going out anyway
+          if (control_held && (pw_write_descriptors_built || pw_freespace_descriptors_built)) {
+            pw_controldata_descriptors_built = build_controlmsg_descriptors();
+          }
           add_small_controlmsg_descriptors(); // always last
         } else {
           /////////////////////////////////////////////////////////////
@@ -746,6 +746,10 @@ ClusterHandler::zombify(Event * /* e ATS_UNUSED */)
     cluster_periodic_event->cancel(this);
     cluster_periodic_event = NULL;
   }
+  if (write_batch_event) {
+    write_batch_event->cancel(this);
+    write_batch_event = NULL;
+  }
   clm->cancel_monitor();
 
   SET_HANDLER((ClusterContHandler)&ClusterHandler::protoZombieEvent);
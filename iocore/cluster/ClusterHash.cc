@@ -26,6 +26,8 @@
   ClusterHash.cc
  ****************************************************************************/
 #include "P_Cluster.h"
+#include "ts/TestBox.h"
+#include <math.h>
 
 //
 // Configuration of the cluster hash function
@@ -46,6 +48,12 @@ bool machineClusterHash = true;
 bool boundClusterHash = false;
 bool randClusterHash = false;
 
+// rendezvousClusterHash - whether to use weighted rendezvous hashing
+//                         (see build_hash_table_rendezvous) instead of
+//                         the schemes above
+//
+bool rendezvousClusterHash = false;
+
 // This produces better speed for large numbers of machines > 18
 //
 // bool machineClusterHash = false;
@@ -163,11 +171,231 @@ build_hash_table_bucket(ClusterConfiguration *c)
   }
 }
 
+//
+// Weighted rendezvous (highest random weight) hashing
+//
+// Every machine scores every bucket with a hash of the pair, scaled by
+// the machine's weight, and the highest score owns the bucket.  A bucket
+// only changes owner when its owner leaves or a new machine outscores
+// it, so adding or removing one of n machines moves about 1/n of the
+// buckets, all of them to or from that machine.  A machine's share of
+// the buckets is proportional to its weight.
+//
+// It costs one hash per machine per bucket, ~8M at 256 machines, which
+// is fine for a configuration change.
+//
+
+struct ClusterHashWeight {
+  unsigned int ip;
+  int port;
+  int weight;
+};
+
+static ClusterHashWeight hash_weights[CLUSTER_MAX_MACHINES];
+static int n_hash_weights = 0;
+
+//
+// Parse "ip[:port]=weight ..." (space or comma separated) into the
+// weight table.  Machines that are not listed have weight 1.
+//
+void
+cluster_hash_set_weights(const char *spec)
+{
+  char *buf, *tok, *save = NULL;
+
+  n_hash_weights = 0;
+  if (!spec)
+    return;
+  buf = ats_strdup(spec);
+  for (tok = strtok_r(buf, " ,\t", &save); tok; tok = strtok_r(NULL, " ,\t", &save)) {
+    char *eq = strchr(tok, '=');
+    char *colon = strchr(tok, ':');
+    int weight;
+
+    if (!eq || (weight = atoi(eq + 1)) <= 0) {
+      Warning("ignoring cluster hash weight '%s', expected ip[:port]=weight with a positive weight", tok);
+      continue;
+    }
+    if (n_hash_weights >= CLUSTER_MAX_MACHINES) {
+      Warning("too many cluster hash weights, ignoring '%s'", tok);
+      break;
+    }
+    *eq = 0;
+    if (colon && colon < eq)
+      *colon = 0;
+    hash_weights[n_hash_weights].ip = inet_addr(tok);
+    hash_weights[n_hash_weights].port = (colon && colon < eq) ? atoi(colon + 1) : 0;
+    hash_weights[n_hash_weights].weight = weight;
+    n_hash_weights++;
+  }
+  ats_free(buf);
+}
+
+int
+cluster_hash_weight(unsigned int ip, int port)
+{
+  for (int i = 0; i < n_hash_weights; i++)
+    if (hash_weights[i].ip == ip && (!hash_weights[i].port || !port || hash_weights[i].port == port))
+      return hash_weights[i].weight;
+  return 1;
+}
+
+// 64 bit finalizer from MurmurHash3
+inline uint64_t
+rendezvous_mix(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+void
+build_hash_table_rendezvous(unsigned char *hash_table, ClusterHashNode *nodes, int n_nodes)
+{
+  uint64_t seed[CLUSTER_MAX_MACHINES];
+  bool weighted = false;
+
+  for (int m = 0; m < n_nodes; m++) {
+    seed[m] = rendezvous_mix(((uint64_t)nodes[m].ip << 16) ^ (uint64_t)(nodes[m].port & 0xFFFF));
+    if (nodes[m].weight != nodes[0].weight)
+      weighted = true;
+  }
+
+  for (int i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++) {
+    uint64_t bucket = rendezvous_mix((uint64_t)i + 1) * 0x9E3779B97F4A7C15ULL;
+    int best = 0;
+
+    if (!weighted) {
+      // Equal weights: compare the raw hashes, which keeps every machine
+      // agreeing on the table without relying on libm.
+      uint64_t best_h = 0;
+      for (int m = 0; m < n_nodes; m++) {
+        uint64_t h = rendezvous_mix(seed[m] ^ bucket);
+        if (h > best_h || !m) {
+          best_h = h;
+          best = m;
+        }
+      }
+    } else {
+      // score = weight / -ln(u), u uniform in (0,1)
+      double best_score = -1.0;
+      for (int m = 0; m < n_nodes; m++) {
+        double u = ((rendezvous_mix(seed[m] ^ bucket) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+        double score = nodes[m].weight / -log(u);
+        if (score > best_score) {
+          best_score = score;
+          best = m;
+        }
+      }
+    }
+    hash_table[i] = best;
+  }
+}
+
+static void
+build_hash_table_rendezvous(ClusterConfiguration *c)
+{
+  ClusterHashNode nodes[CLUSTER_MAX_MACHINES];
+
+  for (int m = 0; m < c->n_machines; m++) {
+    nodes[m].ip = c->machines[m]->ip;
+    nodes[m].port = c->machines[m]->cluster_port;
+    nodes[m].weight = cluster_hash_weight(nodes[m].ip, nodes[m].port);
+  }
+  build_hash_table_rendezvous(c->hash_table, nodes, c->n_machines);
+}
+
 void
 build_cluster_hash_table(ClusterConfiguration *c)
 {
-  if (machineClusterHash)
+  if (rendezvousClusterHash)
+    build_hash_table_rendezvous(c);
+  else if (machineClusterHash)
     build_hash_table_machine(c);
   else
     build_hash_table_bucket(c);
 }
+
+//
+// Regression: count the buckets that change owner when machines join,
+// leave or change weight.  With rendezvous hashing only the buckets of
+// the machine that changed may move.
+//
+
+static int
+cluster_hash_moved(unsigned char *a, unsigned char *b, ClusterHashNode *na, ClusterHashNode *nb)
+{
+  int moved = 0;
+  for (int i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++)
+    if (na[a[i]].ip != nb[b[i]].ip)
+      moved++;
+  return moved;
+}
+
+REGRESSION_TEST(ClusterHash_Rendezvous)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+  const int n = 16;
+  ClusterHashNode nodes[n + 1], fewer[n];
+  unsigned char *before = (unsigned char *)ats_malloc(CLUSTER_HASH_TABLE_SIZE);
+  unsigned char *after = (unsigned char *)ats_malloc(CLUSTER_HASH_TABLE_SIZE);
+  int owned[n + 1];
+  int moved, expected;
+
+  box = REGRESSION_TEST_PASSED;
+
+  for (int m = 0; m <= n; m++) {
+    nodes[m].ip = htonl(0x0A000001 + m); // 10.0.0.1 ...
+    nodes[m].port = 8086;
+    nodes[m].weight = 1;
+  }
+
+  // Balance
+  build_hash_table_rendezvous(before, nodes, n);
+  memset(owned, 0, sizeof(owned));
+  for (int i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++)
+    owned[before[i]]++;
+  for (int m = 0; m < n; m++)
+    box.check(abs(owned[m] - CLUSTER_HASH_TABLE_SIZE / n) < CLUSTER_HASH_TABLE_SIZE / n / 10,
+              "machine %d owns %d buckets, expected about %d", m, owned[m], CLUSTER_HASH_TABLE_SIZE / n);
+
+  // Leave: remove machine 5, only its buckets may move
+  for (int m = 0, j = 0; m < n; m++)
+    if (m != 5)
+      fewer[j++] = nodes[m];
+  build_hash_table_rendezvous(after, fewer, n - 1);
+  moved = cluster_hash_moved(before, after, nodes, fewer);
+  rprintf(t, "leave: %d of %d buckets moved, %d owned by the leaving machine\n", moved, CLUSTER_HASH_TABLE_SIZE, owned[5]);
+  box.check(moved == owned[5], "leave moved %d buckets, expected %d", moved, owned[5]);
+
+  // Join: add machine n, only buckets it takes may move
+  build_hash_table_rendezvous(after, nodes, n + 1);
+  moved = cluster_hash_moved(before, after, nodes, nodes);
+  expected = 0;
+  for (int i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++)
+    if (after[i] == n)
+      expected++;
+  rprintf(t, "join: %d of %d buckets moved, ideal %d\n", moved, CLUSTER_HASH_TABLE_SIZE, CLUSTER_HASH_TABLE_SIZE / (n + 1));
+  box.check(moved == expected, "join moved %d buckets, %d to the new machine", moved, expected);
+  box.check(moved < 2 * CLUSTER_HASH_TABLE_SIZE / (n + 1), "join moved %d buckets, more than twice the ideal", moved);
+
+  // Weight: doubling machine 0 should roughly double its share and only
+  // move buckets to it
+  nodes[0].weight = 2;
+  build_hash_table_rendezvous(after, nodes, n);
+  moved = cluster_hash_moved(before, after, nodes, nodes);
+  expected = 0;
+  for (int i = 0; i < CLUSTER_HASH_TABLE_SIZE; i++)
+    if (after[i] == 0)
+      expected++;
+  rprintf(t, "weight: %d of %d buckets moved, machine 0 now owns %d\n", moved, CLUSTER_HASH_TABLE_SIZE, expected);
+  box.check(moved == expected - owned[0], "weight change moved %d buckets, %d to the reweighted machine", moved,
+            expected - owned[0]);
+  box.check(expected > (owned[0] * 3) / 2, "weight 2 machine owns %d buckets, was %d at weight 1", expected, owned[0]);
+
+  ats_free(before);
+  ats_free(after);
+}
@@ -373,6 +373,7 @@ int CacheClusterMonitorEnabled = 0;
 int CacheClusterMonitorIntervalSecs = 1;
 
 int cluster_send_buffer_size = 0;
+int cluster_write_batch_usecs = 0;
 int cluster_receive_buffer_size = 0;
 unsigned long cluster_sockopt_flags = 0;
 unsigned long cluster_packet_mark = 0;
@@ -463,6 +464,9 @@ ClusterProcessor::init()
   RecRegisterRawStat(cluster_rsb, RECT_PROCESS, "proxy.process.cluster.partial_writes", RECD_INT, RECP_NON_PERSISTENT,
                      (int)CLUSTER_PARTIAL_WRITES_STAT, RecRawStatSyncSum);
   CLUSTER_CLEAR_DYN_STAT(CLUSTER_PARTIAL_WRITES_STAT);
+  RecRegisterRawStat(cluster_rsb, RECT_PROCESS, "proxy.process.cluster.write_batch_delays", RECD_INT, RECP_NON_PERSISTENT,
+                     (int)CLUSTER_WRITE_BATCH_DELAYS_STAT, RecRawStatSyncSum);
+  CLUSTER_CLEAR_DYN_STAT(CLUSTER_WRITE_BATCH_DELAYS_STAT);
   RecRegisterRawStat(cluster_rsb, RECT_PROCESS, "proxy.process.cluster.cache_outstanding", RECD_INT, RECP_NON_PERSISTENT,
                      (int)CLUSTER_CACHE_OUTSTANDING_STAT, RecRawStatSyncSum);
   CLUSTER_CLEAR_DYN_STAT(CLUSTER_CACHE_OUTSTANDING_STAT);
@@ -617,11 +621,18 @@ ClusterProcessor::init()
   REC_EstablishStaticConfigInt32(CacheClusterMonitorIntervalSecs, "proxy.config.cluster.monitor_interval_secs");
   REC_ReadConfigInteger(cluster_receive_buffer_size, "proxy.config.cluster.receive_buffer_size");
   REC_ReadConfigInteger(cluster_send_buffer_size, "proxy.config.cluster.send_buffer_size");
+  REC_EstablishStaticConfigInt32(cluster_write_batch_usecs, "proxy.config.cluster.write_batch_usecs");
   REC_ReadConfigInteger(cluster_sockopt_flags, "proxy.config.cluster.sock_option_flag");
   REC_ReadConfigInteger(cluster_packet_mark, "proxy.config.cluster.sock_packet_mark");
   REC_ReadConfigInteger(cluster_packet_tos, "proxy.config.cluster.sock_packet_tos");
   REC_EstablishStaticConfigInt32(RPC_only_CacheCluster, "proxy.config.cluster.rpc_cache_cluster");
 
+  // Every machine must build the same hash table, so these are read once.
+  REC_ReadConfigInteger(rendezvousClusterHash, "proxy.config.cluster.rendezvous_hash");
+  char *hash_weights = REC_ConfigReadString("proxy.config.cluster.hash_weights");
+  cluster_hash_set_weights(hash_weights);
+  ats_free(hash_weights);
+
   int cluster_type = 0;
   REC_ReadConfigInteger(cluster_type, "proxy.local.cluster.type");
 
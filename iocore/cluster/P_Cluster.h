@@ -119,6 +119,7 @@ enum {
   CLUSTER_SETDATA_NO_CLUSTER_STAT,
   CLUSTER_VC_READ_LIST_LEN_STAT,
   CLUSTER_VC_WRITE_LIST_LEN_STAT,
+  CLUSTER_WRITE_BATCH_DELAYS_STAT,
   cluster_stat_count
 };
 
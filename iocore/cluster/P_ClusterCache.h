@@ -1136,8 +1136,18 @@ ClusterConfiguration *configuration_remove_machine(ClusterConfiguration *c, Clus
 extern bool machineClusterHash;
 extern bool boundClusterHash;
 extern bool randClusterHash;
+extern bool rendezvousClusterHash;
+
+struct ClusterHashNode {
+  unsigned int ip;
+  int port;
+  int weight;
+};
 
 void build_cluster_hash_table(ClusterConfiguration *);
+void build_hash_table_rendezvous(unsigned char *hash_table, ClusterHashNode *nodes, int n_nodes);
+void cluster_hash_set_weights(const char *spec);
+int cluster_hash_weight(unsigned int ip, int port);
 
 inline void
 ClusterVC_enqueue_read(Queue<ClusterVConnectionBase, ClusterVConnectionBase::Link_read_link> &q, ClusterVConnectionBase *vc)
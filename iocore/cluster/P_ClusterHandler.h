@@ -469,6 +469,7 @@ struct ClusterHandler : public ClusterHandlerBase {
   ClusterCalloutContinuation *callout_cont[MAX_COMPLETION_CALLBACK_EVENTS];
   Event *callout_events[MAX_COMPLETION_CALLBACK_EVENTS];
   Event *cluster_periodic_event;
+  Event *write_batch_event;
   Queue<OutgoingControl> outgoing_control[CLUSTER_CMSG_QUEUES];
   Queue<IncomingControl> incoming_control;
   InkAtomicList read_vcs_ready;
@@ -617,6 +618,7 @@ struct ClusterHandler : public ClusterHandlerBase {
   int build_write_descriptors();
   int build_freespace_descriptors();
   int build_controlmsg_descriptors();
+  bool control_batch_ready(ink_hrtime now);
   int add_small_controlmsg_descriptors();
   int valid_for_data_write(ClusterVConnection *vc);
   int valid_for_freespace_write(ClusterVConnection *vc);
@@ -505,6 +505,7 @@ extern ClassAllocator<ByteBankDescriptor> byteBankAllocator;
 
 // Cluster configuration declarations
 extern int cluster_port;
+extern int cluster_write_batch_usecs;
 // extern void * machine_config_change(void *, void *);
 int machine_config_change(const char *, RecDataT, RecData, void *);
 extern void do_machine_config_change(void *, const char *);
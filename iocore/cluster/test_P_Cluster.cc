@@ -22,15 +22,21 @@
  */
 
 /*
-  This is a bogus test file because it does not need any cluster
-  functions : the actual test file is in the cache directory.
-  This file is a placeholder because each module is supposed to
-  have a test file
+  Cluster transport benchmark.
+
+  Start two instances configured as members of the same cluster (for a
+  single host, build with LOCAL_CLUSTER_TEST_MODE and give each instance
+  its own proxy.config.cluster.cluster_port).  Each instance waits for
+  its peer to come online and then keeps a window of cluster_ping()
+  messages outstanding, recording the round trip time of every reply.
+  When done it reports messages per second and latency percentiles, so
+  that proxy.config.cluster.write_batch_usecs settings can be compared.
+
+  usage: test_P_Cluster [messages [window [message_bytes]]]
   */
 
 #include "P_Cluster.h"
-#include <iostream.h>
-#include <fstream.h>
+#include <algorithm>
 
 Diags *diags;
 #define DIAGS_LOG_FILE "diags.log"
@@ -97,7 +103,7 @@ reconfigure_diags()
 
 
 static void
-init_diags(char *bdt, char *bat)
+init_diags(const char *bdt, const char *bat)
 {
   FILE *diags_log_fp;
   char diags_logpath[500];
@@ -116,29 +122,130 @@ init_diags(char *bdt, char *bat)
   diags = new Diags(bdt, bat, diags_log_fp);
 
   if (diags_log_fp == NULL) {
-    SrcLoc loc(__FILE__, __FUNCTION__, __LINE__);
-
-    diags->print(NULL, DL_Warning, NULL, &loc, "couldn't open diags log file '%s', "
-                                               "will not log to this file",
-                 diags_logpath);
+    Warning("couldn't open diags log file '%s', "
+            "will not log to this file",
+            diags_logpath);
   }
 
-  diags->print(NULL, DL_Status, "STATUS", NULL, "opened %s", diags_logpath);
+  Status("opened %s", diags_logpath);
   reconfigure_diags();
 }
 
 
+struct ClusterBench;
+static ClusterBench *bench;
+
+struct ClusterBench : public Continuation {
+  int n_msgs;
+  int window;
+  int msg_bytes;
+  int sent;
+  int received;
+  ink_hrtime start;
+  ink_hrtime *rtt;
+  ClusterHandler *ch;
+
+  ClusterBench(int n, int w, int b)
+    : Continuation(new_ProxyMutex()), n_msgs(n), window(w), msg_bytes(std::max(b, (int)sizeof(ink_hrtime))), sent(0),
+      received(0), start(0), rtt(NULL), ch(NULL)
+  {
+    rtt = (ink_hrtime *)ats_malloc(n_msgs * sizeof(ink_hrtime));
+    SET_HANDLER(&ClusterBench::waitForPeer);
+  }
+
+  void
+  send_one()
+  {
+    char *buf = (char *)alloca(msg_bytes);
+    memset(buf, 0, msg_bytes);
+    *(ink_hrtime *)buf = ink_get_hrtime();
+    sent++;
+    cluster_ping(ch, &ClusterBench::reply, buf, msg_bytes);
+  }
+
+  static void
+  reply(ClusterHandler * /* ch ATS_UNUSED */, void *data, int /* len ATS_UNUSED */)
+  {
+    // Runs on the cluster thread with the ClusterHandler locked
+    bench->rtt[bench->received++] = ink_get_hrtime() - *(ink_hrtime *)data;
+    if (bench->sent < bench->n_msgs) {
+      bench->send_one();
+    } else if (bench->received == bench->n_msgs) {
+      bench->report();
+      _exit(0);
+    }
+  }
+
+  ink_hrtime
+  percentile(double p)
+  {
+    int i = (int)(p * (received - 1));
+    return rtt[i];
+  }
+
+  void
+  report()
+  {
+    ink_hrtime elapsed = ink_get_hrtime() - start;
+    std::sort(rtt, rtt + received);
+    printf("messages %d, window %d, bytes %d, write_batch_usecs %d\n", received, window, msg_bytes, cluster_write_batch_usecs);
+    printf("throughput %.0f msgs/sec\n", (double)received * HRTIME_SECOND / (elapsed ? elapsed : 1));
+    printf("latency usecs p50 %" PRId64 " p90 %" PRId64 " p99 %" PRId64 " p99.9 %" PRId64 " max %" PRId64 "\n",
+           (int64_t)ink_hrtime_to_usec(percentile(0.50)), (int64_t)ink_hrtime_to_usec(percentile(0.90)),
+           (int64_t)ink_hrtime_to_usec(percentile(0.99)), (int64_t)ink_hrtime_to_usec(percentile(0.999)),
+           (int64_t)ink_hrtime_to_usec(rtt[received - 1]));
+  }
+
+  int
+  waitForPeer(int /* event ATS_UNUSED */, Event *e)
+  {
+    ClusterConfiguration *cc = this_cluster()->current_configuration();
+    ClusterMachine *me = this_cluster_machine();
+
+    for (int i = 0; cc && i < cc->n_machines; i++) {
+      ClusterMachine *m = cc->machines[i];
+      if (m != me && (ch = m->pop_ClusterHandler())) {
+        break;
+      }
+    }
+    if (!ch) {
+      e->schedule_in(HRTIME_MSECONDS(100));
+      return EVENT_CONT;
+    }
+    MUTEX_TRY_LOCK(lock, ch->mutex, e->ethread);
+    if (!lock.is_locked()) {
+      ch = NULL;
+      e->schedule_in(HRTIME_MSECONDS(1));
+      return EVENT_CONT;
+    }
+    start = ink_get_hrtime();
+    for (int i = 0; i < window && sent < n_msgs; i++) {
+      send_one();
+    }
+    return EVENT_DONE;
+  }
+};
+
 int
 main(int argc, char *argv[])
 {
-  int i;
   int num_net_threads = ink_number_of_processors();
+  int n_msgs = argc > 1 ? atoi(argv[1]) : 100000;
+  int window = argc > 2 ? atoi(argv[2]) : 64;
+  int msg_bytes = argc > 3 ? atoi(argv[3]) : 64;
+
   init_diags("", NULL);
   RecProcessInit(RECM_STAND_ALONE);
   ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
+  ink_net_init(makeModuleVersion(1, 0, PRIVATE_MODULE_HEADER));
   eventProcessor.start(num_net_threads);
+  netProcessor.start(0, DEFAULT_STACKSIZE);
   RecProcessStart();
-  // ink_aio_init(AIO_MODULE_VERSION);
+  clusterProcessor.init();
+  clusterProcessor.start();
+
+  bench = new ClusterBench(n_msgs, std::max(window, 1), msg_bytes);
+  eventProcessor.schedule_in(bench, HRTIME_MSECONDS(100), ET_CLUSTER);
 
   this_thread()->execute();
 }
@@ -46,6 +46,7 @@ int dns_failover_number = DEFAULT_FAILOVER_NUMBER;
 int dns_failover_period = DEFAULT_FAILOVER_PERIOD;
 int dns_failover_try_period = DEFAULT_FAILOVER_TRY_PERIOD;
 int dns_max_dns_in_flight = MAX_DNS_IN_FLIGHT;
+int dns_retransmit_min_timeout = 0;
 int dns_validate_qname = 0;
 unsigned int dns_handler_initialized = 0;
 int dns_ns_rr = 0;
@@ -184,6 +185,7 @@ DNSProcessor::start(int, size_t stacksize)
   REC_EstablishStaticConfigInt32(dns_failover_number, "proxy.config.dns.failover_number");
   REC_EstablishStaticConfigInt32(dns_failover_period, "proxy.config.dns.failover_period");
   REC_EstablishStaticConfigInt32(dns_max_dns_in_flight, "proxy.config.dns.max_dns_in_flight");
+  REC_EstablishStaticConfigInt32(dns_retransmit_min_timeout, "proxy.config.dns.retransmit_min_timeout");
   REC_EstablishStaticConfigInt32(dns_validate_qname, "proxy.config.dns.validate_query_name");
   REC_EstablishStaticConfigInt32(dns_ns_rr, "proxy.config.dns.round_robin_nameservers");
   REC_ReadConfigStringAlloc(dns_ns_list, "proxy.config.dns.nameservers");
@@ -1001,7 +1003,7 @@ write_dns_event(DNSHandler *h, DNSEntry *e)
   if (h->txn_lookup_timeout) {
     e->timeout = h->mutex->thread_holding->schedule_in(e, HRTIME_MSECONDS(h->txn_lookup_timeout)); // this is in msec
   } else {
-    e->timeout = h->mutex->thread_holding->schedule_in(e, HRTIME_SECONDS(dns_timeout));
+    e->timeout = h->mutex->thread_holding->schedule_in(e, h->retransmit_timeout(h->name_server, dns_retries - e->retries, !e->retries));
   }
 
   Debug("dns", "sent qname = %s, id = %u, nameserver = %d", e->qname, e->id[dns_retries - e->retries], h->name_server);
@@ -1056,6 +1058,7 @@ DNSEntry::mainEvent(int event, Event *e)
     DNSEntry *dup = get_entry(dnsH, qname, qtype);
     if (dup) {
       Debug("dns", "collapsing NS request");
+      DNS_INCREMENT_DYN_STAT(dns_coalesced_lookups_stat);
       dup->dups.enqueue(this);
     } else {
       Debug("dns", "adding first to collapsing queue");
@@ -1279,7 +1282,8 @@ dns_process(DNSHandler *handler, HostEnt *buf, int len)
 {
   ProxyMutex *mutex = handler->mutex;
   HEADER *h = (HEADER *)(buf->buf);
-  DNSEntry *e = get_dns(handler, (uint16_t)ntohs(h->id));
+  uint16_t id = (uint16_t)ntohs(h->id);
+  DNSEntry *e = get_dns(handler, id);
   bool retry = false;
   bool server_ok = true;
   uint32_t temp_ttl = 0;
@@ -1300,6 +1304,14 @@ dns_process(DNSHandler *handler, HostEnt *buf, int len)
 
   DNS_SUM_DYN_STAT(dns_response_time_stat, ink_get_hrtime() - e->send_time);
 
+  // Only an answer to the latest transmission gives an unambiguous round trip time.
+  int attempt = dns_retries - e->retries;
+  if (e->which_ns >= 0 && e->which_ns < MAX_NAMED && attempt >= 0 && attempt < MAX_DNS_RETRIES && e->id[attempt] == id) {
+    ink_hrtime rtt = ink_get_hrtime() - e->send_time;
+    handler->received_rtt(e->which_ns, rtt);
+    RecIncrRawStat(dns_rsb, mutex->thread_holding, (int)dns_nameserver_rtt_stat + e->which_ns, rtt);
+  }
+
   if (h->rcode != NOERROR || !h->ancount) {
     Debug("dns", "received rcode = %d", h->rcode);
     switch (h->rcode) {
@@ -1641,6 +1653,16 @@ ink_dns_init(ModuleVersion v)
 
   RecRegisterRawStat(dns_rsb, RECT_PROCESS, "proxy.process.dns.in_flight", RECD_INT, RECP_NON_PERSISTENT, (int)dns_in_flight_stat,
                      RecRawStatSyncSum);
+
+  RecRegisterRawStat(dns_rsb, RECT_PROCESS, "proxy.process.dns.coalesced_lookups", RECD_INT, RECP_PERSISTENT,
+                     (int)dns_coalesced_lookups_stat, RecRawStatSyncSum);
+
+  for (int i = 0; i < MAX_NAMED; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "proxy.process.dns.nameserver.%d.rtt_avg_time", i);
+    RecRegisterRawStat(dns_rsb, RECT_PROCESS, name, RECD_FLOAT, RECP_NON_PERSISTENT, (int)dns_nameserver_rtt_stat + i,
+                       RecRawStatSyncMHrTimeAvg);
+  }
 }
 
 
@@ -57,6 +57,7 @@ extern int dns_failover_number;
 extern int dns_failover_period;
 extern int dns_failover_try_period;
 extern int dns_max_dns_in_flight;
+extern int dns_retransmit_min_timeout;
 extern unsigned int dns_sequence_number;
 
 //
@@ -101,7 +102,9 @@ enum DNS_Stats {
   dns_max_retries_exceeded_stat,
   dns_sequence_number_stat,
   dns_in_flight_stat,
-  DNS_Stat_Count
+  dns_coalesced_lookups_stat,
+  dns_nameserver_rtt_stat, // one slot per nameserver, up to MAX_NAMED
+  DNS_Stat_Count = dns_nameserver_rtt_stat + MAX_NAMED
 };
 
 struct HostEnt;
@@ -209,6 +212,8 @@ struct DNSHandler : public Continuation {
   ink_hrtime crossed_failover_number[MAX_NAMED];
   ink_hrtime last_primary_retry;
   ink_hrtime last_primary_reopen;
+  ink_hrtime ns_srtt[MAX_NAMED];   ///< Smoothed round trip time, 0 if not yet measured.
+  ink_hrtime ns_rttvar[MAX_NAMED]; ///< Round trip time variation.
 
   ink_res_state m_res;
   int txn_lookup_timeout;
@@ -251,6 +256,40 @@ struct DNSHandler : public Continuation {
              (HRTIME_SECONDS(dns_failover_try_period + failover_soon_number[i] * FAILOVER_SOON_RETRY))));
   }
 
+  /// Fold a measured round trip time for nameserver @a i into its estimate.
+  void
+  received_rtt(int i, ink_hrtime rtt)
+  {
+    if (!ns_srtt[i]) {
+      ns_srtt[i] = rtt;
+      ns_rttvar[i] = rtt / 2;
+    } else {
+      ink_hrtime delta = ns_srtt[i] > rtt ? ns_srtt[i] - rtt : rtt - ns_srtt[i];
+      ns_rttvar[i] = (3 * ns_rttvar[i] + delta) / 4;
+      ns_srtt[i] = (7 * ns_srtt[i] + rtt) / 8;
+    }
+  }
+
+  /** Time to wait for an answer from nameserver @a i before retransmitting.
+
+      Without @c proxy.config.dns.retransmit_min_timeout this is the fixed lookup timeout. Otherwise the
+      timeout follows the measured round trip time of the nameserver, doubled for every retransmission.
+      The last attempt always gets the full lookup timeout.
+  */
+  ink_hrtime
+  retransmit_timeout(int i, int attempt, bool last)
+  {
+    ink_hrtime max_timeout = HRTIME_SECONDS(dns_timeout);
+    if (!dns_retransmit_min_timeout || last)
+      return max_timeout;
+    ink_hrtime rto = ns_srtt[i] ? ns_srtt[i] + 4 * ns_rttvar[i] : HRTIME_SECOND;
+    if (rto < HRTIME_MSECONDS(dns_retransmit_min_timeout))
+      rto = HRTIME_MSECONDS(dns_retransmit_min_timeout);
+    for (; attempt > 0 && rto < max_timeout; --attempt)
+      rto *= 2;
+    return rto < max_timeout ? rto : max_timeout;
+  }
+
   void recv_dns(int event, Event *e);
   int startEvent(int event, Event *e);
   int startEvent_sdns(int event, Event *e);
@@ -327,6 +366,8 @@ DNSHandler::DNSHandler()
     failover_soon_number[i] = 0;
     crossed_failover_number[i] = 0;
     ns_down[i] = 1;
+    ns_srtt[i] = 0;
+    ns_rttvar[i] = 0;
     con[i].handler = this;
   }
   memset(&qid_in_flight, 0, sizeof(qid_in_flight));
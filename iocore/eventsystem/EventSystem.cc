@@ -35,6 +35,8 @@ ink_event_system_init(ModuleVersion v)
 {
   ink_release_assert(!checkModuleVersion(v, EVENT_SYSTEM_MODULE_VERSION));
   int config_max_iobuffer_size = DEFAULT_MAX_BUFFER_SIZE;
+  int config_iobuf_numa_arenas = 0;
+  int config_magazine_size = 0;
 
   // For backwards compatability make sure to allow thread_freelist_size
   // This needs to change in 6.0
@@ -42,6 +44,10 @@ ink_event_system_init(ModuleVersion v)
 
   REC_EstablishStaticConfigInt32(thread_freelist_low_watermark, "proxy.config.allocator.thread_freelist_low_watermark");
 
+  // Before the event threads start, so that every thread sees the same size.
+  REC_ReadConfigInteger(config_magazine_size, "proxy.config.allocator.magazine_size");
+  ink_freelist_magazines_init(config_magazine_size);
+
   REC_ReadConfigInteger(config_max_iobuffer_size, "proxy.config.io.max_buffer_size");
 
   max_iobuffer_size = buffer_size_to_index(config_max_iobuffer_size, DEFAULT_BUFFER_SIZES - 1);
@@ -49,5 +55,19 @@ ink_event_system_init(ModuleVersion v)
     default_small_iobuffer_size = max_iobuffer_size;
   if (default_large_iobuffer_size > max_iobuffer_size)
     default_large_iobuffer_size = max_iobuffer_size;
+
+  REC_ReadConfigInteger(config_iobuf_numa_arenas, "proxy.config.allocator.iobuf_numa_arenas");
+#if TS_USE_HWLOC
+  if (config_iobuf_numa_arenas) {
+    int nodes = hwloc_get_nbobjs_by_type(ink_get_topology(), HWLOC_OBJ_NODE);
+    if (nodes > MAX_IOBUFFER_NUMA_NODES) {
+      Warning("%d NUMA nodes, only the first %d get their own IOBuffer arena", nodes, MAX_IOBUFFER_NUMA_NODES);
+      nodes = MAX_IOBUFFER_NUMA_NODES;
+    }
+    if (nodes > 1)
+      iobuffer_numa_nodes = nodes;
+  }
+#endif
   init_buffer_allocators();
+  register_buffer_allocator_stats();
 }
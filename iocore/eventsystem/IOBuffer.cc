@@ -32,6 +32,8 @@
 // General Buffer Allocator
 //
 inkcoreapi Allocator ioBufAllocator[DEFAULT_BUFFER_SIZES];
+inkcoreapi Allocator *ioBufNodeAllocator[MAX_IOBUFFER_NUMA_NODES];
+int iobuffer_numa_nodes = 1;
 inkcoreapi ClassAllocator<MIOBuffer> ioAllocator("ioAllocator", DEFAULT_BUFFER_NUMBER);
 inkcoreapi ClassAllocator<IOBufferData> ioDataAllocator("ioDataAllocator", DEFAULT_BUFFER_NUMBER);
 inkcoreapi ClassAllocator<IOBufferBlock> ioBlockAllocator("ioBlockAllocator", DEFAULT_BUFFER_NUMBER);
@@ -52,16 +54,60 @@ init_buffer_allocators()
   advice = MADV_DONTDUMP;
 #endif
 
-  for (int i = 0; i < DEFAULT_BUFFER_SIZES; i++) {
-    int64_t s = DEFAULT_BUFFER_BASE_SIZE * (((int64_t)1) << i);
-    int64_t a = DEFAULT_BUFFER_ALIGNMENT;
-    int n = i <= default_large_iobuffer_size ? DEFAULT_BUFFER_NUMBER : DEFAULT_HUGE_BUFFER_NUMBER;
-    if (s < a)
-      a = s;
+  ioBufNodeAllocator[0] = ioBufAllocator;
+  for (int node = 1; node < iobuffer_numa_nodes; node++)
+    ioBufNodeAllocator[node] = new Allocator[DEFAULT_BUFFER_SIZES];
 
-    name = new char[64];
-    snprintf(name, 64, "ioBufAllocator[%d]", i);
-    ioBufAllocator[i].re_init(name, s, n, a, advice);
+  for (int node = 0; node < iobuffer_numa_nodes; node++) {
+    for (int i = 0; i < DEFAULT_BUFFER_SIZES; i++) {
+      int64_t s = DEFAULT_BUFFER_BASE_SIZE * (((int64_t)1) << i);
+      int64_t a = DEFAULT_BUFFER_ALIGNMENT;
+      int n = i <= default_large_iobuffer_size ? DEFAULT_BUFFER_NUMBER : DEFAULT_HUGE_BUFFER_NUMBER;
+      if (s < a)
+        a = s;
+
+      name = new char[64];
+      if (iobuffer_numa_nodes > 1) {
+        snprintf(name, 64, "ioBufAllocator[%d][%d]", node, i);
+        ioBufNodeAllocator[node][i].re_init(name, s, n, a, advice, node);
+      } else {
+        snprintf(name, 64, "ioBufAllocator[%d]", i);
+        ioBufAllocator[i].re_init(name, s, n, a, advice);
+      }
+    }
+  }
+}
+
+//
+// Occupancy of each size index of each arena, in blocks.
+//
+static int
+buffer_allocator_stat_sync(const char * /* name ATS_UNUSED */, RecDataT /* data_type ATS_UNUSED */, RecData *data,
+                           RecRawStatBlock * /* rsb ATS_UNUSED */, int id)
+{
+  Allocator &a = ioBufNodeAllocator[id / 2 / DEFAULT_BUFFER_SIZES][id / 2 % DEFAULT_BUFFER_SIZES];
+
+  data->rec_int = (id & 1) ? a.in_use() : a.allocated();
+  return REC_ERR_OKAY;
+}
+
+void
+register_buffer_allocator_stats()
+{
+  RecRawStatBlock *rsb = RecAllocateRawStatBlock(iobuffer_numa_nodes * DEFAULT_BUFFER_SIZES * 2);
+  char name[128];
+
+  for (int node = 0; node < iobuffer_numa_nodes; node++) {
+    for (int i = 0; i < DEFAULT_BUFFER_SIZES; i++) {
+      int id = (node * DEFAULT_BUFFER_SIZES + i) * 2;
+
+      snprintf(name, sizeof(name), "proxy.process.iobuffer.node_%d.size_%" PRId64 ".allocated", node,
+               (int64_t)BUFFER_SIZE_FOR_INDEX(i));
+      RecRegisterRawStat(rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT, id, buffer_allocator_stat_sync);
+      snprintf(name, sizeof(name), "proxy.process.iobuffer.node_%d.size_%" PRId64 ".in_use", node,
+               (int64_t)BUFFER_SIZE_FOR_INDEX(i));
+      RecRegisterRawStat(rsb, RECT_PROCESS, name, RECD_INT, RECP_NON_PERSISTENT, id + 1, buffer_allocator_stat_sync);
+    }
   }
 }
 
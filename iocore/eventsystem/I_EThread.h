@@ -297,6 +297,7 @@ public:
 
   int id;
   unsigned int event_types;
+  int numa_node; ///< IOBuffer arena of the thread, the NUMA node it is bound to.
   bool is_event_type(EventType et);
   void set_event_type(EventType et);
 
@@ -124,9 +124,18 @@ enum AllocType {
 #define BUFFER_SIZE_FOR_CONSTANT(_size) (_size - DEFAULT_BUFFER_SIZES)
 #define BUFFER_SIZE_INDEX_FOR_CONSTANT_SIZE(_size) (_size + DEFAULT_BUFFER_SIZES)
 
+#define MAX_IOBUFFER_NUMA_NODES 8
+
 inkcoreapi extern Allocator ioBufAllocator[DEFAULT_BUFFER_SIZES];
 
+// IOBuffer memory is kept in one arena per NUMA node, each holding one
+// allocator per size index. Arena 0 is ioBufAllocator, and the only one
+// unless proxy.config.allocator.iobuf_numa_arenas is set.
+inkcoreapi extern Allocator *ioBufNodeAllocator[MAX_IOBUFFER_NUMA_NODES];
+extern int iobuffer_numa_nodes;
+
 void init_buffer_allocators();
+void register_buffer_allocator_stats();
 
 /**
   A reference counted wrapper around fast allocated or malloced memory.
@@ -251,6 +260,14 @@ public:
   */
   char *_data;
 
+  /**
+    Arena of ioBufNodeAllocator the memory came from when it is fast
+    allocated, so that it is returned to the NUMA node it was placed on
+    no matter which thread frees it.
+
+  */
+  int _node;
+
 #ifdef TRACK_BUFFER_USER
   const char *_location;
 #endif
@@ -261,7 +278,7 @@ public:
 
   */
   IOBufferData()
-    : _size_index(BUFFER_SIZE_NOT_ALLOCATED), _mem_type(NO_ALLOC), _data(NULL)
+    : _size_index(BUFFER_SIZE_NOT_ALLOCATED), _mem_type(NO_ALLOC), _data(NULL), _node(0)
 #ifdef TRACK_BUFFER_USER
       ,
       _location(NULL)
@@ -133,7 +133,9 @@ public:
   ProxyAllocator httpClientSessionAllocator;
   ProxyAllocator httpServerSessionAllocator;
   ProxyAllocator hdrHeapAllocator;
+  ProxyAllocator hdrHeapLargeAllocator;
   ProxyAllocator strHeapAllocator;
+  ProxyAllocator strHeapLargeAllocator;
   ProxyAllocator cacheVConnectionAllocator;
   ProxyAllocator openDirEntryAllocator;
   ProxyAllocator ramCacheCLFUSEntryAllocator;
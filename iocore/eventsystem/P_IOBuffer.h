@@ -56,6 +56,14 @@ iobuffer_size_to_index(int64_t size, int64_t max)
   return buffer_size_to_index(size, max);
 }
 
+// The ioBufNodeAllocator arena for memory allocated by the calling thread.
+TS_INLINE int
+iobuffer_thread_node()
+{
+  EThread *t = this_ethread();
+  return t ? t->numa_node : 0;
+}
+
 TS_INLINE int64_t
 index_to_buffer_size(int64_t idx)
 {
@@ -270,10 +278,11 @@ IOBufferData::alloc(int64_t size_index, AllocType type)
 #ifdef TRACK_BUFFER_USER
   iobuffer_mem_inc(_location, size_index);
 #endif
+  _node = iobuffer_numa_nodes > 1 ? iobuffer_thread_node() : 0;
   switch (type) {
   case MEMALIGNED:
     if (BUFFER_SIZE_INDEX_IS_FAST_ALLOCATED(size_index))
-      _data = (char *)ioBufAllocator[size_index].alloc_void();
+      _data = (char *)ioBufNodeAllocator[_node][size_index].alloc_void();
     // coverity[dead_error_condition]
     else if (BUFFER_SIZE_INDEX_IS_XMALLOCED(size_index))
       _data = (char *)ats_memalign(ats_pagesize(), index_to_buffer_size(size_index));
@@ -281,7 +290,7 @@ IOBufferData::alloc(int64_t size_index, AllocType type)
   default:
   case DEFAULT_ALLOC:
     if (BUFFER_SIZE_INDEX_IS_FAST_ALLOCATED(size_index))
-      _data = (char *)ioBufAllocator[size_index].alloc_void();
+      _data = (char *)ioBufNodeAllocator[_node][size_index].alloc_void();
     else if (BUFFER_SIZE_INDEX_IS_XMALLOCED(size_index))
       _data = (char *)ats_malloc(BUFFER_SIZE_FOR_XMALLOC(size_index));
     break;
@@ -300,14 +309,14 @@ IOBufferData::dealloc()
   switch (_mem_type) {
   case MEMALIGNED:
     if (BUFFER_SIZE_INDEX_IS_FAST_ALLOCATED(_size_index))
-      ioBufAllocator[_size_index].free_void(_data);
+      ioBufNodeAllocator[_node][_size_index].free_void(_data);
     else if (BUFFER_SIZE_INDEX_IS_XMALLOCED(_size_index))
       ::free((void *)_data);
     break;
   default:
   case DEFAULT_ALLOC:
     if (BUFFER_SIZE_INDEX_IS_FAST_ALLOCATED(_size_index))
-      ioBufAllocator[_size_index].free_void(_data);
+      ioBufNodeAllocator[_node][_size_index].free_void(_data);
     else if (BUFFER_SIZE_INDEX_IS_XMALLOCED(_size_index))
       ats_free(_data);
     break;
@@ -315,6 +324,7 @@ IOBufferData::dealloc()
   _data = 0;
   _size_index = BUFFER_SIZE_NOT_ALLOCATED;
   _mem_type = NO_ALLOC;
+  _node = 0;
 }
 
 TS_INLINE void
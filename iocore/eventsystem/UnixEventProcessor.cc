@@ -65,6 +65,23 @@ EventProcessor::spawn_event_threads(int n_threads, const char *et_name, size_t s
 
 class EventProcessor eventProcessor;
 
+#if TS_USE_HWLOC
+// The IOBuffer arena for a thread bound to @a obj: the NUMA node holding
+// the first processor of @a obj.
+static int
+numa_node_of(hwloc_obj_t obj)
+{
+  int cpu = hwloc_bitmap_first(obj->cpuset);
+
+  for (int n = 0; cpu >= 0 && n < iobuffer_numa_nodes; n++) {
+    hwloc_obj_t node = hwloc_get_obj_by_type(ink_get_topology(), HWLOC_OBJ_NODE, n);
+    if (node && hwloc_bitmap_isset(node->cpuset, cpu))
+      return n;
+  }
+  return 0;
+}
+#endif
+
 int
 EventProcessor::start(int n_event_threads, size_t stacksize)
 {
@@ -151,6 +168,8 @@ EventProcessor::start(int n_event_threads, size_t stacksize)
       Debug("iocore_thread", "EThread: %d %s: %d\n", i, obj_name, obj->logical_index);
 #endif // HWLOC_API_VERSION
       hwloc_set_thread_cpubind(ink_get_topology(), tid, obj->cpuset, HWLOC_CPUBIND_STRICT);
+      if (obj_type != HWLOC_OBJ_MACHINE)
+        all_ethreads[i]->numa_node = numa_node_of(obj);
     } else {
       Warning("hwloc returned an unexpected value -- CPU affinity disabled");
     }
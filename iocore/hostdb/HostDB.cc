@@ -49,6 +49,7 @@ int hostdb_cluster_round_robin = false;
 int hostdb_lookup_timeout = 120;
 int hostdb_insert_timeout = 160;
 int hostdb_re_dns_on_reload = false;
+int hostdb_parallel_family_lookup = false;
 int hostdb_ttl_mode = TTL_OBEY;
 unsigned int hostdb_current_interval = 0;
 unsigned int hostdb_ip_stale_interval = HOST_DB_IP_STALE;
@@ -67,6 +68,11 @@ int hostdb_disable_reverse_lookup = 0;
 
 ClassAllocator<HostDBContinuation> hostDBContAllocator("hostDBContAllocator");
 
+#if TS_HAS_TESTS
+// Set by regressions to answer forward lookups in place of the DNS processor.
+static Action *(*hostdb_test_gethostbyname)(Continuation *cont, const char *name, DNSProcessor::Options const &opt) = NULL;
+#endif
+
 // Static configuration information
 
 HostDBCache hostDB;
@@ -415,6 +421,7 @@ HostDBCache::start(int flags)
   Span *hostDBSpan;
   char storage_path[PATH_NAME_MAX];
   int storage_size = 33554432; // 32MB default
+  int snapshot_sync = 0;
 
   bool reconfigure = ((flags & PROCESSOR_RECONFIGURE) ? true : false);
   bool fix = ((flags & PROCESSOR_FIX) ? true : false);
@@ -430,6 +437,8 @@ HostDBCache::start(int flags)
   REC_ReadConfigInt32(hostdb_srv_enabled, "proxy.config.srv_enabled");
   REC_ReadConfigString(storage_path, "proxy.config.hostdb.storage_path", sizeof(storage_path));
   REC_ReadConfigInt32(storage_size, "proxy.config.hostdb.storage_size");
+  REC_ReadConfigInt32(snapshot_sync, "proxy.config.cache.hostdb.sync_snapshot");
+  snapshot = snapshot_sync != 0;
 
   // If proxy.config.hostdb.storage_path is not set, use the local state dir. If it is set to
   // a relative path, make it relative to the prefix.
@@ -508,6 +517,7 @@ HostDBProcessor::start(int, size_t)
   REC_EstablishStaticConfigInt32(hostdb_ttl_mode, "proxy.config.hostdb.ttl_mode");
   REC_EstablishStaticConfigInt32(hostdb_disable_reverse_lookup, "proxy.config.cache.hostdb.disable_reverse_lookup");
   REC_EstablishStaticConfigInt32(hostdb_re_dns_on_reload, "proxy.config.hostdb.re_dns_on_reload");
+  REC_EstablishStaticConfigInt32(hostdb_parallel_family_lookup, "proxy.config.hostdb.parallel_family_lookup");
   REC_EstablishStaticConfigInt32(hostdb_migrate_on_demand, "proxy.config.hostdb.migrate_on_demand");
   REC_EstablishStaticConfigInt32(hostdb_strict_round_robin, "proxy.config.hostdb.strict_round_robin");
   REC_EstablishStaticConfigInt32(hostdb_timed_round_robin, "proxy.config.hostdb.timed_round_robin");
@@ -1900,7 +1910,33 @@ HostDBContinuation::do_dns()
     if (is_byname()) {
       if (md5.dns_server)
         opt.handler = md5.dns_server->x_dnsH;
-      pending_action = dnsProcessor.gethostbyname(this, md5.host_name, opt);
+#if TS_HAS_TESTS
+      if (hostdb_test_gethostbyname)
+        pending_action = hostdb_test_gethostbyname(this, md5.host_name, opt);
+      else
+#endif
+        pending_action = dnsProcessor.gethostbyname(this, md5.host_name, opt);
+      // Look up the fallback family alongside the preferred one so a failure
+      // of the latter finds the former already in the database or in flight.
+      if (hostdb_parallel_family_lookup && action.continuation && md5.db_mark == db_mark_for(host_res_style)) {
+        HostDBMark alt_mark = md5.db_mark;
+        if (check_for_retry(alt_mark, host_res_style)) {
+          HostDBContinuation *c = hostDBContAllocator.alloc();
+          HostDBContinuation::Options copt;
+          copt.host_res_style = host_res_style_for(alt_mark);
+          copt.timeout = dns_lookup_timeout;
+          c->init(md5, copt);
+          c->md5.db_mark = alt_mark;
+          // Not refresh_MD5(): @a c still carries our hash, and triggering the
+          // pending queue for it would wake us and our waiters mid-query.
+          c->md5.refresh();
+          c->mutex = hostDB.lock_for_bucket((int)(fold_md5(c->md5.hash) % hostDB.buckets));
+          c->action.mutex = c->mutex;
+          SET_CONTINUATION_HANDLER(c, (HostDBContHandler)&HostDBContinuation::probeEvent);
+          mutex->thread_holding->schedule_imm(c);
+          HOSTDB_INCREMENT_DYN_STAT(hostdb_parallel_family_lookups_stat);
+        }
+      }
     } else if (is_srv()) {
       Debug("dns_srv", "SRV lookup of %s", md5.host_name);
       pending_action = dnsProcessor.getSRVbyname(this, md5.host_name, opt);
@@ -2486,6 +2522,9 @@ ink_hostdb_init(ModuleVersion v)
   RecRegisterRawStat(hostdb_rsb, RECT_PROCESS, "proxy.process.hostdb.re_dns_on_reload", RECD_INT, RECP_PERSISTENT,
                      (int)hostdb_re_dns_on_reload_stat, RecRawStatSyncSum);
 
+  RecRegisterRawStat(hostdb_rsb, RECT_PROCESS, "proxy.process.hostdb.parallel_family_lookups", RECD_INT, RECP_PERSISTENT,
+                     (int)hostdb_parallel_family_lookups_stat, RecRawStatSyncSum);
+
   RecRegisterRawStat(hostdb_rsb, RECT_PROCESS, "proxy.process.hostdb.bytes", RECD_INT, RECP_PERSISTENT, (int)hostdb_bytes_stat,
                      RecRawStatSyncCount);
 
@@ -2830,3 +2869,146 @@ ParseHostFile(char const *path)
   if (!success)
     HostDBFileUpdateActive = 0;
 }
+
+#if TS_HAS_TESTS
+struct HostDBRegressionContinuation;
+typedef int (HostDBRegressionContinuation::*HostDBRegContHandler)(int, void *);
+
+static const int HOSTDB_REGRESSION_WAITERS = 8;
+static int hostdb_regression_queries[2]; // by family, IPv4 then IPv6
+
+// Stands in for the DNS processor: answers each query as a failure a little
+// later, as for a name that does not resolve, without using the network.
+struct HostDBRegressionResolver : public Continuation {
+  Action action;
+
+  int
+  mainEvent(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    if (!action.cancelled)
+      action.continuation->handleEvent(DNS_EVENT_LOOKUP, NULL);
+    delete this;
+    return EVENT_DONE;
+  }
+
+  HostDBRegressionResolver(Continuation *cont) : Continuation(cont->mutex)
+  {
+    action = cont;
+    SET_HANDLER(&HostDBRegressionResolver::mainEvent);
+  }
+};
+
+static Action *
+hostdb_regression_gethostbyname(Continuation *cont, const char * /* name ATS_UNUSED */, DNSProcessor::Options const &opt)
+{
+  HostDBRegressionResolver *resolver = new HostDBRegressionResolver(cont);
+
+  ++hostdb_regression_queries[opt.host_res_style == HOST_RES_IPV6_ONLY];
+  eventProcessor.schedule_in(resolver, HRTIME_MSECONDS(200), ET_NET);
+  return &resolver->action;
+}
+
+// One outstanding lookup; counts how often HostDB answers it.
+struct HostDBRegressionWaiter : public Continuation {
+  int replies;
+
+  int
+  mainEvent(int event, void * /* data ATS_UNUSED */)
+  {
+    if (event == EVENT_HOST_DB_LOOKUP)
+      ++replies;
+    return EVENT_DONE;
+  }
+
+  HostDBRegressionWaiter(ProxyMutex *m) : Continuation(m), replies(0) { SET_HANDLER(&HostDBRegressionWaiter::mainEvent); }
+};
+
+// Several lookups of one name coalesce behind a single DNS query while the
+// other address family is looked up in parallel; each must be answered once.
+struct HostDBRegressionContinuation : public Continuation {
+  RegressionTest *test;
+  int *status;
+  int saved_parallel_family_lookup;
+  ink_hrtime deadline;
+  HostDBRegressionWaiter *waiters[HOSTDB_REGRESSION_WAITERS];
+
+  int
+  startEvent(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    HostDBProcessor::Options opt;
+
+    saved_parallel_family_lookup = hostdb_parallel_family_lookup;
+    hostdb_parallel_family_lookup = 1;
+    hostdb_regression_queries[0] = hostdb_regression_queries[1] = 0;
+    hostdb_test_gethostbyname = hostdb_regression_gethostbyname;
+
+    opt.flags = HostDBProcessor::HOSTDB_FORCE_DNS_ALWAYS;
+    opt.host_res_style = HOST_RES_IPV4;
+    for (int i = 0; i < HOSTDB_REGRESSION_WAITERS; ++i) {
+      waiters[i] = new HostDBRegressionWaiter(mutex);
+      hostDBProcessor.getbyname_re(waiters[i], "parallel-family.hostdb.regression.test", 0, opt);
+    }
+
+    deadline = ink_get_hrtime() + HRTIME_SECONDS(hostdb_lookup_timeout + 5);
+    SET_HANDLER((HostDBRegContHandler)&HostDBRegressionContinuation::waitEvent);
+    eventProcessor.schedule_in(this, HRTIME_MSECONDS(100), ET_NET);
+    return EVENT_DONE;
+  }
+
+  // Wait for every lookup to be answered, then linger so that a second
+  // (late) answer to any of them is seen as well.
+  int
+  waitEvent(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    int answered = 0;
+
+    for (int i = 0; i < HOSTDB_REGRESSION_WAITERS; ++i) {
+      if (waiters[i]->replies)
+        ++answered;
+    }
+    if (answered < HOSTDB_REGRESSION_WAITERS && ink_get_hrtime() < deadline) {
+      eventProcessor.schedule_in(this, HRTIME_MSECONDS(100), ET_NET);
+    } else {
+      SET_HANDLER((HostDBRegContHandler)&HostDBRegressionContinuation::checkEvent);
+      eventProcessor.schedule_in(this, HRTIME_SECONDS(2), ET_NET);
+    }
+    return EVENT_DONE;
+  }
+
+  int
+  checkEvent(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    *status = REGRESSION_TEST_PASSED;
+    for (int i = 0; i < HOSTDB_REGRESSION_WAITERS; ++i) {
+      if (waiters[i]->replies != 1) {
+        rprintf(test, "lookup %d answered %d times\n", i, waiters[i]->replies);
+        *status = REGRESSION_TEST_FAILED;
+      }
+      delete waiters[i];
+    }
+    if (!hostdb_regression_queries[0] || !hostdb_regression_queries[1]) {
+      rprintf(test, "%d IPv4 and %d IPv6 queries, expected both families\n", hostdb_regression_queries[0],
+              hostdb_regression_queries[1]);
+      *status = REGRESSION_TEST_FAILED;
+    }
+
+    hostdb_test_gethostbyname = NULL;
+    hostdb_parallel_family_lookup = saved_parallel_family_lookup;
+    delete this;
+    return EVENT_DONE;
+  }
+
+  HostDBRegressionContinuation(RegressionTest *t, int *astatus)
+    : Continuation(new_ProxyMutex()), test(t), status(astatus), saved_parallel_family_lookup(0), deadline(0)
+  {
+    SET_HANDLER((HostDBRegContHandler)&HostDBRegressionContinuation::startEvent);
+  }
+};
+
+REGRESSION_TEST(HostDBParallelFamilyWaiters)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_in(new HostDBRegressionContinuation(t, pstatus), HRTIME_SECONDS(1), ET_NET);
+}
+
+#endif
@@ -38,7 +38,8 @@
 static const int MC_SYNC_MIN_PAUSE_TIME = HRTIME_MSECONDS(200); // Pause for at least 200ms
 
 MultiCacheBase::MultiCacheBase()
-  : store(0), mapped_header(NULL), data(0), lowest_level_data(0), miss_stat(0), buckets_per_partitionF8(0)
+  : store(0), mapped_header(NULL), data(0), lowest_level_data(0), miss_stat(0), buckets_per_partitionF8(0), snapshot(false),
+    n_snapshot_fds(0)
 {
   filename[0] = 0;
   memset(hit_stat, 0, sizeof(hit_stat));
@@ -246,17 +247,25 @@ MultiCacheBase::mmap_region(int blocks, int *fds, char *cur, size_t &total_lengt
         unsigned int nbytes = b * STORE_BLOCK_SIZE;
         int fd = fds[p] ? fds[p] : zero_fill;
         ink_assert(-1 != fd);
-        int flags = private_flag ? MAP_PRIVATE : MAP_SHARED_MAP_NORESERVE;
+        int flags = (private_flag || snapshot) ? MAP_PRIVATE : MAP_SHARED_MAP_NORESERVE;
+        off_t offset = d->offset * STORE_BLOCK_SIZE;
 
         if (cur)
-          res = (char *)mmap(cur, nbytes, PROT_READ | PROT_WRITE, MAP_FIXED | flags, fd, d->offset * STORE_BLOCK_SIZE);
+          res = (char *)mmap(cur, nbytes, PROT_READ | PROT_WRITE, MAP_FIXED | flags, fd, offset);
         else
-          res = (char *)mmap(cur, nbytes, PROT_READ | PROT_WRITE, flags, fd, d->offset * STORE_BLOCK_SIZE);
+          res = (char *)mmap(cur, nbytes, PROT_READ | PROT_WRITE, flags, fd, offset);
 
         d->offset += b;
 
         if (res == NULL || res == (caddr_t)MAP_FAILED)
           return NULL;
+        if (snapshot && fds[p] > 0) {
+          MultiCacheSegment &seg = segments.add();
+          seg.addr = res;
+          seg.length = nbytes;
+          seg.fd = fds[p];
+          seg.offset = offset;
+        }
         ink_assert(!cur || res == cur);
         cur = res + nbytes;
         blocks -= b;
@@ -286,6 +295,12 @@ int
 MultiCacheBase::unmap_data()
 {
   int res = 0;
+  for (int i = 0; i < n_snapshot_fds; i++) {
+    if (snapshot_fds[i] > 0)
+      socketManager.close(snapshot_fds[i]);
+  }
+  n_snapshot_fds = 0;
+  segments.clear();
   if (data) {
     res = munmap(data, totalsize);
     data = NULL;
@@ -440,6 +455,12 @@ MultiCacheBase::mmap_data(bool private_flag, bool zero_fill)
     store = saved;
   }
 
+  // the backing files stay open for writing snapshots back
+  if (snapshot) {
+    memcpy(snapshot_fds, fds, sizeof(fds));
+    n_snapshot_fds = n_fds;
+    return 0;
+  }
 
   for (int i = 0; i < n_fds; i++) {
     if (fds[i] >= 0)
@@ -475,6 +496,7 @@ Labort:
     if (fds[i] >= 0)
       socketManager.close(fds[i]);
   }
+  segments.clear();
   if (total_mapped > 0)
     munmap(data, total_mapped);
 
@@ -865,9 +887,13 @@ MultiCacheBase::rebuild(MultiCacheBase &old, int kind)
     }
   if (scan & 0x7FFF)
     printf("done]\n");
-  if (r.rebuild || r.fix)
-    for (int p = 0; p < MULTI_CACHE_PARTITIONS; p++)
-      sync_partition(p);
+  if (r.rebuild || r.fix) {
+    if (snapshot) // nothing reaches the files unless written back
+      sync_all();
+    else
+      for (int p = 0; p < MULTI_CACHE_PARTITIONS; p++)
+        sync_partition(p);
+  }
 
   fprintf(diag_output_fp, "    Usage Summary\n");
   fprintf(diag_output_fp, "\tTotal:      %-10d\n", r.total);
@@ -913,11 +939,11 @@ MultiCacheBase::check(const char *config_filename, bool fix)
 }
 
 int
-MultiCacheBase::sync_heap(int part)
+MultiCacheBase::sync_heap(int part, MultiCacheStaging *staged)
 {
   if (heap_size) {
     int b_per_part = heap_size / MULTI_CACHE_PARTITIONS;
-    if (ats_msync(data + level_offset[2] + buckets * bucketsize[2] + b_per_part * part, b_per_part, data + totalsize, MS_SYNC) < 0)
+    if (sync_region(data + level_offset[2] + buckets * bucketsize[2] + b_per_part * part, b_per_part, staged) < 0)
       return -1;
   }
   return 0;
@@ -931,23 +957,23 @@ MultiCacheBase::sync_heap(int part)
 // start with the higher levels to reduce the risk of duplicates.
 //
 int
-MultiCacheBase::sync_partition(int partition)
+MultiCacheBase::sync_partition(int partition, MultiCacheStaging *staged)
 {
   int res = 0;
   int b = first_bucket_of_partition(partition);
   int n = buckets_of_partition(partition);
   // L3
   if (levels > 2) {
-    if (ats_msync(data + level_offset[2] + b * bucketsize[2], n * bucketsize[2], data + totalsize, MS_SYNC) < 0)
+    if (sync_region(data + level_offset[2] + b * bucketsize[2], n * bucketsize[2], staged) < 0)
       res = -1;
   }
   // L2
   if (levels > 1) {
-    if (ats_msync(data + level_offset[1] + b * bucketsize[1], n * bucketsize[1], data + totalsize, MS_SYNC) < 0)
+    if (sync_region(data + level_offset[1] + b * bucketsize[1], n * bucketsize[1], staged) < 0)
       res = -1;
   }
   // L1
-  if (ats_msync(data + b * bucketsize[0], n * bucketsize[0], data + totalsize, MS_SYNC) < 0)
+  if (sync_region(data + b * bucketsize[0], n * bucketsize[0], staged) < 0)
     res = -1;
   return res;
 }
@@ -956,7 +982,77 @@ int
 MultiCacheBase::sync_header()
 {
   *mapped_header = *(MultiCacheHeader *)this;
-  return ats_msync((char *)mapped_header, STORE_BLOCK_SIZE, (char *)mapped_header + STORE_BLOCK_SIZE, MS_SYNC);
+  return sync_region((char *)mapped_header, STORE_BLOCK_SIZE);
+}
+
+//
+// Write a region of the database back to its backing files. With a
+// shared mapping this is an msync, otherwise the region is copied out
+// to the files covering it, or only into @a staged if that is given.
+//
+int
+MultiCacheBase::sync_region(char *p, size_t len, MultiCacheStaging *staged)
+{
+  if (!snapshot)
+    return ats_msync(p, len, data + totalsize, MS_SYNC);
+
+  int res = 0;
+  char *end = p + len;
+  for (unsigned i = 0; i < segments.n; i++) {
+    MultiCacheSegment &seg = segments.v[i];
+    char *b = MAX(p, seg.addr);
+    char *e = MIN(end, seg.addr + seg.length);
+    if (b >= e)
+      continue;
+    if (staged) {
+      MultiCacheStagedWrite &w = staged->add();
+      w.fd = seg.fd;
+      w.offset = seg.offset + (b - seg.addr);
+      w.length = e - b;
+      w.buf = (char *)ats_malloc(w.length);
+      memcpy(w.buf, b, w.length);
+      continue;
+    }
+    if (pwrite(seg.fd, b, e - b, seg.offset + (b - seg.addr)) != e - b) {
+      Warning("unable to write host database snapshot: %d, %s", errno, strerror(errno));
+      res = -1;
+    }
+  }
+  return res;
+}
+
+//
+// Write out and release the regions staged by sync_region().
+//
+int
+MultiCacheBase::write_staged(MultiCacheStaging &staged)
+{
+  int res = 0;
+  for (unsigned i = 0; i < staged.n; i++) {
+    MultiCacheStagedWrite &w = staged.v[i];
+    if (pwrite(w.fd, w.buf, w.length, w.offset) != (ssize_t)w.length) {
+      Warning("unable to write host database snapshot: %d, %s", errno, strerror(errno));
+      res = -1;
+    }
+    ats_free(w.buf);
+  }
+  staged.clear();
+  return res;
+}
+
+//
+// Make every region written by sync_region() durable. Blocks, so call
+// it from a thread which can afford to wait on the disk.
+//
+int
+MultiCacheBase::sync_barrier()
+{
+  int res = 0;
+  for (int i = 0; i < n_snapshot_fds; i++) {
+    if (snapshot_fds[i] > 0 && fdatasync(snapshot_fds[i]) < 0)
+      res = -1;
+  }
+  return res;
 }
 
 int
@@ -966,11 +1062,15 @@ MultiCacheBase::sync_all()
   for (i = 0; i < MULTI_CACHE_PARTITIONS; i++)
     if (sync_heap(i) < 0)
       res = -1;
+  if (sync_barrier() < 0)
+    res = -1;
   for (i = 0; i < MULTI_CACHE_PARTITIONS; i++)
     if (sync_partition(i) < 0)
       res = -1;
   if (sync_header())
     res = -1;
+  if (sync_barrier() < 0)
+    res = -1;
   return res;
 }
 
@@ -985,6 +1085,9 @@ struct MultiCacheSync : public Continuation {
   MultiCacheBase *mc;
   Continuation *cont;
   int before_used;
+  bool synced;
+  Ptr<ProxyMutex> write_mutex;
+  MultiCacheStaging staged;
 
   int
   heapEvent(int event, Event *e)
@@ -994,12 +1097,52 @@ struct MultiCacheSync : public Continuation {
       mc->header_snap = *(MultiCacheHeader *)mc;
     }
     if (partition < MULTI_CACHE_PARTITIONS) {
-      mc->sync_heap(partition++);
+      mc->sync_heap(partition++, mc->snapshot ? &staged : NULL);
       e->schedule_imm();
       return EVENT_CONT;
     }
+    if (mc->snapshot) {
+      // The heap must be on disk before the header and partitions which
+      // refer to it. Write it and wait on a task thread, holding no bucket lock.
+      mutex = write_mutex;
+      SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::heapBarrierEvent);
+      eventProcessor.schedule_imm(this, ET_TASK);
+      return EVENT_CONT;
+    }
+    return headerEvent(event, e);
+  }
+
+  int
+  heapBarrierEvent(int event, Event *e)
+  {
+    (void)event;
+    (void)e;
+    mc->write_staged(staged);
+    mc->sync_barrier();
+    mutex = mc->locks[0];
+    SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::headerEvent);
+    eventProcessor.schedule_imm(this, ET_CALL);
+    return EVENT_CONT;
+  }
+
+  int
+  doneBarrierEvent(int event, Event *e)
+  {
+    (void)event;
+    (void)e;
+    mc->sync_barrier();
+    synced = true;
+    mutex = cont->mutex;
+    SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::mcEvent);
+    eventProcessor.schedule_imm(this, ET_CALL);
+    return EVENT_CONT;
+  }
+
+  int
+  headerEvent(int event, Event *e)
+  {
     *mc->mapped_header = mc->header_snap;
-    ink_assert(!ats_msync((char *)mc->mapped_header, STORE_BLOCK_SIZE, (char *)mc->mapped_header + STORE_BLOCK_SIZE, MS_SYNC));
+    ink_assert(!mc->sync_region((char *)mc->mapped_header, STORE_BLOCK_SIZE, mc->snapshot ? &staged : NULL));
     partition = 0;
     SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::mcEvent);
     return mcEvent(event, e);
@@ -1010,20 +1153,53 @@ struct MultiCacheSync : public Continuation {
   {
     (void)event;
     if (partition >= MULTI_CACHE_PARTITIONS) {
+      if (mc->snapshot && !synced) {
+        mutex = write_mutex;
+        SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::doneBarrierEvent);
+        eventProcessor.schedule_imm(this, ET_TASK);
+        return EVENT_CONT;
+      }
       cont->handleEvent(MULTI_CACHE_EVENT_SYNC, 0);
       Debug("multicache", "MultiCacheSync done (%d, %d)", mc->heap_used[0], mc->heap_used[1]);
       delete this;
       return EVENT_DONE;
     }
     mc->fixup_heap_offsets(partition, before_used);
+    if (mc->snapshot) {
+      mc->sync_partition(partition, &staged);
+      partition++;
+      mutex = write_mutex;
+      SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::writeEvent);
+      eventProcessor.schedule_imm(this, ET_TASK);
+      return EVENT_CONT;
+    }
     mc->sync_partition(partition);
     partition++;
     mutex = e->ethread->mutex;
     SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::pauseEvent);
-    e->schedule_in(MAX(MC_SYNC_MIN_PAUSE_TIME, HRTIME_SECONDS(hostdb_sync_frequency - 5) / MULTI_CACHE_PARTITIONS));
+    e->schedule_in(pause_time());
     return EVENT_CONT;
   }
 
+  // Write the partition staged by mcEvent() once its lock is released,
+  // then pause on an event thread as usual.
+  int
+  writeEvent(int event, Event *e)
+  {
+    (void)event;
+    (void)e;
+    mc->write_staged(staged);
+    SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::pauseEvent);
+    eventProcessor.schedule_in(this, pause_time(), ET_CALL);
+    return EVENT_CONT;
+  }
+
+  static ink_hrtime
+  pause_time()
+  {
+    return MAX(MC_SYNC_MIN_PAUSE_TIME, HRTIME_SECONDS(hostdb_sync_frequency - 5) / MULTI_CACHE_PARTITIONS);
+  }
+
   int
   pauseEvent(int event, Event *e)
   {
@@ -1039,7 +1215,7 @@ struct MultiCacheSync : public Continuation {
   }
 
   MultiCacheSync(Continuation *acont, MultiCacheBase *amc)
-    : Continuation(amc->locks[0]), partition(0), mc(amc), cont(acont), before_used(0)
+    : Continuation(amc->locks[0]), partition(0), mc(amc), cont(acont), before_used(0), synced(false), write_mutex(new_ProxyMutex())
   {
     mutex = mc->locks[partition];
     SET_HANDLER((MCacheSyncHandler)&MultiCacheSync::heapEvent);
@@ -1118,9 +1294,10 @@ struct MultiCacheHeapGC : public Continuation {
       mc->copy_heap(partition, this);
       char *after = mc->heap + mc->heap_used[mc->heap_halfspace];
 
-      // sync new heap data and header (used)
+      // sync new heap data and header (used); a snapshot database
+      // leaves that to the sync which follows the collection
 
-      if (after - before > 0) {
+      if (!mc->snapshot && after - before > 0) {
         ink_assert(!ats_msync(before, after - before, mc->heap + mc->totalsize, MS_SYNC));
         ink_assert(!ats_msync((char *)mc->mapped_header, STORE_BLOCK_SIZE, (char *)mc->mapped_header + STORE_BLOCK_SIZE, MS_SYNC));
       }
@@ -1135,7 +1312,8 @@ struct MultiCacheHeapGC : public Continuation {
         *i1 = i2;
       }
       n_offsets = 0;
-      mc->sync_partition(partition);
+      if (!mc->snapshot)
+        mc->sync_partition(partition);
       partition++;
       if (partition < MULTI_CACHE_PARTITIONS)
         mutex = mc->locks[partition];
@@ -1145,8 +1323,14 @@ struct MultiCacheHeapGC : public Continuation {
       return EVENT_CONT;
     }
     mc->heap_used[mc->heap_halfspace ? 0 : 1] = 8; // skip 0
-    cont->handleEvent(MULTI_CACHE_EVENT_SYNC, 0);
     Debug("multicache", "MultiCacheHeapGC done");
+    if (mc->snapshot) {
+      // write the compacted database back as one consistent snapshot
+      eventProcessor.schedule_imm(new MultiCacheSync(cont, mc), ET_CALL);
+      delete this;
+      return EVENT_DONE;
+    }
+    cont->handleEvent(MULTI_CACHE_EVENT_SYNC, 0);
     delete this;
     return EVENT_DONE;
   }
@@ -41,6 +41,7 @@ extern int hostdb_cluster_round_robin;
 extern int hostdb_lookup_timeout;
 extern int hostdb_insert_timeout;
 extern int hostdb_re_dns_on_reload;
+extern int hostdb_parallel_family_lookup;
 
 // 0 = obey, 1 = ignore, 2 = min(X,ttl), 3 = max(X,ttl)
 enum {
@@ -159,6 +160,7 @@ enum HostDB_Stats {
   hostdb_ttl_stat,         // D average TTL
   hostdb_ttl_expires_stat, // D == TTL Expires
   hostdb_re_dns_on_reload_stat,
+  hostdb_parallel_family_lookups_stat,
   hostdb_bytes_stat,
   HostDB_Stat_Count
 };
@@ -184,6 +184,26 @@ struct Unmaper {
   char *pAddr;
 };
 
+// A piece of a backing file mapped into the database, used to write
+// snapshots back when the database is not a shared mapping.
+struct MultiCacheSegment {
+  char *addr;
+  size_t length;
+  int fd;
+  off_t offset;
+};
+
+// A region copied out of the database under its bucket lock, to be
+// written to its backing file once the lock is released.
+struct MultiCacheStagedWrite {
+  int fd;
+  off_t offset;
+  size_t length;
+  char *buf;
+};
+
+typedef Vec<MultiCacheStagedWrite> MultiCacheStaging;
+
 typedef int three_ints[3];
 typedef int two_ints[2];
 
@@ -346,11 +366,28 @@ struct MultiCacheBase : public MultiCacheHeader {
   }
 
   int sync_all();
-  int sync_heap(int part); // part varies between 0 and MULTI_CACHE_PARTITIONS
+  int sync_heap(int part, MultiCacheStaging *staged = NULL); // part varies between 0 and MULTI_CACHE_PARTITIONS
   int sync_header();
-  int sync_partition(int partition);
+  int sync_partition(int partition, MultiCacheStaging *staged = NULL);
   void sync_partitions(Continuation *cont);
 
+  // Snapshot persistence. The database is mapped private, so nothing
+  // reaches the backing files except what a sync writes back. Given a
+  // staging vector, sync_region() only copies the region out, and
+  // write_staged() later writes it with no bucket lock held. Writes
+  // only reach the page cache; sync_barrier() makes them durable.
+  // MultiCacheSync runs both of those on a task thread. Only persistence
+  // changes: the table is still fixed size, partition locked and heap
+  // collected as without snapshots.
+  bool snapshot;
+  int snapshot_fds[MULTI_CACHE_MAX_FILES];
+  int n_snapshot_fds;
+  Vec<MultiCacheSegment> segments;
+
+  int sync_region(char *p, size_t len, MultiCacheStaging *staged = NULL);
+  int write_staged(MultiCacheStaging &staged);
+  int sync_barrier();
+
   MultiCacheBase();
   virtual ~MultiCacheBase() { reset(); }
 
@@ -450,6 +450,20 @@ public:
    */
   virtual void trapWriteBufferEmpty(int event = VC_EVENT_WRITE_READY);
 
+  /** Forward the bytes read by this connection directly to @a target.
+
+      When supported, bytes are moved from this connection's socket to the
+      socket of @a target without passing through the read buffer, while the
+      read VIO of this connection and the write VIO of @a target are
+      advanced as if they had. Bytes already in the buffer are written first.
+      The pairing is dropped by the next do_io_read() on this connection,
+      the next do_io_write() on @a target or when either is closed. Pass
+      @c NULL to drop it explicitly.
+
+      @return @c true if the pairing was established.
+   */
+  virtual bool set_splice_target(NetVConnection *target);
+
   /** Returns local sockaddr storage. */
   sockaddr const *get_local_addr();
 
@@ -577,4 +591,10 @@ NetVConnection::trapWriteBufferEmpty(int event)
   write_buffer_empty_event = event;
 }
 
+inline bool
+NetVConnection::set_splice_target(NetVConnection *)
+{
+  return false;
+}
+
 #endif
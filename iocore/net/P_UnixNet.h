@@ -195,6 +195,12 @@ public:
 
   time_t sec;
   int cycles;
+#if HAVE_SPLICE
+  // Pipe shared by every spliced connection on this thread. It is always
+  // drained before a transfer returns, so it never holds another
+  // connection's bytes. splice_pipe[0] is -2 if it could not be created.
+  int splice_pipe[2];
+#endif
 
   int startNetEvent(int event, Event *data);
   int mainNetEvent(int event, Event *data);
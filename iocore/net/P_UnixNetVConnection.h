@@ -158,6 +158,8 @@ public:
 
   virtual SOCKET get_socket();
 
+  virtual bool set_splice_target(NetVConnection *target);
+
   virtual ~UnixNetVConnection();
 
   /////////////////////////////////////////////////////////////////
@@ -214,6 +216,7 @@ public:
   void readReschedule(NetHandler *nh);
   void writeReschedule(NetHandler *nh);
   void netActivity(EThread *lthread);
+  void splice_unlink();
 
   Action action_;
   volatile int closed;
@@ -258,6 +261,12 @@ public:
   OOB_callback *oob_ptr;
   bool from_accept_thread;
 
+  // Pairing set up by set_splice_target(). When splice_target is set, bytes
+  // read from this connection go straight to its socket; splice_source is
+  // the reverse link so either side can break the pairing on close.
+  UnixNetVConnection *splice_target;
+  UnixNetVConnection *splice_source;
+
   int startEvent(int event, Event *e);
   int acceptEvent(int event, Event *e);
   int mainEvent(int event, Event *e);
@@ -384,6 +384,9 @@ initialize_thread_for_net(EThread *thread)
 
 NetHandler::NetHandler() : Continuation(NULL), trigger_event(0), keep_alive_lru_size(0)
 {
+#if HAVE_SPLICE
+  splice_pipe[0] = splice_pipe[1] = -1;
+#endif
   SET_HANDLER((NetContHandler)&NetHandler::startNetEvent);
 }
 
@@ -95,6 +95,7 @@ void
 close_UnixNetVConnection(UnixNetVConnection *vc, EThread *t)
 {
   NetHandler *nh = vc->nh;
+  vc->splice_unlink();
   vc->cancel_OOB();
   vc->ep.stop();
   vc->con.close();
@@ -231,6 +232,102 @@ write_signal_error(NetHandler *nh, UnixNetVConnection *vc, int lerrno)
   return write_signal_done(VC_EVENT_ERROR, nh, vc);
 }
 
+#if HAVE_SPLICE
+// Open the thread's splice pipe on first use. A failure is remembered so
+// the connections of this thread quietly keep using the buffered path.
+static bool
+splice_pipe_open(NetHandler *nh)
+{
+  if (nh->splice_pipe[0] >= 0)
+    return true;
+  if (nh->splice_pipe[0] == -1) {
+    if (pipe2(nh->splice_pipe, O_NONBLOCK | O_CLOEXEC) == 0)
+      return true;
+    Warning("unable to create splice pipe: %s", strerror(errno));
+    nh->splice_pipe[0] = -2;
+    nh->splice_pipe[1] = -1;
+  }
+  return false;
+}
+
+// How many of the next @a toread bytes of @a vc may skip its read buffer.
+// The peer's write VIO must run on this thread under the lock we hold and
+// have nothing queued ahead of these bytes. The splice never finishes
+// either VIO, the last byte goes through the buffer so the usual
+// completion events are sent in the usual order.
+static int64_t
+splice_avail(NetHandler *nh, UnixNetVConnection *vc, int64_t toread)
+{
+  UnixNetVConnection *peer = vc->splice_target;
+  NetState *ws = &peer->write;
+
+  if (peer->closed || peer->thread != vc->thread || ws->vio.op != VIO::WRITE || ws->vio.mutex.m_ptr != vc->read.vio.mutex.m_ptr ||
+      (peer->f.shutdown & NET_VC_SHUTDOWN_WRITE) || !ws->vio.buffer.reader() || ws->vio.buffer.reader()->is_read_avail_more_than(0))
+    return 0;
+
+  int64_t n = toread;
+  if (n > vc->read.vio.ntodo() - 1)
+    n = vc->read.vio.ntodo() - 1;
+  if (n > ws->vio.ntodo() - 1)
+    n = ws->vio.ntodo() - 1;
+  if (n <= 0 || !splice_pipe_open(nh))
+    return 0;
+  return n;
+}
+
+// Move up to @a toread bytes from the socket of @a vc to the socket of its
+// splice target through the thread's pipe. Whatever the target does not
+// take right away is read back from the pipe into the free space of the
+// read buffer, without filling it, so the pipe is always left empty.
+// Returns the bytes taken from the socket, 0 on EOF or -errno like a read,
+// and sets @a spliced to the bytes written to the target.
+static int64_t
+splice_from_net(NetHandler *nh, UnixNetVConnection *vc, int64_t toread, int64_t &spliced)
+{
+  int64_t r = splice(vc->con.fd, NULL, nh->splice_pipe[1], NULL, toread, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+  spliced = 0;
+  if (r <= 0)
+    return r < 0 ? -errno : 0;
+
+  while (spliced < r) {
+    int64_t w = splice(nh->splice_pipe[0], NULL, vc->splice_target->con.fd, NULL, r - spliced, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (w <= 0) // the buffered write reports any error
+      break;
+    spliced += w;
+  }
+
+  int64_t left = r - spliced, off = 0;
+  IOBufferBlock *b = vc->read.vio.buffer.writer()->first_write_block();
+  while (left > 0 && b) {
+    int64_t a = b->write_avail() - off;
+    if (a <= 0) {
+      b = b->next;
+      off = 0;
+      continue;
+    }
+    if (a > left)
+      a = left;
+    int64_t n = socketManager.read(nh->splice_pipe[0], b->_end + off, a);
+    if (n <= 0)
+      break;
+    off += n;
+    left -= n;
+  }
+
+  if (left > 0) {
+    // Bytes stuck in the pipe would leak into the next connection.
+    Warning("unable to drain splice pipe, %" PRId64 " bytes lost", left);
+    close(nh->splice_pipe[0]);
+    close(nh->splice_pipe[1]);
+    nh->splice_pipe[0] = nh->splice_pipe[1] = -1;
+    spliced = 0;
+    return -EIO;
+  }
+  return r;
+}
+#endif
+
 // Read the data for a UnixNetVConnection.
 // Rescheduling the UnixNetVConnection by moving the VC
 // onto or off of the ready_list.
@@ -268,45 +365,54 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     toread = ntodo;
 
   // read data
-  int64_t rattempted = 0, total_read = 0;
+  int64_t rattempted = 0, total_read = 0, spliced = 0;
   int niov = 0;
   IOVec tiovec[NET_MAX_IOV];
   if (toread) {
-    IOBufferBlock *b = buf.writer()->first_write_block();
-    do {
-      niov = 0;
-      rattempted = 0;
-      while (b && niov < NET_MAX_IOV) {
-        int64_t a = b->write_avail();
-        if (a > 0) {
-          tiovec[niov].iov_base = b->_end;
-          int64_t togo = toread - total_read - rattempted;
-          if (a > togo)
-            a = togo;
-          tiovec[niov].iov_len = a;
-          rattempted += a;
-          niov++;
-          if (a >= togo)
-            break;
+#if HAVE_SPLICE
+    int64_t tosplice = vc->splice_target ? splice_avail(nh, vc, toread) : 0;
+    if (tosplice) {
+      r = splice_from_net(nh, vc, tosplice, spliced);
+      NET_INCREMENT_DYN_STAT(net_calls_to_read_stat);
+    } else
+#endif
+    {
+      IOBufferBlock *b = buf.writer()->first_write_block();
+      do {
+        niov = 0;
+        rattempted = 0;
+        while (b && niov < NET_MAX_IOV) {
+          int64_t a = b->write_avail();
+          if (a > 0) {
+            tiovec[niov].iov_base = b->_end;
+            int64_t togo = toread - total_read - rattempted;
+            if (a > togo)
+              a = togo;
+            tiovec[niov].iov_len = a;
+            rattempted += a;
+            niov++;
+            if (a >= togo)
+              break;
+          }
+          b = b->next;
         }
-        b = b->next;
-      }
 
-      if (niov == 1) {
-        r = socketManager.read(vc->con.fd, tiovec[0].iov_base, tiovec[0].iov_len);
-      } else {
-        r = socketManager.readv(vc->con.fd, &tiovec[0], niov);
+        if (niov == 1) {
+          r = socketManager.read(vc->con.fd, tiovec[0].iov_base, tiovec[0].iov_len);
+        } else {
+          r = socketManager.readv(vc->con.fd, &tiovec[0], niov);
+        }
+        NET_INCREMENT_DYN_STAT(net_calls_to_read_stat);
+        total_read += rattempted;
+      } while (rattempted && r == rattempted && total_read < toread);
+
+      // if we have already moved some bytes successfully, summarize in r
+      if (total_read != rattempted) {
+        if (r <= 0)
+          r = total_read - rattempted;
+        else
+          r = total_read - rattempted + r;
       }
-      NET_INCREMENT_DYN_STAT(net_calls_to_read_stat);
-      total_read += rattempted;
-    } while (rattempted && r == rattempted && total_read < toread);
-
-    // if we have already moved some bytes successfully, summarize in r
-    if (total_read != rattempted) {
-      if (r <= 0)
-        r = total_read - rattempted;
-      else
-        r = total_read - rattempted + r;
     }
     // check for errors
     if (r <= 0) {
@@ -330,13 +436,21 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     NET_SUM_DYN_STAT(net_read_bytes_stat, r);
 
     // Add data to buffer and signal continuation.
-    buf.writer()->fill(r);
+    buf.writer()->fill(r - spliced);
 #ifdef DEBUG
     if (buf.writer()->write_avail() <= 0)
       Debug("iocore_net", "read_from_net, read buffer full");
 #endif
     s->vio.ndone += r;
     net_activity(vc, thread);
+
+    // Spliced bytes are already written, account for them on the peer.
+    if (spliced) {
+      NET_SUM_DYN_STAT(net_write_bytes_stat, spliced);
+      NET_SUM_DYN_STAT(net_splice_bytes_stat, spliced);
+      vc->splice_target->write.vio.ndone += spliced;
+      net_activity(vc->splice_target, thread);
+    }
   } else
     r = 0;
 
@@ -592,6 +706,10 @@ UnixNetVConnection::do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf)
   read.vio.nbytes = nbytes;
   read.vio.ndone = 0;
   read.vio.vc_server = (VConnection *)this;
+  if (splice_target) {
+    splice_target->splice_source = NULL;
+    splice_target = NULL;
+  }
   if (buf) {
     read.vio.buffer.writer_for(buf);
     if (!read.enabled)
@@ -613,6 +731,10 @@ UnixNetVConnection::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader
   write.vio.nbytes = nbytes;
   write.vio.ndone = 0;
   write.vio.vc_server = (VConnection *)this;
+  if (splice_source) {
+    splice_source->splice_target = NULL;
+    splice_source = NULL;
+  }
   if (reader) {
     ink_assert(!owner);
     write.vio.buffer.reader_for(reader);
@@ -627,6 +749,7 @@ UnixNetVConnection::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader
 void
 UnixNetVConnection::do_io_close(int alerrno /* = -1 */)
 {
+  splice_unlink();
   disable_read(this);
   disable_write(this);
   read.vio.buffer.clear();
@@ -844,7 +967,8 @@ UnixNetVConnection::UnixNetVConnection()
 #else
     next_inactivity_timeout_at(0),
 #endif
-    active_timeout(NULL), nh(NULL), id(0), flags(0), recursion(0), submit_time(0), oob_ptr(0), from_accept_thread(false)
+    active_timeout(NULL), nh(NULL), id(0), flags(0), recursion(0), submit_time(0), oob_ptr(0), from_accept_thread(false),
+    splice_target(NULL), splice_source(NULL)
 {
   memset(&local_addr, 0, sizeof local_addr);
   memset(&server_addr, 0, sizeof server_addr);
@@ -974,6 +1098,45 @@ UnixNetVConnection::writeReschedule(NetHandler *nh)
   write_reschedule(nh, this);
 }
 
+bool
+UnixNetVConnection::set_splice_target(NetVConnection *target)
+{
+  if (splice_target) {
+    splice_target->splice_source = NULL;
+    splice_target = NULL;
+  }
+#if HAVE_SPLICE
+  UnixNetVConnection *peer = dynamic_cast<UnixNetVConnection *>(target);
+
+  // TLS has to see every byte, and the pipe belongs to a single thread.
+  if (!peer || peer == this || closed || peer->closed || peer->thread != thread || dynamic_cast<SSLNetVConnection *>(this) ||
+      dynamic_cast<SSLNetVConnection *>(peer))
+    return false;
+  if (peer->splice_source)
+    peer->splice_source->splice_target = NULL;
+  peer->splice_source = this;
+  splice_target = peer;
+  Debug("iocore_net", "splicing NetVC=%p to NetVC=%p", this, peer);
+  return true;
+#else
+  (void)target;
+  return false;
+#endif
+}
+
+void
+UnixNetVConnection::splice_unlink()
+{
+  if (splice_target) {
+    splice_target->splice_source = NULL;
+    splice_target = NULL;
+  }
+  if (splice_source) {
+    splice_source->splice_target = NULL;
+    splice_source = NULL;
+  }
+}
+
 void
 UnixNetVConnection::netActivity(EThread *lthread)
 {
@@ -1230,6 +1393,7 @@ UnixNetVConnection::free(EThread *t)
   ink_assert(!write.enable_link.next);
   ink_assert(!link.next && !link.prev);
   ink_assert(!active_timeout);
+  ink_assert(!splice_target && !splice_source);
   ink_assert(con.fd == NO_FD);
   ink_assert(t == this_ethread());
 
@@ -160,6 +160,14 @@ struct RecRawStat {
   uint32_t version;
 };
 
+// Thread local raw-stat slot. Only the running sum and count are needed
+// per thread (the sync bookkeeping above lives in the global RecRawStat),
+// so keeping the slots this small packs four stats to a cache line.
+struct RecRawStatSlot {
+  int64_t sum;
+  int64_t count;
+};
+
 
 // WARNING!  It's advised that developers do not modify the contents of
 // the RecRawStatBlock.  ^_^
@@ -169,6 +177,8 @@ struct RecRawStatBlock {
   int num_stats;          // number of stats in this block
   int max_stats;          // maximum number of stats for this block
   ink_mutex mutex;
+  RecRawStatSlot *sync_totals; // thread totals per stat, from one pass over all threads
+  uint32_t sync_generation;    // sync round sync_totals were collected in
 };
 
 
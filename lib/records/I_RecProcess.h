@@ -52,6 +52,37 @@ int _RecRegisterRawStat(RecRawStatBlock *rsb, RecT rec_type, const char *name, R
 #define RecRegisterRawStat(rsb, rec_type, name, data_type, persist_type, id, sync_cb) \
   _RecRegisterRawStat((rsb), (rec_type), (name), (data_type), REC_PERSISTENCE_TYPE(persist_type), (id), (sync_cb))
 
+//-------------------------------------------------------------------------
+// Histogram Registration
+//-------------------------------------------------------------------------
+// A histogram is a raw-stat block whose first REC_HISTOGRAM_BUCKETS slots
+// are log-linear buckets: values below REC_HISTOGRAM_SUB_BUCKETS get a
+// bucket each, and every power of two above that is split into
+// REC_HISTOGRAM_SUB_BUCKETS equal buckets. Each slot keeps the sum and the
+// number of the values that fell in it, recorded per thread without locks
+// like any other raw stat. RecRegisterHistogram() adds the records
+// <name>.count, .mean, .p50, .p90, .p99 and .p999, which are computed from
+// the buckets merged across threads at sync time.
+#define REC_HISTOGRAM_SUB_BITS 3
+#define REC_HISTOGRAM_SUB_BUCKETS (1 << REC_HISTOGRAM_SUB_BITS)
+#define REC_HISTOGRAM_BUCKETS ((64 - REC_HISTOGRAM_SUB_BITS) * REC_HISTOGRAM_SUB_BUCKETS)
+
+enum RecHistogramStat {
+  REC_HISTOGRAM_COUNT = REC_HISTOGRAM_BUCKETS,
+  REC_HISTOGRAM_MEAN,
+  REC_HISTOGRAM_P50,
+  REC_HISTOGRAM_P90,
+  REC_HISTOGRAM_P99,
+  REC_HISTOGRAM_P999,
+  REC_HISTOGRAM_MAX_STATS,
+};
+
+RecRawStatBlock *RecAllocateHistogram();
+
+int _RecRegisterHistogram(RecRawStatBlock *hsb, RecT rec_type, const char *name, RecPersistT persist_type);
+#define RecRegisterHistogram(hsb, rec_type, name, persist_type) \
+  _RecRegisterHistogram((hsb), (rec_type), (name), REC_PERSISTENCE_TYPE(persist_type))
+
 // RecRawStatRange* RecAllocateRawStatRange (int num_buckets);
 
 // int RecRegisterRawStatRange (RecRawStatRange *rsr,
@@ -72,6 +103,7 @@ int RecRawStatSyncAvg(const char *name, RecDataT data_type, RecData *data, RecRa
 int RecRawStatSyncHrTimeAvg(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id);
 int RecRawStatSyncIntMsecsToFloatSeconds(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id);
 int RecRawStatSyncMHrTimeAvg(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id);
+int RecRawStatSyncHistogram(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id);
 
 
 //-------------------------------------------------------------------------
@@ -84,6 +116,7 @@ int RecRawStatSyncMHrTimeAvg(const char *name, RecDataT data_type, RecData *data
 inline int RecIncrRawStat(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr = 1);
 inline int RecIncrRawStatSum(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr = 1);
 inline int RecIncrRawStatCount(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr = 1);
+inline int RecRecordHistogram(RecRawStatBlock *hsb, EThread *ethread, int64_t value);
 int RecIncrRawStatBlock(RecRawStatBlock *rsb, EThread *ethread, RecRawStat *stat_array);
 
 int RecSetRawStatSum(RecRawStatBlock *rsb, int id, int64_t data);
@@ -117,20 +150,20 @@ int64_t *RecGetGlobalRawStatCountPtr(RecRawStatBlock *rsb, int id);
 //-------------------------------------------------------------------------
 // inlined functions that are used very frequently.
 // FIXME: move it to Inline.cc
-inline RecRawStat *
+inline RecRawStatSlot *
 raw_stat_get_tlp(RecRawStatBlock *rsb, int id, EThread *ethread)
 {
   ink_assert((id >= 0) && (id < rsb->max_stats));
   if (ethread == NULL) {
     ethread = this_ethread();
   }
-  return (((RecRawStat *)((char *)(ethread) + rsb->ethr_stat_offset)) + id);
+  return (((RecRawStatSlot *)((char *)(ethread) + rsb->ethr_stat_offset)) + id);
 }
 
 inline int
 RecIncrRawStat(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum += incr;
   tlp->count += 1;
   return REC_ERR_OKAY;
@@ -139,7 +172,7 @@ RecIncrRawStat(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr)
 inline int
 RecDecrRawStat(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t decr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum -= decr;
   tlp->count += 1;
   return REC_ERR_OKAY;
@@ -148,7 +181,7 @@ RecDecrRawStat(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t decr)
 inline int
 RecIncrRawStatSum(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->sum += incr;
   return REC_ERR_OKAY;
 }
@@ -156,9 +189,26 @@ RecIncrRawStatSum(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr)
 inline int
 RecIncrRawStatCount(RecRawStatBlock *rsb, EThread *ethread, int id, int64_t incr)
 {
-  RecRawStat *tlp = raw_stat_get_tlp(rsb, id, ethread);
+  RecRawStatSlot *tlp = raw_stat_get_tlp(rsb, id, ethread);
   tlp->count += incr;
   return REC_ERR_OKAY;
 }
 
+inline int
+rec_histogram_bucket(int64_t value)
+{
+  if (value < REC_HISTOGRAM_SUB_BUCKETS) {
+    return value < 0 ? 0 : (int)value;
+  }
+
+  int shift = 63 - __builtin_clzll((uint64_t)value) - REC_HISTOGRAM_SUB_BITS;
+  return ((shift + 1) << REC_HISTOGRAM_SUB_BITS) + (int)((value >> shift) & (REC_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+inline int
+RecRecordHistogram(RecRawStatBlock *hsb, EThread *ethread, int64_t value)
+{
+  return RecIncrRawStat(hsb, ethread, rec_histogram_bucket(value), value);
+}
+
 #endif /* !_I_REC_PROCESS_H_ */
@@ -45,6 +45,7 @@ static int g_rec_remote_sync_interval_ms = REC_REMOTE_SYNC_INTERVAL_MS;
 static Event *raw_stat_sync_cont_event;
 static Event *config_update_cont_event;
 static Event *sync_cont_event;
+static uint32_t g_raw_stat_sync_generation = 0;
 
 //-------------------------------------------------------------------------
 // i_am_the_record_owner, only used for librecords_p.a
@@ -125,7 +126,7 @@ static int
 raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 {
   int i;
-  RecRawStat *tlp;
+  RecRawStatSlot *tlp;
 
   total->sum = 0;
   total->count = 0;
@@ -136,13 +137,13 @@ raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 
   // get thread local values
   for (i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     total->sum += tlp->sum;
     total->count += tlp->count;
   }
 
   for (i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
     total->sum += tlp->sum;
     total->count += tlp->count;
   }
@@ -155,31 +156,54 @@ raw_stat_get_total(RecRawStatBlock *rsb, int id, RecRawStat *total)
 }
 
 
+//-------------------------------------------------------------------------
+// raw_stat_sum_block
+//-------------------------------------------------------------------------
+// Collect the thread totals of every stat in the block in one pass,
+// walking each thread's slots sequentially rather than striding across
+// all threads once per stat.
+static void
+raw_stat_sum_block(RecRawStatBlock *rsb)
+{
+  RecRawStatSlot *totals = rsb->sync_totals;
+  int n = rsb->max_stats;
+
+  memset(totals, 0, n * sizeof(RecRawStatSlot));
+
+  for (int i = 0; i < eventProcessor.n_ethreads; i++) {
+    RecRawStatSlot *tlp = (RecRawStatSlot *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset);
+    for (int id = 0; id < n; id++) {
+      totals[id].sum += tlp[id].sum;
+      totals[id].count += tlp[id].count;
+    }
+  }
+
+  for (int i = 0; i < eventProcessor.n_dthreads; i++) {
+    RecRawStatSlot *tlp = (RecRawStatSlot *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset);
+    for (int id = 0; id < n; id++) {
+      totals[id].sum += tlp[id].sum;
+      totals[id].count += tlp[id].count;
+    }
+  }
+
+  rsb->sync_generation = g_raw_stat_sync_generation;
+}
+
+
 //-------------------------------------------------------------------------
 // raw_stat_sync_to_global
 //-------------------------------------------------------------------------
 static int
 raw_stat_sync_to_global(RecRawStatBlock *rsb, int id)
 {
-  int i;
-  RecRawStat *tlp;
   RecRawStat total;
 
-  total.sum = 0;
-  total.count = 0;
-
-  // sum the thread local values
-  for (i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
-    total.sum += tlp->sum;
-    total.count += tlp->count;
-  }
-
-  for (i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
-    total.sum += tlp->sum;
-    total.count += tlp->count;
+  // sum the thread local values, once per block per sync round
+  if (rsb->sync_generation != g_raw_stat_sync_generation) {
+    raw_stat_sum_block(rsb);
   }
+  total.sum = rsb->sync_totals[id].sum;
+  total.count = rsb->sync_totals[id].count;
 
   if (total.sum < 0) { // Assure that we stay positive
     total.sum = 0;
@@ -227,18 +251,20 @@ raw_stat_clear(RecRawStatBlock *rsb, int id)
   ink_atomic_swap(&(rsb->global[id]->last_sum), (int64_t)0);
   ink_atomic_swap(&(rsb->global[id]->count), (int64_t)0);
   ink_atomic_swap(&(rsb->global[id]->last_count), (int64_t)0);
+  rsb->sync_totals[id].sum = 0;
+  rsb->sync_totals[id].count = 0;
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatSlot *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->sum), (int64_t)0);
     ink_atomic_swap(&(tlp->count), (int64_t)0);
   }
 
   for (int i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->sum), (int64_t)0);
     ink_atomic_swap(&(tlp->count), (int64_t)0);
   }
@@ -260,17 +286,18 @@ raw_stat_clear_sum(RecRawStatBlock *rsb, int id)
   ink_mutex_acquire(&(rsb->mutex));
   ink_atomic_swap(&(rsb->global[id]->sum), (int64_t)0);
   ink_atomic_swap(&(rsb->global[id]->last_sum), (int64_t)0);
+  rsb->sync_totals[id].sum = 0;
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatSlot *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->sum), (int64_t)0);
   }
 
   for (int i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->sum), (int64_t)0);
   }
 
@@ -291,17 +318,18 @@ raw_stat_clear_count(RecRawStatBlock *rsb, int id)
   ink_mutex_acquire(&(rsb->mutex));
   ink_atomic_swap(&(rsb->global[id]->count), (int64_t)0);
   ink_atomic_swap(&(rsb->global[id]->last_count), (int64_t)0);
+  rsb->sync_totals[id].count = 0;
   ink_mutex_release(&(rsb->mutex));
 
   // reset the local stats
-  RecRawStat *tlp;
+  RecRawStatSlot *tlp;
   for (int i = 0; i < eventProcessor.n_ethreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_ethreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->count), (int64_t)0);
   }
 
   for (int i = 0; i < eventProcessor.n_dthreads; i++) {
-    tlp = ((RecRawStat *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
+    tlp = ((RecRawStatSlot *)((char *)(eventProcessor.all_dthreads[i]) + rsb->ethr_stat_offset)) + id;
     ink_atomic_swap(&(tlp->count), (int64_t)0);
   }
 
@@ -517,7 +545,7 @@ RecAllocateRawStatBlock(int num_stats)
   RecRawStatBlock *rsb;
 
   // allocate thread-local raw-stat memory
-  if ((ethr_stat_offset = eventProcessor.allocate(num_stats * sizeof(RecRawStat))) == -1) {
+  if ((ethr_stat_offset = eventProcessor.allocate(num_stats * sizeof(RecRawStatSlot))) == -1) {
     return NULL;
   }
   // create the raw-stat-block structure
@@ -526,6 +554,9 @@ RecAllocateRawStatBlock(int num_stats)
   rsb->ethr_stat_offset = ethr_stat_offset;
   rsb->global = (RecRawStat **)ats_malloc(num_stats * sizeof(RecRawStat *));
   memset(rsb->global, 0, num_stats * sizeof(RecRawStat *));
+  rsb->sync_totals = (RecRawStatSlot *)ats_malloc(num_stats * sizeof(RecRawStatSlot));
+  memset(rsb->sync_totals, 0, num_stats * sizeof(RecRawStatSlot));
+  rsb->sync_generation = 0;
   rsb->num_stats = 0;
   rsb->max_stats = num_stats;
   ink_mutex_init(&(rsb->mutex), "net stat mutex");
@@ -533,6 +564,16 @@ RecAllocateRawStatBlock(int num_stats)
 }
 
 
+//-------------------------------------------------------------------------
+// RecAllocateHistogram
+//-------------------------------------------------------------------------
+RecRawStatBlock *
+RecAllocateHistogram()
+{
+  return RecAllocateRawStatBlock(REC_HISTOGRAM_MAX_STATS);
+}
+
+
 //-------------------------------------------------------------------------
 // RecRegisterRawStat
 //-------------------------------------------------------------------------
@@ -576,6 +617,51 @@ Ldone:
 }
 
 
+//-------------------------------------------------------------------------
+// RecRegisterHistogram
+//-------------------------------------------------------------------------
+int
+_RecRegisterHistogram(RecRawStatBlock *hsb, RecT rec_type, const char *name, RecPersistT persist_type)
+{
+  static const char *suffix[] = {"count", "mean", "p50", "p90", "p99", "p999"};
+  char stat_name[256];
+
+  ink_assert(hsb->max_stats == REC_HISTOGRAM_MAX_STATS);
+
+  for (int i = 0; i < REC_HISTOGRAM_MAX_STATS - REC_HISTOGRAM_COUNT; i++) {
+    snprintf(stat_name, sizeof(stat_name), "%s.%s", name, suffix[i]);
+    if (_RecRegisterRawStat(hsb, rec_type, stat_name, RECD_INT, persist_type, REC_HISTOGRAM_COUNT + i, RecRawStatSyncHistogram) !=
+        REC_ERR_OKAY) {
+      return REC_ERR_FAIL;
+    }
+  }
+
+  return REC_ERR_OKAY;
+}
+
+
+//-------------------------------------------------------------------------
+// raw_stat_clear_histogram
+//-------------------------------------------------------------------------
+static void
+raw_stat_clear_histogram(RecRawStatBlock *hsb)
+{
+  for (int i = 0; i < eventProcessor.n_ethreads; i++) {
+    RecRawStatSlot *tlp = (RecRawStatSlot *)((char *)(eventProcessor.all_ethreads[i]) + hsb->ethr_stat_offset);
+    memset(tlp, 0, REC_HISTOGRAM_BUCKETS * sizeof(RecRawStatSlot));
+  }
+
+  for (int i = 0; i < eventProcessor.n_dthreads; i++) {
+    RecRawStatSlot *tlp = (RecRawStatSlot *)((char *)(eventProcessor.all_dthreads[i]) + hsb->ethr_stat_offset);
+    memset(tlp, 0, REC_HISTOGRAM_BUCKETS * sizeof(RecRawStatSlot));
+  }
+
+  ink_mutex_acquire(&(hsb->mutex));
+  memset(hsb->sync_totals, 0, REC_HISTOGRAM_BUCKETS * sizeof(RecRawStatSlot));
+  ink_mutex_release(&(hsb->mutex));
+}
+
+
 //-------------------------------------------------------------------------
 // RecRawStatSync...
 //-------------------------------------------------------------------------
@@ -685,6 +771,67 @@ RecRawStatSyncMHrTimeAvg(const char *name, RecDataT data_type, RecData *data, Re
   return REC_ERR_OKAY;
 }
 
+// Derived histogram stats, computed from the merged buckets. Percentiles
+// report the mean of the values in the bucket holding that rank.
+int
+RecRawStatSyncHistogram(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id)
+{
+  RecRawStatSlot *totals;
+  int64_t count = 0, sum = 0, value = 0;
+  int permille;
+
+  Debug("stats", "raw sync:histogram for %s", name);
+  if (rsb->sync_generation != g_raw_stat_sync_generation) {
+    raw_stat_sum_block(rsb);
+  }
+  totals = rsb->sync_totals;
+
+  for (int b = 0; b < REC_HISTOGRAM_BUCKETS; b++) {
+    count += totals[b].count;
+    sum += totals[b].sum;
+  }
+
+  switch (id) {
+  case REC_HISTOGRAM_COUNT:
+    value = count;
+    break;
+  case REC_HISTOGRAM_MEAN:
+    value = count ? sum / count : 0;
+    break;
+  case REC_HISTOGRAM_P50:
+    permille = 500;
+    goto Lpercentile;
+  case REC_HISTOGRAM_P90:
+    permille = 900;
+    goto Lpercentile;
+  case REC_HISTOGRAM_P99:
+    permille = 990;
+    goto Lpercentile;
+  case REC_HISTOGRAM_P999:
+    permille = 999;
+  Lpercentile:
+    if (count > 0) {
+      int64_t rank = (count * permille + 999) / 1000;
+      int64_t seen = 0;
+
+      for (int b = 0; b < REC_HISTOGRAM_BUCKETS; b++) {
+        seen += totals[b].count;
+        if (seen >= rank && totals[b].count > 0) {
+          value = totals[b].sum / totals[b].count;
+          break;
+        }
+      }
+    }
+    break;
+  default:
+    ink_assert(!"bad histogram stat id");
+    break;
+  }
+
+  RecDataSetFromInk64(data_type, data, value);
+  return REC_ERR_OKAY;
+}
+
 
 //-------------------------------------------------------------------------
 // RecIncrRawStatXXX
@@ -872,6 +1019,10 @@ RecExecRawStatSyncCbs()
   RecRecord *r;
   int i, num_records;
 
+  // Start a new round; each block's thread totals are collected again
+  //   the first time one of its stats is synced
+  ++g_raw_stat_sync_generation;
+
   num_records = g_num_records;
   for (i = 0; i < num_records; i++) {
     r = &(g_records[i]);
@@ -880,6 +1031,9 @@ RecExecRawStatSyncCbs()
       if (r->stat_meta.sync_cb) {
         if (r->version && r->version != r->stat_meta.sync_rsb->global[r->stat_meta.sync_id]->version) {
           raw_stat_clear(r->stat_meta.sync_rsb, r->stat_meta.sync_id);
+          if (r->stat_meta.sync_cb == RecRawStatSyncHistogram) {
+            raw_stat_clear_histogram(r->stat_meta.sync_rsb);
+          }
           r->stat_meta.sync_rsb->global[r->stat_meta.sync_id]->version = r->version;
         } else {
           (*(r->stat_meta.sync_cb))(r->name, r->data_type, &(r->data), r->stat_meta.sync_rsb, r->stat_meta.sync_id);
@@ -927,3 +1081,111 @@ RecMessageSend(RecMessage *msg)
 
   return REC_ERR_OKAY;
 }
+
+
+#if TS_HAS_TESTS
+
+#include "ts/TestBox.h"
+
+// Lowest value that falls in histogram bucket @a b.
+static int64_t
+histogram_bucket_floor(int b)
+{
+  if (b < REC_HISTOGRAM_SUB_BUCKETS) {
+    return b;
+  }
+  int shift = (b >> REC_HISTOGRAM_SUB_BITS) - 1;
+  return (int64_t)(REC_HISTOGRAM_SUB_BUCKETS + (b & (REC_HISTOGRAM_SUB_BUCKETS - 1))) << shift;
+}
+
+static int64_t
+histogram_stat(RecRawStatBlock *hsb, int id)
+{
+  RecData data;
+
+  RecRawStatSyncHistogram("regression.histogram", RECD_INT, &data, hsb, id);
+  return data.rec_int;
+}
+
+REGRESSION_TEST(RecHistogram)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+  static const int NVALUES = 1000;
+  static const struct {
+    int id;
+    int permille;
+  } percentiles[] = {{REC_HISTOGRAM_P50, 500}, {REC_HISTOGRAM_P90, 900}, {REC_HISTOGRAM_P99, 990}, {REC_HISTOGRAM_P999, 999}};
+
+  box = REGRESSION_TEST_PASSED;
+
+  // Every bucket starts right after the previous one ends, and is at most an eighth of its floor wide.
+  for (int b = 0; b < REC_HISTOGRAM_BUCKETS; b++) {
+    int64_t floor = histogram_bucket_floor(b);
+    box.check(rec_histogram_bucket(floor) == b, "value %" PRId64 " is in bucket %d, expected %d", floor, rec_histogram_bucket(floor),
+              b);
+    if (b > 0) {
+      box.check(rec_histogram_bucket(floor - 1) == b - 1, "value %" PRId64 " is in bucket %d, expected %d", floor - 1,
+                rec_histogram_bucket(floor - 1), b - 1);
+    }
+    if (b + 1 < REC_HISTOGRAM_BUCKETS) {
+      int64_t width = histogram_bucket_floor(b + 1) - floor;
+      box.check(width >= 1 && (b < REC_HISTOGRAM_SUB_BUCKETS || width * REC_HISTOGRAM_SUB_BUCKETS <= floor),
+                "bucket %d is %" PRId64 " wide from %" PRId64, b, width, floor);
+    }
+  }
+  box.check(rec_histogram_bucket(INT64_MAX) == REC_HISTOGRAM_BUCKETS - 1, "largest value is in bucket %d, expected %d",
+            rec_histogram_bucket(INT64_MAX), REC_HISTOGRAM_BUCKETS - 1);
+  box.check(rec_histogram_bucket(-1) == 0 && rec_histogram_bucket(INT64_MIN) == 0, "negative values are not in bucket 0");
+
+  RecRawStatBlock *hsb = RecAllocateHistogram();
+  if (hsb == NULL) {
+    box.check(false, "could not allocate a histogram");
+    return;
+  }
+  raw_stat_clear_histogram(hsb);
+
+  // Record 1..NVALUES spread over the event threads, so the percentiles only come out right if the thread
+  //  slots are merged.
+  int nthreads = eventProcessor.n_ethreads;
+  for (int64_t v = 1; v <= NVALUES; v++) {
+    RecRecordHistogram(hsb, eventProcessor.all_ethreads[v % nthreads], v);
+  }
+  raw_stat_sum_block(hsb);
+
+  box.check(histogram_stat(hsb, REC_HISTOGRAM_COUNT) == NVALUES, "count is %" PRId64 ", expected %d",
+            histogram_stat(hsb, REC_HISTOGRAM_COUNT), NVALUES);
+  box.check(histogram_stat(hsb, REC_HISTOGRAM_MEAN) == (NVALUES + 1) / 2, "mean is %" PRId64 ", expected %d",
+            histogram_stat(hsb, REC_HISTOGRAM_MEAN), (NVALUES + 1) / 2);
+
+  // A percentile is the mean of the values sharing a bucket with the value of that rank.
+  for (unsigned i = 0; i < countof(percentiles); i++) {
+    int64_t rank = (NVALUES * percentiles[i].permille + 999) / 1000;
+    int64_t lo = histogram_bucket_floor(rec_histogram_bucket(rank));
+    int64_t hi = histogram_bucket_floor(rec_histogram_bucket(rank) + 1) - 1;
+    int64_t expect = (lo + MIN(hi, (int64_t)NVALUES)) / 2;
+    int64_t got = histogram_stat(hsb, percentiles[i].id);
+
+    box.check(got == expect, "p%d is %" PRId64 ", expected %" PRId64, percentiles[i].permille, got, expect);
+    box.check(got * REC_HISTOGRAM_SUB_BUCKETS >= rank * (REC_HISTOGRAM_SUB_BUCKETS - 1) &&
+                got * REC_HISTOGRAM_SUB_BUCKETS <= rank * (REC_HISTOGRAM_SUB_BUCKETS + 1),
+              "p%d is %" PRId64 ", more than an eighth off %" PRId64, percentiles[i].permille, got, rank);
+  }
+
+  // Clearing empties every thread's slots.
+  raw_stat_clear_histogram(hsb);
+  raw_stat_sum_block(hsb);
+  box.check(histogram_stat(hsb, REC_HISTOGRAM_COUNT) == 0 && histogram_stat(hsb, REC_HISTOGRAM_P50) == 0,
+            "cleared histogram is not empty");
+
+  // The largest value lands in the last bucket and comes back whole.
+  RecRecordHistogram(hsb, eventProcessor.all_ethreads[0], INT64_MAX);
+  raw_stat_sum_block(hsb);
+  box.check(hsb->sync_totals[REC_HISTOGRAM_BUCKETS - 1].count == 1, "largest value is not in the last bucket");
+  box.check(histogram_stat(hsb, REC_HISTOGRAM_P999) == INT64_MAX, "p999 of the largest value is %" PRId64,
+            histogram_stat(hsb, REC_HISTOGRAM_P999));
+
+  // The block's thread local space can't be given back, so leave it clear for good.
+  raw_stat_clear_histogram(hsb);
+}
+
+#endif
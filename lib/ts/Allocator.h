@@ -97,6 +97,28 @@ public:
     ink_freelist_madvise_init(&this->fl, name, element_size, chunk_size, alignment, advice);
   }
 
+  /** Re-initialize the allocator, placing its memory on NUMA node @a numa_node. */
+  void
+  re_init(const char *name, unsigned int element_size, unsigned int chunk_size, unsigned int alignment, int advice,
+          int numa_node)
+  {
+    ink_freelist_numa_init(&this->fl, name, element_size, chunk_size, alignment, advice, numa_node);
+  }
+
+  /** Number of blocks obtained from the system so far. */
+  uint32_t
+  allocated() const
+  {
+    return fl->allocated;
+  }
+
+  /** Number of blocks currently handed out. */
+  uint32_t
+  in_use() const
+  {
+    return fl->used;
+  }
+
 protected:
   InkFreeList *fl;
 };
@@ -221,3 +221,345 @@ DFA::match(const char *str, int length) const
 
   return -1;
 }
+
+RegexPrefilter::RegexPrefilter()
+  : _npatterns(0), _nalloc(0), _literals(NULL), _compiled(false), _nclasses(0), _delta(NULL), _out_head(NULL), _dict(NULL),
+    _pat_next(NULL), _nalways(0), _always(NULL)
+{
+}
+
+RegexPrefilter::~RegexPrefilter()
+{
+  clear_automaton();
+  for (int i = 0; i < _npatterns; i++) {
+    ats_free(_literals[i]);
+  }
+  ats_free(_literals);
+}
+
+void
+RegexPrefilter::clear_automaton()
+{
+  ats_free(_delta);
+  ats_free(_out_head);
+  ats_free(_dict);
+  ats_free(_pat_next);
+  ats_free(_always);
+  _delta = _out_head = _dict = _pat_next = _always = NULL;
+  _nalways = 0;
+  _compiled = false;
+}
+
+int
+RegexPrefilter::required_literal(const char *pattern, char *buf, int bufsize)
+{
+  char run[MAX_LITERAL];
+  int run_len = 0;
+  int best = 0;
+  bool last_in_run = false; // the previous atom is the last char of run
+  int limit = bufsize < MAX_LITERAL ? bufsize : MAX_LITERAL;
+  const char *p = pattern;
+
+#define END_RUN()                     \
+  do {                                \
+    if (run_len > best) {             \
+      memcpy(buf, run, run_len);      \
+      best = run_len;                 \
+    }                                 \
+    run_len = 0;                      \
+    last_in_run = false;              \
+  } while (0)
+
+#define APPEND(c)                                \
+  do {                                           \
+    if (run_len < limit) {                       \
+      run[run_len++] = ParseRules::ink_tolower(c); \
+      last_in_run = true;                        \
+    } else {                                     \
+      last_in_run = false;                       \
+    }                                            \
+  } while (0)
+
+  while (*p) {
+    switch (*p) {
+    case '\\':
+      if (!p[1] || strchr("0123456789xcpPgkNoQEu", p[1])) {
+        // Escapes that take arguments or change quoting; don't guess.
+        return 0;
+      }
+      if (ParseRules::is_alnum(p[1])) {
+        END_RUN(); // \d, \w, \b ...
+      } else {
+        APPEND(p[1]);
+      }
+      p += 2;
+      break;
+    case '|':
+      // Top level alternation, nothing is required.
+      return 0;
+    case '(': {
+      int depth = 0;
+      if (p[1] == '?') {
+        // Extended mode makes white space insignificant.
+        for (const char *o = p + 2; *o && *o != ':' && *o != ')'; o++) {
+          if (*o == 'x') {
+            return 0;
+          }
+        }
+      }
+      do {
+        if (*p == '\\') {
+          if (!p[1]) {
+            return 0;
+          }
+          p++;
+        } else if (*p == '[') {
+          // Brackets inside a class don't nest.
+          p++;
+          if (*p == '^') {
+            p++;
+          }
+          if (*p == ']') {
+            p++;
+          }
+          while (*p && *p != ']') {
+            if (*p == '\\' && p[1]) {
+              p++;
+            }
+            p++;
+          }
+          if (!*p) {
+            return 0;
+          }
+        } else if (*p == '(') {
+          depth++;
+        } else if (*p == ')') {
+          depth--;
+        }
+        p++;
+      } while (*p && depth > 0);
+      if (depth) {
+        return 0;
+      }
+      END_RUN();
+      break;
+    }
+    case '[':
+      p++;
+      if (*p == '^') {
+        p++;
+      }
+      if (*p == ']') {
+        p++;
+      }
+      while (*p && *p != ']') {
+        if (*p == '\\' && p[1]) {
+          p++;
+        } else if (*p == '[' && p[1] == ':') {
+          const char *e = strstr(p + 2, ":]");
+          if (!e) {
+            return 0;
+          }
+          p = e + 1;
+        }
+        p++;
+      }
+      if (!*p) {
+        return 0;
+      }
+      p++;
+      END_RUN();
+      break;
+    case ')':
+      return 0;
+    case '*':
+    case '?':
+    case '{':
+      if (*p == '{' && !ParseRules::is_digit(p[1])) {
+        APPEND(*p);
+        p++;
+        break;
+      }
+      // The previous atom is optional or repeated; drop it.
+      if (last_in_run) {
+        run_len--;
+      }
+      END_RUN();
+      if (*p == '{') {
+        while (*p && *p != '}') {
+          p++;
+        }
+        if (!*p) {
+          return 0;
+        }
+      }
+      p++;
+      if (*p == '?' || *p == '+') {
+        p++;
+      }
+      break;
+    case '+':
+      // One or more; the atom stays but nothing can follow it in the run.
+      END_RUN();
+      p++;
+      if (*p == '?' || *p == '+') {
+        p++;
+      }
+      break;
+    case '.':
+    case '^':
+    case '$':
+      END_RUN();
+      p++;
+      break;
+    default:
+      APPEND(*p);
+      p++;
+      break;
+    }
+  }
+  END_RUN();
+
+#undef END_RUN
+#undef APPEND
+
+  return best;
+}
+
+int
+RegexPrefilter::add(const char *pattern)
+{
+  char lit[MAX_LITERAL];
+  int len = required_literal(pattern, lit, sizeof(lit));
+
+  if (_npatterns == _nalloc) {
+    _nalloc = _nalloc ? _nalloc * 2 : 16;
+    _literals = (char **)ats_realloc(_literals, _nalloc * sizeof(char *));
+  }
+  _literals[_npatterns] = len ? ats_strndup(lit, len) : NULL;
+  clear_automaton();
+
+  return _npatterns++;
+}
+
+void
+RegexPrefilter::compile()
+{
+  int max_states = 1;
+  int nstates = 1;
+  int *fail;
+  int *queue;
+  int qhead = 0, qtail = 0;
+
+  clear_automaton();
+
+  // Characters that appear in some literal each get a class, in both
+  // cases; everything else shares class 0 and always goes back to root.
+  memset(_class, 0, sizeof(_class));
+  _nclasses = 1;
+  for (int i = 0; i < _npatterns; i++) {
+    if (_literals[i]) {
+      for (const char *c = _literals[i]; *c; c++) {
+        unsigned char ch = (unsigned char)*c;
+        if (!_class[ch]) {
+          _class[ch] = _class[(unsigned char)ParseRules::ink_toupper(ch)] = _nclasses++;
+        }
+        max_states++;
+      }
+    }
+  }
+  ink_release_assert(_nclasses <= 256);
+
+  _delta = (int *)ats_malloc(max_states * _nclasses * sizeof(int));
+  _out_head = (int *)ats_malloc(max_states * sizeof(int));
+  _dict = (int *)ats_malloc(max_states * sizeof(int));
+  _pat_next = (int *)ats_malloc((_npatterns ? _npatterns : 1) * sizeof(int));
+  _always = (int *)ats_malloc((_npatterns ? _npatterns : 1) * sizeof(int));
+  fail = (int *)ats_malloc(max_states * sizeof(int));
+  queue = (int *)ats_malloc(max_states * sizeof(int));
+
+  for (int i = 0; i < max_states * _nclasses; i++) {
+    _delta[i] = -1;
+  }
+  for (int i = 0; i < max_states; i++) {
+    _out_head[i] = _dict[i] = -1;
+  }
+
+  // Build the trie; patterns are chained in reverse so that walking a
+  // state's outputs visits lower indexes last, which does not matter
+  // since scan() only sets flags.
+  for (int i = 0; i < _npatterns; i++) {
+    if (!_literals[i]) {
+      _always[_nalways++] = i;
+      _pat_next[i] = -1;
+      continue;
+    }
+    int s = 0;
+    for (const char *c = _literals[i]; *c; c++) {
+      int *t = &_delta[s * _nclasses + _class[(unsigned char)*c]];
+      if (*t < 0) {
+        *t = nstates++;
+      }
+      s = *t;
+    }
+    _pat_next[i] = _out_head[s];
+    _out_head[s] = i;
+  }
+
+  // Breadth first over the trie, filling in fail transitions so that
+  // _delta becomes a complete DFA.
+  fail[0] = 0;
+  for (int k = 0; k < _nclasses; k++) {
+    int t = _delta[k];
+    if (t < 0) {
+      _delta[k] = 0;
+    } else {
+      fail[t] = 0;
+      queue[qtail++] = t;
+    }
+  }
+  while (qhead < qtail) {
+    int s = queue[qhead++];
+    for (int k = 0; k < _nclasses; k++) {
+      int t = _delta[s * _nclasses + k];
+      int f = _delta[fail[s] * _nclasses + k];
+      if (t < 0) {
+        _delta[s * _nclasses + k] = f;
+      } else {
+        fail[t] = f;
+        _dict[t] = _out_head[f] >= 0 ? f : _dict[f];
+        queue[qtail++] = t;
+      }
+    }
+  }
+
+  ats_free(fail);
+  ats_free(queue);
+  _compiled = true;
+}
+
+void
+RegexPrefilter::scan(const char *str, int length, bool *candidates) const
+{
+  if (!_compiled) {
+    for (int i = 0; i < _npatterns; i++) {
+      candidates[i] = true;
+    }
+    return;
+  }
+
+  memset(candidates, 0, _npatterns * sizeof(bool));
+  for (int i = 0; i < _nalways; i++) {
+    candidates[_always[i]] = true;
+  }
+
+  int s = 0;
+  for (int i = 0; i < length; i++) {
+    s = _delta[s * _nclasses + _class[(unsigned char)str[i]]];
+    for (int o = _out_head[s] >= 0 ? s : _dict[s]; o >= 0; o = _dict[o]) {
+      for (int pat = _out_head[o]; pat >= 0; pat = _pat_next[pat]) {
+        candidates[pat] = true;
+      }
+    }
+  }
+}
@@ -79,4 +79,61 @@ private:
   dfa_pattern *_my_patterns;
 };
 
+/**
+  Literal prefilter for a set of regular expressions.
+
+  Each pattern contributes the longest run of literal characters that
+  every match of it must contain. All of those literals are compiled
+  into a single Aho-Corasick automaton, so one pass over a subject finds
+  every pattern that could possibly match it; only those need to be run
+  through PCRE. Patterns with no usable literal (top level alternation,
+  escapes we do not parse, ...) are always candidates. Matching is done
+  case insensitively, so the candidate set is a superset of the patterns
+  that actually match and first-match order is left to the caller.
+*/
+class RegexPrefilter
+{
+public:
+  RegexPrefilter();
+  ~RegexPrefilter();
+
+  /// Add @a pattern and return its index, which is the previous count().
+  int add(const char *pattern);
+  /// Build the automaton. Must be called again after add().
+  void compile();
+
+  int
+  count() const
+  {
+    return _npatterns;
+  }
+
+  /// Set @a candidates[i] for each pattern @a i that may match @a str.
+  /// @a candidates must have count() entries.
+  void scan(const char *str, int length, bool *candidates) const;
+
+  /// Longest literal any match of @a pattern must contain, lower cased
+  /// into @a buf. Returns its length, 0 if there is none.
+  static int required_literal(const char *pattern, char *buf, int bufsize);
+
+  static const int MAX_LITERAL = 64;
+
+private:
+  int _npatterns;
+  int _nalloc;
+  char **_literals; // per pattern, NULL if always a candidate
+
+  bool _compiled;
+  int _nclasses;
+  unsigned char _class[256];
+  int *_delta;    // state * _nclasses -> state
+  int *_out_head; // per state, first pattern whose literal ends here
+  int *_dict;     // per state, next state down the fail chain with output
+  int *_pat_next; // per pattern, next pattern ending in the same state
+  int _nalways;
+  int *_always;
+
+  void clear_automaton();
+};
+
 #endif /* __TS_REGEX_H__ */
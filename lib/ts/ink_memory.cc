@@ -206,6 +206,25 @@ ats_madvise(caddr_t addr, size_t len, int flags)
 #endif
 }
 
+/* Prefer NUMA node numa_node (a logical index) for the pages of the given
+   range that have not been faulted in yet. */
+int
+ats_mbind(caddr_t addr, size_t len, int numa_node)
+{
+#if TS_USE_HWLOC && HWLOC_API_VERSION >= 0x00010100
+  hwloc_obj_t node = hwloc_get_obj_by_type(ink_get_topology(), HWLOC_OBJ_NODE, numa_node);
+
+  if (node == NULL)
+    return -1;
+  return hwloc_set_area_membind(ink_get_topology(), addr, len, node->cpuset, HWLOC_MEMBIND_BIND, 0);
+#else
+  (void)addr;
+  (void)len;
+  (void)numa_node;
+  return -1;
+#endif
+}
+
 int
 ats_mlock(caddr_t addr, size_t len)
 {
@@ -91,6 +91,7 @@ int ats_mallopt(int param, int value);
 int ats_msync(caddr_t addr, size_t len, caddr_t end, int flags);
 int ats_madvise(caddr_t addr, size_t len, int flags);
 int ats_mlock(caddr_t addr, size_t len);
+int ats_mbind(caddr_t addr, size_t len, int numa_node);
 
 static inline size_t __attribute__((const)) ats_pagesize(void)
 {
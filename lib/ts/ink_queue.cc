@@ -43,6 +43,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include "ink_thread.h"
 #include "ink_atomic.h"
 #include "ink_queue.h"
 #include "ink_memory.h"
@@ -80,6 +81,38 @@ inkcoreapi volatile int64_t freelist_allocated_mem = 0;
 
 #define fl_memadd(_x_) ink_atomic_increment(&freelist_allocated_mem, (int64_t)(_x_));
 
+/*
+ * Per-thread magazines, after Bonwick's "Magazines and Vmem".  A thread
+ * allocates from and frees to the magazines it holds for a freelist
+ * without any atomic operation; only when both are empty (or both full)
+ * does it trade a whole magazine with the freelist's depot, which costs
+ * one CAS for magazine_size items.  The depot holds at most one full
+ * magazine per thread using the list; beyond that, full magazines go back
+ * to the global freelist in a single ink_freelist_free_bulk().
+ *
+ * Items cached in magazines still count as used by the freelist.
+ */
+#if !TS_USE_RECLAIMABLE_FREELIST
+#define MAX_NUM_MAGAZINE_FREELIST 1024
+#define MAX_MAGAZINE_BYTE_SIZE (64 * 1024)
+
+static uint32_t magazine_rounds = 0;
+static volatile int nr_magazine_freelist = 0;
+
+static uint32_t
+magazine_size_for(InkFreeList *f)
+{
+  uint32_t n = magazine_rounds;
+
+  // The depot links magazines through the second word of their first item.
+  if (f->magazine_idx < 0 || f->type_size < 2 * sizeof(void *))
+    return 0;
+  if (n * f->type_size > MAX_MAGAZINE_BYTE_SIZE)
+    n = MAX_MAGAZINE_BYTE_SIZE / f->type_size;
+  return n < 2 ? 0 : n;
+}
+#endif /* !TS_USE_RECLAIMABLE_FREELIST */
+
 void
 ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size, uint32_t chunk_size, uint32_t alignment)
 {
@@ -115,6 +148,16 @@ ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size, uint32
   f->allocated_base = 0;
   f->used_base = 0;
   f->advice = 0;
+  f->numa_node = -1;
+
+  f->magazine_idx = ink_atomic_increment(&nr_magazine_freelist, 1);
+  if (f->magazine_idx >= MAX_NUM_MAGAZINE_FREELIST)
+    f->magazine_idx = -1;
+  f->magazine_size = magazine_size_for(f);
+  ink_atomiclist_init(&f->depot, name, sizeof(void *));
+  f->depot_count = 0;
+  f->magazine_count = 0;
+  f->magazines = NULL;
   *fl = f;
 #endif
 }
@@ -131,6 +174,19 @@ ink_freelist_madvise_init(InkFreeList **fl, const char *name, uint32_t type_size
 #endif
 }
 
+void
+ink_freelist_numa_init(InkFreeList **fl, const char *name, uint32_t type_size, uint32_t chunk_size, uint32_t alignment,
+                       int advice, int numa_node)
+{
+  ink_freelist_madvise_init(fl, name, type_size, chunk_size, alignment, advice);
+#if TS_USE_RECLAIMABLE_FREELIST
+  // Chunks of the reclaimable freelist are owned by the allocating thread.
+  (void)numa_node;
+#else
+  (*fl)->numa_node = numa_node;
+#endif
+}
+
 InkFreeList *
 ink_freelist_create(const char *name, uint32_t type_size, uint32_t chunk_size, uint32_t alignment)
 {
@@ -147,13 +203,21 @@ int fake_global_for_ink_queue = 0;
 #endif
 
 int fastmemtotal = 0;
-void *
-ink_freelist_new(InkFreeList *f)
+
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+static __thread InkFreeListMagazines *ThreadMagazines[MAX_NUM_MAGAZINE_FREELIST];
+static ink_thread_key magazine_key;
+static pthread_once_t magazine_key_once = PTHREAD_ONCE_INIT;
+// Guards the magazines list of every freelist.  It is only taken when a
+// thread first uses a list, when it exits, and by ink_freelists_dump().
+static ink_mutex magazines_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void freelist_free(InkFreeList *f, void *item);
+
+// Pops an item off the global list, allocating a new chunk when it is empty.
+static void *
+freelist_new(InkFreeList *f)
 {
-#if TS_USE_FREELIST
-#if TS_USE_RECLAIMABLE_FREELIST
-  return reclaimable_freelist_new(f);
-#else
   head_p item;
   head_p next;
   int result = 0;
@@ -185,6 +249,10 @@ ink_freelist_new(InkFreeList *f)
         else
           newp = ats_malloc(f->chunk_size * type_size);
       }
+      // Bind before the loop below touches the chunk, so that its pages are
+      // faulted in on the requested node.
+      if (f->numa_node >= 0)
+        ats_mbind((caddr_t)newp, f->chunk_size * type_size, f->numa_node);
       ats_madvise((caddr_t)newp, f->chunk_size * type_size, f->advice);
       fl_memadd(f->chunk_size * type_size);
 #ifdef DEBUG
@@ -206,7 +274,7 @@ ink_freelist_new(InkFreeList *f)
         for (int j = 0; j < (int)type_size; j++)
           a[j] = str[j % 4];
 #endif
-        ink_freelist_free(f, a);
+        freelist_free(f, a);
 #ifdef MEMPROTECT
         if (f->type_size >= MEMPROTECT_SIZE) {
           a += type_size - page_size;
@@ -244,26 +312,12 @@ ink_freelist_new(InkFreeList *f)
   ink_atomic_increment(&fastalloc_mem_in_use, (int64_t)f->type_size);
 
   return TO_PTR(FREELIST_POINTER(item));
-#endif /* TS_USE_RECLAIMABLE_FREELIST */
-#else  // ! TS_USE_FREELIST
-  void *newp = NULL;
-
-  if (f->alignment)
-    newp = ats_memalign(f->alignment, f->type_size);
-  else
-    newp = ats_malloc(f->type_size);
-  ats_madvise((caddr_t)newp, f->type_size, f->advice);
-  return newp;
-#endif
 }
 
-void
-ink_freelist_free(InkFreeList *f, void *item)
+// Pushes an item onto the global list.
+static void
+freelist_free(InkFreeList *f, void *item)
 {
-#if TS_USE_FREELIST
-#if TS_USE_RECLAIMABLE_FREELIST
-  return reclaimable_freelist_free(f, item);
-#else
   volatile void **adr_of_next = (volatile void **)ADDRESS_OF_NEXT(item, 0);
   head_p h;
   head_p item_pair;
@@ -303,6 +357,180 @@ ink_freelist_free(InkFreeList *f, void *item)
 
   ink_atomic_increment((int *)&f->used, -1);
   ink_atomic_increment(&fastalloc_mem_in_use, -(int64_t)f->type_size);
+}
+
+// Returns a chain of n items linked through their first word to the global
+// list with a single CAS.
+static void
+magazine_release(InkFreeList *f, void *head, uint32_t n)
+{
+  void *tail = head;
+
+  for (uint32_t i = 1; i < n; i++)
+    tail = *(void **)tail;
+  ink_freelist_free_bulk(f, head, tail, n);
+}
+
+static void
+magazines_thread_exit(void *)
+{
+  int n = nr_magazine_freelist < MAX_NUM_MAGAZINE_FREELIST ? nr_magazine_freelist : MAX_NUM_MAGAZINE_FREELIST;
+
+  for (int i = 0; i < n; i++) {
+    InkFreeListMagazines *m = ThreadMagazines[i];
+
+    if (m == NULL)
+      continue;
+    if (m->nloaded)
+      magazine_release(m->f, m->loaded, m->nloaded);
+    if (m->nprevious)
+      magazine_release(m->f, m->previous, m->nprevious);
+    ThreadMagazines[i] = NULL;
+
+    ink_mutex_acquire(&magazines_mutex);
+    for (InkFreeListMagazines **p = &m->f->magazines; *p; p = &(*p)->next) {
+      if (*p == m) {
+        *p = m->next;
+        break;
+      }
+    }
+    ink_mutex_release(&magazines_mutex);
+    ink_atomic_increment((int *)&m->f->magazine_count, -1);
+    ats_free(m);
+  }
+}
+
+static void
+magazine_key_init()
+{
+  ink_thread_key_create(&magazine_key, magazines_thread_exit);
+}
+
+static inline InkFreeListMagazines *
+thread_magazines(InkFreeList *f)
+{
+  InkFreeListMagazines *m = ThreadMagazines[f->magazine_idx];
+
+  if (likely(m != NULL))
+    return m;
+
+  // First use of this list by this thread.  The thread key only exists to
+  // hand the magazines back when the thread exits.
+  pthread_once(&magazine_key_once, magazine_key_init);
+  ink_thread_setspecific(magazine_key, (void *)ThreadMagazines);
+
+  m = (InkFreeListMagazines *)ats_calloc(1, sizeof(InkFreeListMagazines));
+  m->f = f;
+  ink_mutex_acquire(&magazines_mutex);
+  m->next = f->magazines;
+  f->magazines = m;
+  ink_mutex_release(&magazines_mutex);
+  ink_atomic_increment((int *)&f->magazine_count, 1);
+  ThreadMagazines[f->magazine_idx] = m;
+  return m;
+}
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
+void
+ink_freelist_magazines_init(uint32_t magazine_size)
+{
+#if !TS_USE_RECLAIMABLE_FREELIST
+  ink_freelist_list *fll;
+
+  magazine_rounds = magazine_size;
+  for (fll = freelists; fll; fll = fll->next)
+    fll->fl->magazine_size = magazine_size_for(fll->fl);
+#else
+  (void)magazine_size;
+#endif
+}
+
+void *
+ink_freelist_new(InkFreeList *f)
+{
+#if TS_USE_FREELIST
+#if TS_USE_RECLAIMABLE_FREELIST
+  return reclaimable_freelist_new(f);
+#else
+  if (f->magazine_size) {
+    InkFreeListMagazines *m = thread_magazines(f);
+
+    if (m->nloaded == 0) {
+      if (m->nprevious) {
+        m->loaded = m->previous;
+        m->nloaded = m->nprevious;
+        m->previous = NULL;
+        m->nprevious = 0;
+      } else if ((m->loaded = ink_atomiclist_pop(&f->depot)) != NULL) {
+        ink_atomic_increment((int *)&f->depot_count, -1);
+        m->nloaded = f->magazine_size;
+      }
+    }
+    if (m->nloaded) {
+      void *item = m->loaded;
+
+      m->loaded = *(void **)item;
+      m->nloaded--;
+      m->hits++;
+      return item;
+    }
+    m->misses++;
+  }
+  return freelist_new(f);
+#endif /* TS_USE_RECLAIMABLE_FREELIST */
+#else  // ! TS_USE_FREELIST
+  void *newp = NULL;
+
+  if (f->alignment)
+    newp = ats_memalign(f->alignment, f->type_size);
+  else
+    newp = ats_malloc(f->type_size);
+  ats_madvise((caddr_t)newp, f->type_size, f->advice);
+  return newp;
+#endif
+}
+
+void
+ink_freelist_free(InkFreeList *f, void *item)
+{
+#if TS_USE_FREELIST
+#if TS_USE_RECLAIMABLE_FREELIST
+  return reclaimable_freelist_free(f, item);
+#else
+  if (f->magazine_size) {
+    InkFreeListMagazines *m = thread_magazines(f);
+
+    if (m->nloaded >= f->magazine_size) {
+      if (m->nprevious) {
+        // Both magazines are full: hand the older one to the depot, or
+        // back to the global list if the depot is already at its bound.
+        if (m->nprevious == f->magazine_size && f->depot_count < f->magazine_count) {
+          ink_atomic_increment((int *)&f->depot_count, 1);
+          ink_atomiclist_push(&f->depot, m->previous);
+        } else {
+          magazine_release(f, m->previous, m->nprevious);
+        }
+      }
+      m->previous = m->loaded;
+      m->nprevious = m->nloaded;
+      m->loaded = NULL;
+      m->nloaded = 0;
+    }
+#ifdef DEADBEEF
+    {
+      static const char str[4] = {(char)0xde, (char)0xad, (char)0xbe, (char)0xef};
+
+      // set the entire item to DEADBEEF, as freelist_free() does
+      for (int j = 0; j < (int)f->type_size; j++)
+        ((char *)item)[j] = str[j % 4];
+    }
+#endif /* DEADBEEF */
+    *(void **)item = m->loaded;
+    m->loaded = item;
+    m->nloaded++;
+    return;
+  }
+  freelist_free(f, item);
 #endif /* TS_USE_RECLAIMABLE_FREELIST */
 #else
   if (f->alignment)
@@ -438,14 +666,34 @@ ink_freelists_dump(FILE *f)
   if (f == NULL)
     f = stderr;
 
-  fprintf(f, "     allocated      |        in-use      | type size  |   free list name\n");
-  fprintf(f, "--------------------|--------------------|------------|----------------------------------\n");
+  fprintf(f, "     allocated      |        in-use      |    in magazines    | hit rate | type size  |   free list name\n");
+  fprintf(f, "--------------------|--------------------|--------------------|----------|------------|----------------------------------\n");
 
   fll = freelists;
   while (fll) {
-    fprintf(f, " %18" PRIu64 " | %18" PRIu64 " | %10u | memory/%s\n", (uint64_t)fll->fl->allocated * (uint64_t)fll->fl->type_size,
-            (uint64_t)fll->fl->used * (uint64_t)fll->fl->type_size, fll->fl->type_size,
-            fll->fl->name ? fll->fl->name : "<unknown>");
+    uint64_t used = fll->fl->used, cached = 0, hits = 0, misses = 0;
+    char hit_rate[16];
+
+#if !TS_USE_RECLAIMABLE_FREELIST
+    // The counters are read without synchronization, which is fine for a dump;
+    // the lock only keeps exiting threads from freeing the entries under us.
+    ink_mutex_acquire(&magazines_mutex);
+    for (InkFreeListMagazines *m = fll->fl->magazines; m; m = m->next) {
+      cached += m->nloaded + m->nprevious;
+      hits += m->hits;
+      misses += m->misses;
+    }
+    ink_mutex_release(&magazines_mutex);
+    cached += (uint64_t)fll->fl->depot_count * fll->fl->magazine_size;
+#endif
+    used = used > cached ? used - cached : 0;
+    if (hits + misses)
+      snprintf(hit_rate, sizeof(hit_rate), "%7.2f%%", 100.0 * hits / (hits + misses));
+    else
+      snprintf(hit_rate, sizeof(hit_rate), "%8s", "-");
+    fprintf(f, " %18" PRIu64 " | %18" PRIu64 " | %18" PRIu64 " | %s | %10u | memory/%s\n",
+            (uint64_t)fll->fl->allocated * (uint64_t)fll->fl->type_size, used * (uint64_t)fll->fl->type_size,
+            cached * (uint64_t)fll->fl->type_size, hit_rate, fll->fl->type_size, fll->fl->name ? fll->fl->name : "<unknown>");
     fll = fll->next;
   }
 #else // ! TS_USE_FREELIST
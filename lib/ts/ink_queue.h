@@ -144,6 +144,12 @@ typedef union {
 #error "unsupported processor"
 #endif
 
+typedef struct {
+  volatile head_p head;
+  const char *name;
+  uint32_t offset;
+} InkAtomicList;
+
 #if TS_USE_RECLAIMABLE_FREELIST
 extern float cfg_reclaim_factor;
 extern int64_t cfg_max_overage;
@@ -156,8 +162,29 @@ struct _InkFreeList {
   uint32_t type_size, chunk_size, used, allocated, alignment;
   uint32_t allocated_base, used_base;
   int advice;
+  int numa_node; /* bind new chunks to this NUMA node, -1 for none */
+
+  /* Per-thread magazines (see ink_freelist_magazines_init).  Each thread
+     keeps up to two magazines of magazine_size items for this list, and
+     trades full magazines with other threads through the depot. */
+  uint32_t magazine_size; /* items per magazine, 0 when disabled */
+  int magazine_idx;       /* slot in each thread's magazine table, -1 for none */
+  InkAtomicList depot;    /* full magazines, linked through the second word of their first item */
+  volatile uint32_t depot_count;
+  volatile uint32_t magazine_count; /* threads holding magazines for this list */
+  struct _InkFreeListMagazines *magazines;
 };
 
+/* The magazines one thread holds for one freelist.  Items in a magazine
+   are chained through their first word, like the freelist itself. */
+typedef struct _InkFreeListMagazines {
+  struct _InkFreeList *f;
+  void *loaded, *previous;
+  uint32_t nloaded, nprevious;
+  uint64_t hits, misses;
+  struct _InkFreeListMagazines *next;
+} InkFreeListMagazines;
+
 inkcoreapi extern volatile int64_t fastalloc_mem_in_use;
 inkcoreapi extern volatile int64_t fastalloc_mem_total;
 inkcoreapi extern volatile int64_t freelist_allocated_mem;
@@ -178,6 +205,9 @@ InkFreeList *ink_freelist_create(const char *name, uint32_t type_size, uint32_t
 inkcoreapi void ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size, uint32_t chunk_size, uint32_t alignment);
 inkcoreapi void ink_freelist_madvise_init(InkFreeList **fl, const char *name, uint32_t type_size, uint32_t chunk_size,
                                           uint32_t alignment, int advice);
+inkcoreapi void ink_freelist_numa_init(InkFreeList **fl, const char *name, uint32_t type_size, uint32_t chunk_size,
+                                       uint32_t alignment, int advice, int numa_node);
+void ink_freelist_magazines_init(uint32_t magazine_size);
 inkcoreapi void *ink_freelist_new(InkFreeList *f);
 inkcoreapi void ink_freelist_free(InkFreeList *f, void *item);
 inkcoreapi void ink_freelist_free_bulk(InkFreeList *f, void *head, void *tail, size_t num_item);
@@ -185,12 +215,6 @@ void ink_freelists_dump(FILE *f);
 void ink_freelists_dump_baselinerel(FILE *f);
 void ink_freelists_snap_baseline();
 
-typedef struct {
-  volatile head_p head;
-  const char *name;
-  uint32_t offset;
-} InkAtomicList;
-
 #if !defined(INK_QUEUE_NT)
 #define INK_ATOMICLIST_EMPTY(_x) (!(TO_PTR(FREELIST_POINTER((_x.head)))))
 #else
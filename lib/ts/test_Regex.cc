@@ -53,9 +53,68 @@ test_basic()
   }
 }
 
+typedef struct {
+  char regex[100];
+  char literal[100];
+} literal_t;
+
+static const literal_t literal_data[] = {
+  {"^(.*)\\.example\\.com$", ".example.com"},
+  {"^www[0-9]+\\.Foo\\.org", ".foo.org"},
+  {"^a+bcdefg?hi", "bcdef"},
+  {"cdn(-[a-z]+)?\\.net", ".net"},
+  {"x{2,3}yz", "yz"},
+  {"^(www|cdn)\\.(a|b)\\.com$", ".com"},
+  {"foo|barbaz", ""},
+  {"^\\d+$", ""},
+  {"\\x41bc", ""},
+};
+
+static const char *prefilter_subjects[] = {
+  "www.example.com", "WWW.EXAMPLE.COM", "www12.foo.org", "aaabcdehi", "cdn-edge.net", "xxxyz", "cdn.b.com", "barbaz", "1234", "Abc",
+  "nothing",
+};
+
+static void
+test_prefilter()
+{
+  RegexPrefilter pf;
+  Regex re[countof(literal_data)];
+
+  for (unsigned int i = 0; i < countof(literal_data); i++) {
+    char buf[RegexPrefilter::MAX_LITERAL];
+    int len = RegexPrefilter::required_literal(literal_data[i].regex, buf, sizeof(buf));
+
+    printf("Regex: %s Literal: %.*s\n", literal_data[i].regex, len, buf);
+    ink_assert((size_t)len == strlen(literal_data[i].literal) && memcmp(buf, literal_data[i].literal, len) == 0);
+    ink_assert(pf.add(literal_data[i].regex) == (int)i);
+    re[i].compile(literal_data[i].regex, RE_CASE_INSENSITIVE);
+  }
+  pf.compile();
+
+  // Anything that matches has to be a candidate.
+  for (unsigned int j = 0; j < countof(prefilter_subjects); j++) {
+    bool candidates[countof(literal_data)];
+
+    pf.scan(prefilter_subjects[j], strlen(prefilter_subjects[j]), candidates);
+    for (unsigned int i = 0; i < countof(literal_data); i++) {
+      if (re[i].exec(prefilter_subjects[j])) {
+        ink_assert(candidates[i]);
+      }
+    }
+  }
+
+  // And literals that are absent must filter.
+  bool candidates[countof(literal_data)];
+  pf.scan("nothing", 7, candidates);
+  ink_assert(!candidates[0] && !candidates[1] && !candidates[4]);
+  ink_assert(candidates[6] && candidates[7] && candidates[8]);
+}
+
 int
 main(int /* argc ATS_UNUSED */, char ** /* argv ATS_UNUSED */)
 {
   test_basic();
+  test_prefilter();
   printf("test_Regex PASSED\n");
 }
@@ -93,7 +93,9 @@ enum ParserState {
   kParseEnable,
   kParseCache,
   kParseDisallow,
-  kParseFlush
+  kParseFlush,
+  kParseAlgorithms,
+  kParseLevel
 };
 
 void
@@ -114,6 +116,29 @@ HostConfiguration::add_compressible_content_type(const std::string &content_type
   compressible_content_types_.push_back(content_type);
 }
 
+void
+HostConfiguration::set_compression_algorithms(const std::string &algorithms)
+{
+  vector<string> v = tokenize(algorithms, ispunct);
+
+  compression_algorithms_ = 0;
+  for (size_t i = 0; i < v.size(); i++) {
+    if (v[i] == "gzip") {
+      compression_algorithms_ |= COMPRESSION_TYPE_GZIP;
+    } else if (v[i] == "deflate") {
+      compression_algorithms_ |= COMPRESSION_TYPE_DEFLATE;
+    } else if (v[i] == "br") {
+#if HAVE_BROTLI_ENCODE_H
+      compression_algorithms_ |= COMPRESSION_TYPE_BROTLI;
+#else
+      warning("brotli support is not compiled in, ignoring \"br\"");
+#endif
+    } else {
+      warning("unknown compression algorithm \"%s\"", v[i].c_str());
+    }
+  }
+}
+
 HostConfiguration *
 Configuration::Find(const char *host, int host_length)
 {
@@ -248,6 +273,10 @@ Configuration::Parse(const char *path)
           state = kParseDisallow;
         } else if (token == "flush") {
           state = kParseFlush;
+        } else if (token == "supported-algorithms") {
+          state = kParseAlgorithms;
+        } else if (token == "compression-level") {
+          state = kParseLevel;
         } else {
           warning("failed to interpret \"%s\" at line %zu", token.c_str(), lineno);
         }
@@ -276,6 +305,18 @@ Configuration::Parse(const char *path)
         current_host_configuration->set_flush(token == "true");
         state = kParseStart;
         break;
+      case kParseAlgorithms:
+        current_host_configuration->set_compression_algorithms(token);
+        state = kParseStart;
+        break;
+      case kParseLevel:
+        if (token == "auto") {
+          current_host_configuration->set_compression_level(COMPRESSION_LEVEL_AUTO);
+        } else {
+          current_host_configuration->set_compression_level(atoi(token.c_str()));
+        }
+        state = kParseStart;
+        break;
       }
     }
   }
@@ -28,6 +28,7 @@
 #include <string>
 #include <vector>
 #include "debug_macros.h"
+#include "misc.h"
 
 namespace Gzip
 {
@@ -35,7 +36,8 @@ class HostConfiguration
 {
 public: // todo -> only configuration should be able to construct hostconfig
   explicit HostConfiguration(const std::string &host)
-    : host_(host), enabled_(true), cache_(true), remove_accept_encoding_(false), flush_(false)
+    : host_(host), enabled_(true), cache_(true), remove_accept_encoding_(false), flush_(false),
+      compression_algorithms_(COMPRESSION_TYPE_GZIP | COMPRESSION_TYPE_DEFLATE), compression_level_(COMPRESSION_LEVEL_AUTO)
   {
   }
 
@@ -79,6 +81,21 @@ public: // todo -> only configuration should be able to construct hostconfig
   {
     remove_accept_encoding_ = x;
   }
+  inline int
+  compression_algorithms()
+  {
+    return compression_algorithms_;
+  }
+  inline int
+  compression_level()
+  {
+    return compression_level_;
+  }
+  inline void
+  set_compression_level(int x)
+  {
+    compression_level_ = x;
+  }
   inline std::string
   host()
   {
@@ -86,6 +103,7 @@ public: // todo -> only configuration should be able to construct hostconfig
   }
   void add_disallow(const std::string &disallow);
   void add_compressible_content_type(const std::string &content_type);
+  void set_compression_algorithms(const std::string &algorithms);
   bool IsUrlAllowed(const char *url, int url_len);
   bool ContentTypeIsCompressible(const char *content_type, int content_type_length);
 
@@ -95,6 +113,8 @@ private:
   bool cache_;
   bool remove_accept_encoding_;
   bool flush_;
+  int compression_algorithms_;
+  int compression_level_;
   std::vector<std::string> compressible_content_types_;
   std::vector<std::string> disallows_;
   DISALLOW_COPY_AND_ASSIGN(HostConfiguration);
@@ -38,17 +38,10 @@ using namespace Gzip;
 // FIXME: look into autoscaling the compression level based on connection speed
 // a gprs device might benefit from a higher compression ratio, whereas a desktop w. high bandwith
 // might be served better with little or no compression at all
+// (compression-level auto does scale by object size, cacheability and cpu load)
 // FIXME: look into compressing from the task thread pool
 // FIXME: make normalizing accept encoding configurable
 
-// from mod_deflate:
-// ZLIB's compression algorithm uses a
-// 0-9 based scale that GZIP does where '1' is 'Best speed'
-// and '9' is 'Best compression'. Testing has proved level '6'
-// to be about the best level to use in an HTTP Server.
-
-const int ZLIB_COMPRESSION_LEVEL = 6;
-
 int arg_idx_hooked;
 int arg_idx_host_configuration;
 int arg_idx_url_disallowed;
@@ -59,7 +52,7 @@ Configuration *config = NULL;
 const char *dictionary = NULL;
 
 static GzipData *
-gzip_data_alloc(int compression_type)
+gzip_data_alloc(int compression_type, int compression_level)
 {
   GzipData *data;
   int err;
@@ -71,6 +64,7 @@ gzip_data_alloc(int compression_type)
   data->downstream_length = 0;
   data->state = transform_state_initialized;
   data->compression_type = compression_type;
+  data->compression_level = compression_level;
   data->zstrm.next_in = Z_NULL;
   data->zstrm.avail_in = 0;
   data->zstrm.total_in = 0;
@@ -82,9 +76,24 @@ gzip_data_alloc(int compression_type)
   data->zstrm.opaque = (voidpf)0;
   data->zstrm.data_type = Z_ASCII;
 
+#if HAVE_BROTLI_ENCODE_H
+  data->bstrm = NULL;
+  data->total_in = 0;
+  if (compression_type == COMPRESSION_TYPE_BROTLI) {
+    data->bstrm = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+    if (!data->bstrm) {
+      fatal("gzip-transform: ERROR: BrotliEncoderCreateInstance failed!");
+    }
+    BrotliEncoderSetParameter(data->bstrm, BROTLI_PARAM_QUALITY, compression_level);
+    BrotliEncoderSetParameter(data->bstrm, BROTLI_PARAM_LGWIN, BROTLI_LGWIN);
+    BrotliEncoderSetParameter(data->bstrm, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+    return data;
+  }
+#endif
+
   int window_bits = (compression_type == COMPRESSION_TYPE_GZIP) ? WINDOW_BITS_GZIP : WINDOW_BITS_DEFLATE;
 
-  err = deflateInit2(&data->zstrm, ZLIB_COMPRESSION_LEVEL, Z_DEFLATED, window_bits, ZLIB_MEMLEVEL, Z_DEFAULT_STRATEGY);
+  err = deflateInit2(&data->zstrm, compression_level, Z_DEFLATED, window_bits, ZLIB_MEMLEVEL, Z_DEFAULT_STRATEGY);
 
   if (err != Z_OK) {
     fatal("gzip-transform: ERROR: deflateInit (%d)!", err);
@@ -106,9 +115,16 @@ gzip_data_destroy(GzipData *data)
 {
   TSReleaseAssert(data);
 
-  // deflateEnd returnvalue ignore is intentional
-  // it would spew log on every client abort
-  deflateEnd(&data->zstrm);
+#if HAVE_BROTLI_ENCODE_H
+  if (data->bstrm) {
+    BrotliEncoderDestroyInstance(data->bstrm);
+  } else
+#endif
+  {
+    // deflateEnd returnvalue ignore is intentional
+    // it would spew log on every client abort
+    deflateEnd(&data->zstrm);
+  }
 
   if (data->downstream_buffer) {
     TSIOBufferDestroy(data->downstream_buffer);
@@ -130,6 +146,8 @@ gzip_content_encoding_header(TSMBuffer bufp, TSMLoc hdr_loc, const int compressi
       ret = TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, ce_loc, -1, "deflate", sizeof("deflate") - 1);
     } else if (compression_type == COMPRESSION_TYPE_GZIP) {
       ret = TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, ce_loc, -1, "gzip", sizeof("gzip") - 1);
+    } else if (compression_type == COMPRESSION_TYPE_BROTLI) {
+      ret = TSMimeHdrFieldValueStringInsert(bufp, hdr_loc, ce_loc, -1, "br", sizeof("br") - 1);
     }
     if (ret == TS_SUCCESS) {
       ret = TSMimeHdrFieldAppend(bufp, hdr_loc, ce_loc);
@@ -188,7 +206,7 @@ gzip_vary_header(TSMBuffer bufp, TSMLoc hdr_loc)
 // FIXME: the etag alteration isn't proper. it should modify the value inside quotes
 //       specify a very header..
 static TSReturnCode
-gzip_etag_header(TSMBuffer bufp, TSMLoc hdr_loc)
+gzip_etag_header(TSMBuffer bufp, TSMLoc hdr_loc, const int compression_type)
 {
   TSReturnCode ret = TS_SUCCESS;
   TSMLoc ce_loc;
@@ -206,7 +224,9 @@ gzip_etag_header(TSMBuffer bufp, TSMLoc hdr_loc)
         changetag = 0;
       }
       if (changetag) {
-        ret = TSMimeHdrFieldValueAppend(bufp, hdr_loc, ce_loc, 0, "-df", 3);
+        // each encoding is a distinct entity, and a distinct cache alternate
+        const char *suffix = (compression_type == COMPRESSION_TYPE_BROTLI) ? "-br" : "-df";
+        ret = TSMimeHdrFieldValueAppend(bufp, hdr_loc, ce_loc, 0, suffix, 3);
       }
     }
     TSHandleMLocRelease(bufp, hdr_loc, ce_loc);
@@ -238,7 +258,8 @@ gzip_transform_init(TSCont contp, GzipData *data)
   }
 
   if (gzip_content_encoding_header(bufp, hdr_loc, data->compression_type) == TS_SUCCESS &&
-      gzip_vary_header(bufp, hdr_loc) == TS_SUCCESS && gzip_etag_header(bufp, hdr_loc) == TS_SUCCESS) {
+      gzip_vary_header(bufp, hdr_loc) == TS_SUCCESS &&
+      gzip_etag_header(bufp, hdr_loc, data->compression_type) == TS_SUCCESS) {
     downstream_conn = TSTransformOutputVConnGet(contp);
     data->downstream_buffer = TSIOBufferCreate();
     data->downstream_reader = TSIOBufferReaderAlloc(data->downstream_buffer);
@@ -249,6 +270,81 @@ gzip_transform_init(TSCont contp, GzipData *data)
 }
 
 
+#if HAVE_BROTLI_ENCODE_H
+// Run the brotli encoder until it has consumed its input and, for
+// flush and finish, until it has produced all pending output.
+static bool
+brotli_compress_operation(GzipData *data, const char *upstream_buffer, int64_t upstream_length, BrotliEncoderOperation op)
+{
+  TSIOBufferBlock downstream_blkp;
+  char *downstream_buffer;
+  int64_t downstream_length;
+  size_t avail_in = upstream_length;
+  const uint8_t *next_in = (const uint8_t *)upstream_buffer;
+
+  for (;;) {
+    downstream_blkp = TSIOBufferStart(data->downstream_buffer);
+    downstream_buffer = TSIOBufferBlockWriteStart(downstream_blkp, &downstream_length);
+
+    size_t avail_out = downstream_length;
+    uint8_t *next_out = (uint8_t *)downstream_buffer;
+
+    if (!BrotliEncoderCompressStream(data->bstrm, op, &avail_in, &next_in, &avail_out, &next_out, NULL)) {
+      error("brotli compression failed");
+      return false;
+    }
+
+    if (downstream_length > (int64_t)avail_out) {
+      TSIOBufferProduce(data->downstream_buffer, downstream_length - avail_out);
+      data->downstream_length += (downstream_length - avail_out);
+    }
+
+    if (avail_in == 0 && !BrotliEncoderHasMoreOutput(data->bstrm) &&
+        (op != BROTLI_OPERATION_FINISH || BrotliEncoderIsFinished(data->bstrm))) {
+      break;
+    }
+  }
+
+  data->total_in += upstream_length;
+  return true;
+}
+
+static void
+brotli_transform_one(GzipData *data, TSIOBufferReader upstream_reader, int amount)
+{
+  TSIOBufferBlock upstream_blkp;
+  const char *upstream_buffer;
+  int64_t upstream_length;
+
+  TSHttpTxn txnp = (TSHttpTxn)data->txn;
+  HostConfiguration *hc = (HostConfiguration *)TSHttpTxnArgGet(txnp, arg_idx_host_configuration);
+
+  while (amount > 0) {
+    upstream_blkp = TSIOBufferReaderStart(upstream_reader);
+    if (!upstream_blkp) {
+      error("couldn't get from IOBufferBlock");
+      return;
+    }
+
+    upstream_buffer = TSIOBufferBlockReadStart(upstream_blkp, upstream_reader, &upstream_length);
+    if (!upstream_buffer) {
+      error("couldn't get from TSIOBufferBlockReadStart");
+      return;
+    }
+
+    if (upstream_length > amount) {
+      upstream_length = amount;
+    }
+
+    brotli_compress_operation(data, upstream_buffer, upstream_length,
+                              hc->flush() ? BROTLI_OPERATION_FLUSH : BROTLI_OPERATION_PROCESS);
+
+    TSIOBufferReaderConsume(upstream_reader, upstream_length);
+    amount -= upstream_length;
+  }
+}
+#endif
+
 static void
 gzip_transform_one(GzipData *data, TSIOBufferReader upstream_reader, int amount)
 {
@@ -258,6 +354,13 @@ gzip_transform_one(GzipData *data, TSIOBufferReader upstream_reader, int amount)
   int64_t upstream_length, downstream_length;
   int err;
 
+#if HAVE_BROTLI_ENCODE_H
+  if (data->bstrm) {
+    brotli_transform_one(data, upstream_reader, amount);
+    return;
+  }
+#endif
+
   TSHttpTxn txnp = (TSHttpTxn)data->txn;
   HostConfiguration *hc = (HostConfiguration *)TSHttpTxnArgGet(txnp, arg_idx_host_configuration);
 
@@ -327,6 +430,14 @@ gzip_transform_finish(GzipData *data)
 
     data->state = transform_state_finished;
 
+#if HAVE_BROTLI_ENCODE_H
+    if (data->bstrm) {
+      brotli_compress_operation(data, NULL, 0, BROTLI_OPERATION_FINISH);
+      gzip_log_ratio(data->total_in, data->downstream_length);
+      return;
+    }
+#endif
+
     for (;;) {
       downstream_blkp = TSIOBufferStart(data->downstream_buffer);
 
@@ -468,11 +579,9 @@ gzip_transformable(TSHttpTxn txnp, int server, HostConfiguration *host_configura
   /* Client request header */
   TSMBuffer cbuf;
   TSMLoc chdr;
-  TSMLoc cfield;
 
   const char *value;
-  int nvalues;
-  int i, compression_acceptable, len;
+  int len;
 
   TSHttpStatus resp_status;
   if (server) {
@@ -500,38 +609,11 @@ gzip_transformable(TSHttpTxn txnp, int server, HostConfiguration *host_configura
     return 0;
   }
 
-  cfield = TSMimeHdrFieldFind(cbuf, chdr, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
-  if (cfield != TS_NULL_MLOC) {
-    compression_acceptable = 0;
-    nvalues = TSMimeHdrFieldValuesCount(cbuf, chdr, cfield);
-    for (i = 0; i < nvalues; i++) {
-      value = TSMimeHdrFieldValueStringGet(cbuf, chdr, cfield, i, &len);
-      if (!value) {
-        continue;
-      }
-
-      if (strncasecmp(value, "deflate", sizeof("deflate") - 1) == 0) {
-        compression_acceptable = 1;
-        *compress_type = COMPRESSION_TYPE_DEFLATE;
-        break;
-      } else if (strncasecmp(value, "gzip", sizeof("gzip") - 1) == 0) {
-        compression_acceptable = 1;
-        *compress_type = COMPRESSION_TYPE_GZIP;
-        break;
-      }
-    }
+  *compress_type = accept_encoding_type(cbuf, chdr, host_configuration->compression_algorithms());
+  TSHandleMLocRelease(cbuf, TS_NULL_MLOC, chdr);
 
-    TSHandleMLocRelease(cbuf, chdr, cfield);
-    TSHandleMLocRelease(cbuf, TS_NULL_MLOC, chdr);
-
-    if (!compression_acceptable) {
-      info("no acceptable encoding found in request header, not compressible");
-      return 0;
-    }
-  } else {
+  if (!*compress_type) {
     info("no acceptable encoding found in request header, not compressible");
-    TSHandleMLocRelease(cbuf, chdr, cfield);
-    TSHandleMLocRelease(cbuf, TS_NULL_MLOC, chdr);
     return 0;
   }
 
@@ -572,8 +654,27 @@ gzip_transformable(TSHttpTxn txnp, int server, HostConfiguration *host_configura
 }
 
 
+static int64_t
+content_length(TSHttpTxn txnp, int server)
+{
+  TSMBuffer bufp;
+  TSMLoc hdr_loc;
+  int64_t length = -1;
+
+  if ((server ? TSHttpTxnServerRespGet(txnp, &bufp, &hdr_loc) : TSHttpTxnCachedRespGet(txnp, &bufp, &hdr_loc)) == TS_SUCCESS) {
+    TSMLoc field_loc = TSMimeHdrFieldFind(bufp, hdr_loc, TS_MIME_FIELD_CONTENT_LENGTH, TS_MIME_LEN_CONTENT_LENGTH);
+    if (field_loc) {
+      length = TSMimeHdrFieldValueInt64Get(bufp, hdr_loc, field_loc, -1);
+      TSHandleMLocRelease(bufp, hdr_loc, field_loc);
+    }
+    TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+  }
+
+  return length;
+}
+
 static void
-gzip_transform_add(TSHttpTxn txnp, int /* server ATS_UNUSED */, HostConfiguration *hc, int compress_type)
+gzip_transform_add(TSHttpTxn txnp, int server, HostConfiguration *hc, int compress_type)
 {
   int *tmp = (int *)TSHttpTxnArgGet(txnp, arg_idx_hooked);
   if (tmp) {
@@ -596,8 +697,13 @@ gzip_transform_add(TSHttpTxn txnp, int /* server ATS_UNUSED */, HostConfiguratio
   TSVConn connp;
   GzipData *data;
 
+  // only a response coming from the origin is written to cache; that one
+  // is compressed once for all the hits on its alternate.
+  bool cached = server && hc->cache();
+  int level = pick_compression_level(compress_type, hc->compression_level(), content_length(txnp, server), cached);
+
   connp = TSTransformCreate(gzip_transform, txnp);
-  data = gzip_data_alloc(compress_type);
+  data = gzip_data_alloc(compress_type, level);
   data->txn = txnp;
 
   TSContDataSet(connp, data);
@@ -625,6 +731,29 @@ cache_transformable(TSHttpTxn txnp)
   return 0;
 }
 
+// Was the identity alternate that we hit cached for a request that
+// already asked for the encoding the client wants now? If so, we have
+// been here before and the compressed variant did not get stored.
+static int
+cached_for_encoding(TSHttpTxn txnp, HostConfiguration *hc)
+{
+  TSMBuffer cbuf, bufp;
+  TSMLoc chdr, hdr_loc;
+  int cached_type = 0;
+  int type = 0;
+
+  if (TSHttpTxnClientReqGet(txnp, &cbuf, &chdr) == TS_SUCCESS) {
+    type = accept_encoding_type(cbuf, chdr, hc->compression_algorithms());
+    TSHandleMLocRelease(cbuf, TS_NULL_MLOC, chdr);
+  }
+  if (TSHttpTxnCachedReqGet(txnp, &bufp, &hdr_loc) == TS_SUCCESS) {
+    cached_type = accept_encoding_type(bufp, hdr_loc, hc->compression_algorithms());
+    TSHandleMLocRelease(bufp, TS_NULL_MLOC, hdr_loc);
+  }
+
+  return type == cached_type;
+}
+
 HostConfiguration *
 find_host_configuration(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer bufp, TSMLoc locp)
 {
@@ -665,7 +794,7 @@ transform_plugin(TSCont /* contp ATS_UNUSED */, TSEvent event, void *edata)
         TSHttpTxnArgSet(txnp, arg_idx_url_disallowed, (void *)&GZIP_ONE);
         info("url [%.*s] not allowed", url_len, url);
       } else {
-        normalize_accept_encoding(txnp, req_buf, req_loc);
+        normalize_accept_encoding(txnp, req_buf, req_loc, hc->compression_algorithms());
       }
       TSfree(url);
       TSHandleMLocRelease(req_buf, TS_NULL_MLOC, req_loc);
@@ -715,7 +844,16 @@ transform_plugin(TSCont /* contp ATS_UNUSED */, TSEvent event, void *edata)
     HostConfiguration *hc = (HostConfiguration *)TSHttpTxnArgGet(txnp, arg_idx_host_configuration);
     if (hc != NULL) {
       if (allowed && cache_transformable(txnp) && gzip_transformable(txnp, 0, hc, &compress_type)) {
-        gzip_transform_add(txnp, 0, hc, compress_type);
+        // alternate selection already refuses an identity alternate to a
+        // new gzip client; do the same for the other encodings: refetch
+        // once so that the compressed variant gets stored, rather than
+        // compressing the identity alternate again on every hit.
+        if (hc->cache() && compress_type != COMPRESSION_TYPE_GZIP && !cached_for_encoding(txnp, hc)) {
+          info("no alternate for this encoding yet, treating the hit as a miss");
+          TSHttpTxnCacheLookupStatusSet(txnp, TS_CACHE_LOOKUP_MISS);
+        } else {
+          gzip_transform_add(txnp, 0, hc, compress_type);
+        }
       }
     }
     TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
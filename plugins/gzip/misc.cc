@@ -26,7 +26,10 @@
 
 #include "misc.h"
 #include <string.h>
+#include <ctype.h>
 #include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
 #include "debug_macros.h"
 
 voidpf
@@ -41,35 +44,141 @@ gzip_free(voidpf /* opaque ATS_UNUSED */, voidpf address)
   TSfree(address);
 }
 
-void
-normalize_accept_encoding(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer reqp, TSMLoc hdr_loc)
+static inline bool
+is_space(char c)
+{
+  return isspace(static_cast<unsigned char>(c));
+}
+
+// Parse a qvalue ("0", "0.5", "1.000", ...) in [p, end) into thousandths.
+// Returns -1 if it is malformed.
+static int
+parse_qvalue(const char *p, const char *end)
+{
+  if (p == end || (*p != '0' && *p != '1')) {
+    return -1;
+  }
+
+  int q = (*p++ - '0') * 1000;
+  if (p < end && *p == '.') {
+    ++p;
+    for (int scale = 100; p < end && scale > 0 && isdigit(static_cast<unsigned char>(*p)); scale /= 10) {
+      q += (*p++ - '0') * scale;
+    }
+  }
+
+  return (p == end && q <= 1000) ? q : -1;
+}
+
+// Classify one Accept-Encoding value, ignoring its parameters other than q.
+// Values with q=0 are explicitly refused by the client and count as nothing.
+// Only [val, val + val_len) is looked at, the value is not NUL terminated.
+static int
+encoding_value_type(const char *val, int val_len)
+{
+  const char *end = val + val_len;
+  const char *name_end = val;
+
+  while (name_end < end && *name_end != ';' && !is_space(*name_end)) {
+    ++name_end;
+  }
+
+  // walk the ;-separated parameters looking for q
+  for (const char *param = (const char *)memchr(name_end, ';', end - name_end); param;) {
+    const char *param_end = (const char *)memchr(param + 1, ';', end - param - 1);
+    const char *b = param + 1;
+    const char *e = param_end ? param_end : end;
+
+    while (b < e && is_space(*b)) {
+      ++b;
+    }
+    while (e > b && is_space(e[-1])) {
+      --e;
+    }
+
+    const char *eq = (const char *)memchr(b, '=', e - b);
+    if (eq) {
+      const char *n_end = eq;
+      const char *v = eq + 1;
+
+      while (n_end > b && is_space(n_end[-1])) {
+        --n_end;
+      }
+      while (v < e && is_space(*v)) {
+        ++v;
+      }
+      if (n_end - b == 1 && (*b == 'q' || *b == 'Q') && parse_qvalue(v, e) == 0) {
+        return 0;
+      }
+    }
+    param = param_end;
+  }
+
+  int name_len = name_end - val;
+  if (name_len == (int)strlen("br") && !strncasecmp(val, "br", name_len)) {
+    return COMPRESSION_TYPE_BROTLI;
+  } else if (name_len == (int)strlen("gzip") && !strncasecmp(val, "gzip", name_len)) {
+    return COMPRESSION_TYPE_GZIP;
+  } else if (name_len == (int)strlen("deflate") && !strncasecmp(val, "deflate", name_len)) {
+    return COMPRESSION_TYPE_DEFLATE;
+  }
+  return 0;
+}
+
+// Pick the preferred encoding out of a set of accepted ones:
+// brotli, then gzip, then deflate.
+static int
+preferred_type(int accepted)
+{
+  if (accepted & COMPRESSION_TYPE_BROTLI) {
+    return COMPRESSION_TYPE_BROTLI;
+  } else if (accepted & COMPRESSION_TYPE_GZIP) {
+    return COMPRESSION_TYPE_GZIP;
+  } else if (accepted & COMPRESSION_TYPE_DEFLATE) {
+    return COMPRESSION_TYPE_DEFLATE;
+  }
+  return 0;
+}
+
+int
+accept_encoding_type(TSMBuffer reqp, TSMLoc hdr_loc, int algorithms)
 {
   TSMLoc field = TSMimeHdrFieldFind(reqp, hdr_loc, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
-  int deflate = 0;
-  int gzip = 0;
+  int accepted = 0;
 
-  // remove the accept encoding field(s),
-  // while finding out if gzip or deflate is supported.
   while (field) {
     TSMLoc tmp;
+    int value_count = TSMimeHdrFieldValuesCount(reqp, hdr_loc, field);
 
-    if (!deflate && !gzip) {
-      int value_count = TSMimeHdrFieldValuesCount(reqp, hdr_loc, field);
-
-      while (value_count > 0) {
-        int val_len = 0;
-        const char *val;
+    for (int i = 0; i < value_count; i++) {
+      int val_len = 0;
+      const char *val = TSMimeHdrFieldValueStringGet(reqp, hdr_loc, field, i, &val_len);
 
-        --value_count;
-        val = TSMimeHdrFieldValueStringGet(reqp, hdr_loc, field, value_count, &val_len);
-
-        if (val_len == (int)strlen("gzip"))
-          gzip = !strncmp(val, "gzip", val_len);
-        else if (val_len == (int)strlen("deflate"))
-          deflate = !strncmp(val, "deflate", val_len);
+      if (val) {
+        accepted |= encoding_value_type(val, val_len);
       }
     }
 
+    tmp = TSMimeHdrFieldNextDup(reqp, hdr_loc, field);
+    TSHandleMLocRelease(reqp, hdr_loc, field);
+    field = tmp;
+  }
+
+  return preferred_type(accepted & algorithms);
+}
+
+void
+normalize_accept_encoding(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer reqp, TSMLoc hdr_loc, int algorithms)
+{
+  // find out which of the supported algorithms is preferred,
+  // then replace the accept encoding field(s) by just that one
+  // so that the cache keeps at most one alternate per encoding.
+  int type = accept_encoding_type(reqp, hdr_loc, algorithms);
+  TSMLoc field = TSMimeHdrFieldFind(reqp, hdr_loc, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
+
+  while (field) {
+    TSMLoc tmp;
+
     tmp = TSMimeHdrFieldNextDup(reqp, hdr_loc, field);
     TSMimeHdrFieldDestroy(reqp, hdr_loc, field); // catch retval?
     TSHandleMLocRelease(reqp, hdr_loc, field);
@@ -77,17 +186,13 @@ normalize_accept_encoding(TSHttpTxn /* txnp ATS_UNUSED */, TSMBuffer reqp, TSMLo
   }
 
   // append a new accept-encoding field in the header
-  if (deflate || gzip) {
+  if (type) {
+    const char *name = (type == COMPRESSION_TYPE_BROTLI) ? "br" : (type == COMPRESSION_TYPE_GZIP) ? "gzip" : "deflate";
+
     TSMimeHdrFieldCreate(reqp, hdr_loc, &field);
     TSMimeHdrFieldNameSet(reqp, hdr_loc, field, TS_MIME_FIELD_ACCEPT_ENCODING, TS_MIME_LEN_ACCEPT_ENCODING);
-
-    if (gzip) {
-      TSMimeHdrFieldValueStringInsert(reqp, hdr_loc, field, -1, "gzip", strlen("gzip"));
-      info("normalized accept encoding to gzip");
-    } else if (deflate) {
-      TSMimeHdrFieldValueStringInsert(reqp, hdr_loc, field, -1, "deflate", strlen("deflate"));
-      info("normalized accept encoding to deflate");
-    }
+    TSMimeHdrFieldValueStringInsert(reqp, hdr_loc, field, -1, name, strlen(name));
+    info("normalized accept encoding to %s", name);
 
     TSMimeHdrFieldAppend(reqp, hdr_loc, field);
     TSHandleMLocRelease(reqp, hdr_loc, field);
@@ -163,3 +268,67 @@ gzip_log_ratio(int64_t in, int64_t out)
     debug("Compressed size %" PRId64 " (bytes), Original size %" PRId64 ", ratio: %f", out, in, 0.0F);
   }
 }
+
+// Busy-ness of the box, from the 1 minute load average per cpu:
+// 0 plenty of headroom, 1 getting busy, 2 saturated.
+// Sampled at most once a second; racing updates are harmless.
+static int
+cpu_pressure()
+{
+  static time_t last_sample = 0;
+  static int pressure = 0;
+  time_t now = time(NULL);
+
+  if (now != last_sample) {
+    double load;
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    last_sample = now;
+    if (getloadavg(&load, 1) == 1 && ncpus > 0) {
+      load /= ncpus;
+      pressure = load >= 0.9 ? 2 : load >= 0.6 ? 1 : 0;
+    }
+  }
+
+  return pressure;
+}
+
+// Large objects are streamed and compressed while the client waits,
+// so cap the effort for those even when they end up in cache.
+static const int64_t AUTO_LEVEL_MAX_CACHED_SIZE = 4 * 1024 * 1024;
+
+int
+pick_compression_level(int compression_type, int configured_level, int64_t content_length, bool cached)
+{
+  bool brotli = (compression_type == COMPRESSION_TYPE_BROTLI);
+  int level;
+
+  if (configured_level != COMPRESSION_LEVEL_AUTO) {
+    if (brotli) {
+      return configured_level < 0 ? 0 : configured_level > 11 ? 11 : configured_level;
+    }
+    return configured_level < 1 ? 1 : configured_level > 9 ? 9 : configured_level;
+  }
+
+  // the defaults: zlib 6 (see mod_deflate) and brotli 5 are a good
+  // trade-off when every request pays for the compression.
+  level = brotli ? 5 : 6;
+
+  // a response that is stored as a compressed alternate is compressed
+  // once and served many times, so spend more on it.
+  if (cached && content_length >= 0 && content_length <= AUTO_LEVEL_MAX_CACHED_SIZE) {
+    level = 9;
+  }
+
+  switch (cpu_pressure()) {
+  case 1:
+    level = level > 3 ? 3 : level;
+    break;
+  case 2:
+    level = 1;
+    break;
+  }
+
+  debug("compression level %d (type %d, length %" PRId64 ", cached %d)", level, compression_type, content_length, cached);
+  return level;
+}
@@ -26,6 +26,10 @@
 
 #include <zlib.h>
 #include <ts/ts.h>
+#include "ink_config.h"
+#if HAVE_BROTLI_ENCODE_H
+#include <brotli/encode.h>
+#endif
 #include <stdlib.h> //exit()
 #include <stdio.h>
 
@@ -34,9 +38,16 @@ static const int ZLIB_MEMLEVEL = 9; // min=1 (optimize for memory),max=9 (optimi
 static const int WINDOW_BITS_DEFLATE = -15;
 static const int WINDOW_BITS_GZIP = 31;
 
+// brotli stuff, quality 0..11, window 10..24
+static const int BROTLI_LGWIN = 22;
+
 // misc
+// the compression types double as bits in the supported-algorithms mask
 static const int COMPRESSION_TYPE_DEFLATE = 1;
 static const int COMPRESSION_TYPE_GZIP = 2;
+static const int COMPRESSION_TYPE_BROTLI = 4;
+// compression-level auto
+static const int COMPRESSION_LEVEL_AUTO = -1;
 // this one is just for txnargset/get to point to
 static const int GZIP_ONE = 1;
 static const int DICT_PATH_MAX = 512;
@@ -60,19 +71,26 @@ typedef struct {
   TSIOBufferReader downstream_reader;
   int downstream_length;
   z_stream zstrm;
+#if HAVE_BROTLI_ENCODE_H
+  BrotliEncoderState *bstrm;
+  int64_t total_in;
+#endif
   enum transform_state state;
   int compression_type;
+  int compression_level;
 } GzipData;
 
 
 voidpf gzip_alloc(voidpf opaque, uInt items, uInt size);
 void gzip_free(voidpf opaque, voidpf address);
-void normalize_accept_encoding(TSHttpTxn txnp, TSMBuffer reqp, TSMLoc hdr_loc);
+void normalize_accept_encoding(TSHttpTxn txnp, TSMBuffer reqp, TSMLoc hdr_loc, int algorithms);
+int accept_encoding_type(TSMBuffer reqp, TSMLoc hdr_loc, int algorithms);
 void hide_accept_encoding(TSHttpTxn txnp, TSMBuffer reqp, TSMLoc hdr_loc, const char *hidden_header_name);
 void restore_accept_encoding(TSHttpTxn txnp, TSMBuffer reqp, TSMLoc hdr_loc, const char *hidden_header_name);
 const char *init_hidden_header_name();
 int check_ts_version();
 int register_plugin();
 void gzip_log_ratio(int64_t in, int64_t out);
+int pick_compression_level(int compression_type, int configured_level, int64_t content_length, bool cached);
 
 #endif
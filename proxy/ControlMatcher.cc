@@ -477,12 +477,27 @@ RegexMatcher<Data, Result>::NewEntry(matcher_line *line_info)
     pcre_free(re_array[num_el]);
     re_array[num_el] = NULL;
   } else {
+    ink_assert(prefilter.count() == num_el);
+    prefilter.add(pattern);
     num_el++;
   }
 
   return error;
 }
 
+//
+// void RegexMatcher<Data,Result>::BuildPrefilter()
+//
+//   Compiles the literal prefilter once all entries are in so
+//     Match() only runs the regexs that could match
+//
+template <class Data, class Result>
+void
+RegexMatcher<Data, Result>::BuildPrefilter()
+{
+  prefilter.compile();
+}
+
 //
 // void RegexMatcher<Data,Result>::Match(RequestData* rdata, Result* result)
 //
@@ -514,8 +529,15 @@ RegexMatcher<Data, Result>::Match(RequestData *rdata, Result *result)
   // HttpRequestData::get_string(); therefore, no need to call again here.
   // unescapifyStr(url_str);
 
+  int url_len = strlen(url_str);
+  bool *candidates = (bool *)alloca(num_el * sizeof(bool));
+  prefilter.scan(url_str, url_len, candidates);
+
   for (int i = 0; i < num_el; i++) {
-    r = pcre_exec(re_array[i], NULL, url_str, strlen(url_str), 0, 0, NULL, 0);
+    if (!candidates[i]) {
+      continue;
+    }
+    r = pcre_exec(re_array[i], NULL, url_str, url_len, 0, 0, NULL, 0);
     if (r > -1) {
       Debug("matcher", "%s Matched %s with regex at line %d", matcher_name, url_str, data_array[i].line_num);
       data_array[i].UpdateMatch(result, rdata);
@@ -562,16 +584,24 @@ HostRegexMatcher<Data, Result>::Match(RequestData *rdata, Result *result)
   if (url_str == NULL) {
     url_str = "";
   }
+
+  int url_len = strlen(url_str);
+  bool *candidates = (bool *)alloca(this->num_el * sizeof(bool));
+  this->prefilter.scan(url_str, url_len, candidates);
+
   for (int i = 0; i < this->num_el; i++) {
-    r = pcre_exec(this->re_array[i], NULL, url_str, strlen(url_str), 0, 0, NULL, 0);
-    if (r != -1) {
+    if (!candidates[i]) {
+      continue;
+    }
+    r = pcre_exec(this->re_array[i], NULL, url_str, url_len, 0, 0, NULL, 0);
+    if (r > -1) {
       Debug("matcher", "%s Matched %s with regex at line %d", const_cast<char *>(this->matcher_name), url_str,
             this->data_array[i].line_num);
       this->data_array[i].UpdateMatch(result, rdata);
-    } else {
+    } else if (r < -1) {
       // An error has occured
-      Warning("error matching regex at line %d", this->data_array[i].line_num);
-    }
+      Warning("Error [%d] matching regex at line %d.", r, this->data_array[i].line_num);
+    } // else it's -1 which means no match was found.
   }
 }
 
@@ -945,6 +975,13 @@ ControlMatcher<Data, Result>::BuildTableFromString(char *file_buf)
 
   ink_assert(second_pass == numEntries);
 
+  if (reMatch != NULL && !(flags & DONT_PREFILTER)) {
+    reMatch->BuildPrefilter();
+  }
+  if (hrMatch != NULL && !(flags & DONT_PREFILTER)) {
+    hrMatch->BuildPrefilter();
+  }
+
   if (is_debug_tag_set("matcher")) {
     Print();
   }
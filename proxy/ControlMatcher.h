@@ -204,6 +204,7 @@ public:
   void Match(RequestData *rdata, Result *result);
   void AllocateSpace(int num_entries);
   config_parse_error NewEntry(matcher_line *line_info);
+  void BuildPrefilter();
   void Print();
 
   int
@@ -220,6 +221,7 @@ public:
 protected:
   pcre **re_array;          // array of compiled regexs
   char **re_str;            // array of uncompiled regex strings
+  RegexPrefilter prefilter; // literal prefilter, indexed like re_array
   Data *data_array;         // data array.  Corresponds to re_array
   int array_len;            // length of the arrays (all three are the same length)
   int num_el;               // number of elements in the table
@@ -307,6 +309,7 @@ public:
 #define ALLOW_HOST_REGEX_TABLE 1 << 3
 #define ALLOW_URL_TABLE 1 << 4
 #define DONT_BUILD_TABLE 1 << 5 // for testing
+#define DONT_PREFILTER 1 << 6   // for testing, regex tables run every line
 
 template <class Data, class Result> class ControlMatcher
 {
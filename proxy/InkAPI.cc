@@ -4109,13 +4109,13 @@ TSCacheHttpInfoVector(TSCacheHttpInfo infop, void *data, int length)
 
   vector.insert(info);
 
-  int size = vector.marshal_length();
+  int size = vector.marshal_length(false);
 
   if (size > length)
     // error
     return 0;
 
-  return vector.marshal((char *)data, length);
+  return vector.marshal((char *)data, length, false);
 }
 
 
@@ -1710,6 +1710,112 @@ EXCLUSIVE_REGRESSION_TEST(PARENTSELECTION)(RegressionTest * /* t ATS_UNUSED */,
   *pstatus = (!fails ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED);
 }
 
+// Lookups per second against a parent.config shaped table of url_regex and dest_domain lines, with the
+//  regex prefilter and without it, where every regex line goes through PCRE as before the prefilter.
+//  Both tables must pick the same line for every request.
+EXCLUSIVE_REGRESSION_TEST(ControlMatcher_RegexLookups)(RegressionTest *t, int /* intensity_level ATS_UNUSED */, int *pstatus)
+{
+  static const int NLINES = 200;
+  static const int NREQUESTS = 64;
+  static const int LOOKUPS = 10000;
+  int size = NLINES * 128;
+  char *config = (char *)ats_malloc(size);
+  char line[256], host[64], url[256];
+  bool failed = false;
+
+  config[0] = '\0';
+  for (int i = 0; i < NLINES; i++) {
+    switch (i % 4) {
+    case 0:
+      snprintf(line, sizeof(line), "url_regex=^http://img%d.example.com/ parent=img%d:80\n", i, i);
+      break;
+    case 1:
+      snprintf(line, sizeof(line), "url_regex=/api/v%d/users/[0-9]+ parent=api%d:8080\n", i, i);
+      break;
+    case 2:
+      snprintf(line, sizeof(line), "url_regex=static%d.cdn.net/.*[.](jpg|png|gif)$ parent=static%d:80\n", i, i);
+      break;
+    default:
+      snprintf(line, sizeof(line), "dest_domain=site%d.org parent=site%d:80\n", i, i);
+      break;
+    }
+    ink_strlcat(config, line, size);
+  }
+
+  // tables[0] is prefiltered, tables[1] is not
+  P_table *tables[2];
+  char *bufs[2];
+  for (int i = 0; i < 2; i++) {
+    bufs[i] = ats_strdup(config);
+    tables[i] = new P_table("", "ControlMatcher Lookup Table", &http_dest_tags,
+                           ALLOW_HOST_TABLE | ALLOW_REGEX_TABLE | DONT_BUILD_TABLE | (i ? DONT_PREFILTER : 0));
+    tables[i]->BuildTableFromString(bufs[i]);
+  }
+
+  // Every request matches one line, spread over the whole table.
+  HttpRequestData requests[NREQUESTS];
+  for (int i = 0; i < NREQUESTS; i++) {
+    int n = (i * 37) % NLINES;
+    n -= n % 4;
+    switch (i % 4) {
+    case 0:
+      snprintf(host, sizeof(host), "img%d.example.com", n);
+      snprintf(url, sizeof(url), "http://%s/logo.png", host);
+      break;
+    case 1:
+      snprintf(host, sizeof(host), "www.example.com");
+      snprintf(url, sizeof(url), "http://%s/api/v%d/users/42?fields=name", host, n + 1);
+      break;
+    case 2:
+      snprintf(host, sizeof(host), "static%d.cdn.net", n + 2);
+      snprintf(url, sizeof(url), "http://%s/assets/2015/banner.jpg", host);
+      break;
+    default:
+      snprintf(host, sizeof(host), "www.site%d.org", n + 3);
+      snprintf(url, sizeof(url), "http://%s/index.html", host);
+      break;
+    }
+    br(&requests[i], host);
+    requests[i].hdr->url_set(url, strlen(url));
+
+    ParentResult with, without;
+    with.line_number = without.line_number = -1; // as findParent() starts a lookup
+    tables[0]->Match(&requests[i], &with);
+    tables[1]->Match(&requests[i], &without);
+    if (with.rec == NULL || with.line_number != n + i % 4 + 1 || with.line_number != without.line_number) {
+      rprintf(t, "%s matched line %d with the prefilter and %d without, expected %d\n", url, with.line_number,
+              without.line_number, n + i % 4 + 1);
+      failed = true;
+    }
+  }
+
+  ink_hrtime elapsed[2];
+  for (int i = 0; i < 2; i++) {
+    ink_hrtime start = ink_get_hrtime_internal();
+    for (int n = 0; n < LOOKUPS; n++) {
+      ParentResult result;
+      result.line_number = -1;
+      tables[i]->Match(&requests[n % NREQUESTS], &result);
+    }
+    elapsed[i] = ink_get_hrtime_internal() - start;
+  }
+  rprintf(t, "%d line table: %.0f lookups/sec with the regex prefilter, %.0f without\n", NLINES,
+          LOOKUPS / ((double)elapsed[0] / HRTIME_SECOND), LOOKUPS / ((double)elapsed[1] / HRTIME_SECOND));
+
+  for (int i = 0; i < NREQUESTS; i++) {
+    requests[i].hdr->destroy();
+    delete requests[i].hdr;
+    delete requests[i].api_info;
+    ats_free(requests[i].hostname_str);
+  }
+  for (int i = 0; i < 2; i++) {
+    delete tables[i];
+    ats_free(bufs[i]);
+  }
+  ats_free(config);
+  *pstatus = failed ? REGRESSION_TEST_FAILED : REGRESSION_TEST_PASSED;
+}
+
 // verify returns 1 iff the test passes
 int
 verify(ParentResult *r, ParentResultType e, const char *h, int p)
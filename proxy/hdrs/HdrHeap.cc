@@ -40,11 +40,28 @@
 #define MAX_LOST_STR_SPACE 1024
 
 Allocator hdrHeapAllocator("hdrHeap", HDR_HEAP_DEFAULT_SIZE);
+Allocator hdrHeapLargeAllocator("hdrHeapLarge", HDR_HEAP_LARGE_SIZE);
 static HdrHeap proto_heap;
 
 Allocator strHeapAllocator("hdrStrHeap", HDR_STR_HEAP_DEFAULT_SIZE);
+Allocator strHeapLargeAllocator("hdrStrHeapLarge", HDR_STR_HEAP_LARGE_SIZE);
 static HdrStrHeap str_proto_heap;
 
+// Rolling estimates of the object and string bytes a heap ends up
+//  holding, taken when heaps are destroyed. New heaps start out at
+//  the estimate so a transaction with large headers doesn't have to
+//  chain object heaps and coalesce string heaps on its way there.
+//  Each thread keeps its own estimates, so the updates in destroy()
+//  don't race between net threads.
+static __thread int hdr_heap_obj_estimate = 0;
+static __thread int hdr_heap_str_estimate = 0;
+
+static inline void
+hdr_heap_estimate_update(int *estimate, int sample)
+{
+  *estimate += (sample - *estimate) / 8;
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -116,9 +133,15 @@ HdrHeap *
 new_HdrHeap(int size)
 {
   HdrHeap *h;
+  if (size == HDR_HEAP_DEFAULT_SIZE && hdr_heap_obj_estimate + (int)HDR_HEAP_HDR_SIZE > HDR_HEAP_DEFAULT_SIZE)
+    size = HDR_HEAP_LARGE_SIZE;
+
   if (size <= HDR_HEAP_DEFAULT_SIZE) {
     size = HDR_HEAP_DEFAULT_SIZE;
     h = (HdrHeap *)(THREAD_ALLOC(hdrHeapAllocator, this_ethread()));
+  } else if (size <= HDR_HEAP_LARGE_SIZE) {
+    size = HDR_HEAP_LARGE_SIZE;
+    h = (HdrHeap *)(THREAD_ALLOC(hdrHeapLargeAllocator, this_ethread()));
   } else {
     h = (HdrHeap *)ats_malloc(size);
   }
@@ -149,6 +172,9 @@ new_HdrStrHeap(int requested_size)
   if (alloc_size <= HDR_STR_HEAP_DEFAULT_SIZE) {
     alloc_size = HDR_STR_HEAP_DEFAULT_SIZE;
     sh = (HdrStrHeap *)(THREAD_ALLOC(strHeapAllocator, this_ethread()));
+  } else if (alloc_size <= HDR_STR_HEAP_LARGE_SIZE) {
+    alloc_size = HDR_STR_HEAP_LARGE_SIZE;
+    sh = (HdrStrHeap *)(THREAD_ALLOC(strHeapLargeAllocator, this_ethread()));
   } else {
     alloc_size = ROUND(alloc_size, HDR_STR_HEAP_DEFAULT_SIZE * 2);
     sh = (HdrStrHeap *)ats_malloc(alloc_size);
@@ -171,9 +197,30 @@ new_HdrStrHeap(int requested_size)
 
 void
 HdrHeap::destroy()
+{
+  if (m_writeable) {
+    int obj_bytes = 0;
+    int str_bytes = 0;
+
+    for (HdrHeap *h = this; h; h = h->m_next)
+      obj_bytes += h->m_free_start - h->m_data_start;
+    if (m_read_write_heap)
+      str_bytes += m_read_write_heap->m_heap_size - m_read_write_heap->m_free_size - STR_HEAP_HDR_SIZE;
+    for (int i = 0; i < HDR_BUF_RONLY_HEAPS; i++)
+      str_bytes += m_ronly_heap[i].m_heap_len;
+
+    hdr_heap_estimate_update(&hdr_heap_obj_estimate, obj_bytes);
+    hdr_heap_estimate_update(&hdr_heap_str_estimate, str_bytes);
+  }
+
+  free_chain();
+}
+
+void
+HdrHeap::free_chain()
 {
   if (m_next) {
-    m_next->destroy();
+    m_next->free_chain();
   }
 
   m_read_write_heap = NULL;
@@ -182,6 +229,8 @@ HdrHeap::destroy()
 
   if (m_size == HDR_HEAP_DEFAULT_SIZE) {
     THREAD_FREE(this, hdrHeapAllocator, this_thread());
+  } else if (m_size == HDR_HEAP_LARGE_SIZE) {
+    THREAD_FREE(this, hdrHeapLargeAllocator, this_thread());
   } else {
     ats_free(this);
   }
@@ -264,6 +313,8 @@ RETRY:
   if (!m_read_write_heap) {
     int next_size = (last_size * 2) - STR_HEAP_HDR_SIZE;
     next_size = next_size > nbytes ? next_size : nbytes;
+    if (last_size == 0 && next_size < hdr_heap_str_estimate)
+      next_size = hdr_heap_str_estimate;
     m_read_write_heap = new_HdrStrHeap(next_size);
   }
   // Try to allocate of our read/write string heap
@@ -600,6 +651,146 @@ compute_checksum(void *buf, int len)
 #endif
 
 
+// static int marshal_heap_objects(HdrHeap* marshal_hdr, ...)
+//
+//   Walks the objects of a heap image that has been copied into
+//     a marshal buffer and converts their live pointers to offsets
+//     using the translation tables.  Returns -1 on failure
+//
+static int
+marshal_heap_objects(HdrHeap *marshal_hdr, MarshalXlate *ptr_xlation, int ptr_heaps, MarshalXlate *str_xlation, int str_heaps)
+{
+  char *obj_data = ((char *)marshal_hdr) + HDR_HEAP_HDR_SIZE;
+  char *mheap_end = ((char *)marshal_hdr) + marshal_hdr->m_size;
+
+  while (obj_data < mheap_end) {
+    HdrHeapObjImpl *obj = (HdrHeapObjImpl *)obj_data;
+    ink_assert(obj_is_aligned(obj));
+
+    switch (obj->m_type) {
+    case HDR_HEAP_OBJ_URL:
+      if (((URLImpl *)obj)->marshal(str_xlation, str_heaps) < 0) {
+        return -1;
+      }
+      break;
+    case HDR_HEAP_OBJ_HTTP_HEADER:
+      if (((HTTPHdrImpl *)obj)->marshal(ptr_xlation, ptr_heaps, str_xlation, str_heaps) < 0) {
+        return -1;
+      }
+      break;
+    case HDR_HEAP_OBJ_FIELD_BLOCK:
+      if (((MIMEFieldBlockImpl *)obj)->marshal(ptr_xlation, ptr_heaps, str_xlation, str_heaps) < 0) {
+        return -1;
+      }
+      break;
+    case HDR_HEAP_OBJ_MIME_HEADER:
+      if (((MIMEHdrImpl *)obj)->marshal(ptr_xlation, ptr_heaps, str_xlation, str_heaps)) {
+        return -1;
+      }
+      break;
+    case HDR_HEAP_OBJ_EMPTY:
+    case HDR_HEAP_OBJ_RAW:
+      // Check to make sure we aren't stuck
+      //   in an infinite loop
+      if (obj->m_length <= 0) {
+        ink_assert(0);
+        return -1;
+      }
+      // Nothing to do
+      break;
+    default:
+      ink_release_assert(0);
+    }
+
+    obj_data = obj_data + obj->m_length;
+  }
+
+  return 0;
+}
+
+// bool HdrHeap::is_marshal_image()
+//
+//   True if this heap was unmarshalled in place and has not been
+//     changed since: one object block immediately followed by one
+//     read-only string heap, which is the layout marshal() produces
+//
+bool
+HdrHeap::is_marshal_image() const
+{
+  if (m_writeable || m_next || m_read_write_heap) {
+    return false;
+  }
+
+  const char *base = (const char *)this;
+
+  if (m_data_start != base + HDR_HEAP_HDR_SIZE || m_free_start != base + m_size || m_ronly_heap[0].m_heap_start != base + m_size) {
+    return false;
+  }
+
+  for (int i = 1; i < HDR_BUF_RONLY_HEAPS; i++) {
+    if (m_ronly_heap[i].m_heap_start != NULL) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// int HdrHeap::marshal_image(char* buf, int len)
+//
+//   marshal() for a heap that is_marshal_image().  The object
+//     block and the string heap are already contiguous, so the
+//     whole image goes out with one copy and both translation
+//     tables collapse to a single entry rebasing off of this
+//
+int
+HdrHeap::marshal_image(char *buf, int len)
+{
+  ink_assert(is_marshal_image());
+
+  HdrHeap *marshal_hdr = (HdrHeap *)buf;
+  int str_size = m_ronly_heap[0].m_heap_len;
+  int used = m_size + str_size;
+
+  if (used > len) {
+    return -1;
+  }
+
+  memcpy(buf, this, used);
+
+  marshal_hdr->m_free_start = NULL;
+  marshal_hdr->m_data_start = (char *)HDR_HEAP_HDR_SIZE; // offset
+  marshal_hdr->m_magic = HDR_BUF_MAGIC_MARSHALED;
+  marshal_hdr->m_ronly_heap[0].m_heap_start = (char *)(intptr_t)m_size; // offset
+  marshal_hdr->m_ronly_heap[0].m_ref_count_ptr.m_ptr = NULL;
+
+  MarshalXlate ptr_xlation;
+  ptr_xlation.start = m_data_start;
+  ptr_xlation.end = m_free_start;
+  ptr_xlation.offset = (char *)this;
+
+  MarshalXlate str_xlation;
+  str_xlation.start = m_ronly_heap[0].m_heap_start;
+  str_xlation.end = m_ronly_heap[0].m_heap_start + str_size;
+  str_xlation.offset = (char *)this;
+
+  if (marshal_heap_objects(marshal_hdr, &ptr_xlation, 1, &str_xlation, 1) < 0) {
+    marshal_hdr->m_magic = HDR_BUF_MAGIC_CORRUPT;
+    return -1;
+  }
+
+  used = ROUND(used, HDR_PTR_SIZE);
+
+#ifdef HDR_HEAP_CHECKSUMS
+  {
+    uint32_t chksum = compute_checksum(buf, used);
+    marshal_hdr->m_free_start = (char *)chksum;
+  }
+#endif
+
+  return used;
+}
+
 // int HdrHeap::marshal(char* buf, int len)
 //
 //   Creates a marshalled representation of the contents
@@ -615,6 +806,12 @@ HdrHeap::marshal(char *buf, int len)
 {
   ink_assert((((uintptr_t)buf) & HDR_PTR_ALIGNMENT_MASK) == 0);
 
+  // Headers that came out of the cache and were not modified
+  //   are written back as they were read
+  if (is_marshal_image()) {
+    return marshal_image(buf, len);
+  }
+
   HdrHeap *marshal_hdr = (HdrHeap *)buf;
   char *b = buf + HDR_HEAP_HDR_SIZE;
 
@@ -746,51 +943,8 @@ HdrHeap::marshal(char *buf, int len)
   // Take our translation tables and loop over the objects
   //    and call the object marshal function to patch live
   //    strings pointers & live object pointers to offsets
-  {
-    char *obj_data = ((char *)marshal_hdr) + HDR_HEAP_HDR_SIZE;
-    char *mheap_end = ((char *)marshal_hdr) + marshal_hdr->m_size;
-
-    while (obj_data < mheap_end) {
-      HdrHeapObjImpl *obj = (HdrHeapObjImpl *)obj_data;
-      ink_assert(obj_is_aligned(obj));
-
-      switch (obj->m_type) {
-      case HDR_HEAP_OBJ_URL:
-        if (((URLImpl *)obj)->marshal(str_xlation, str_heaps) < 0) {
-          goto Failed;
-        }
-        break;
-      case HDR_HEAP_OBJ_HTTP_HEADER:
-        if (((HTTPHdrImpl *)obj)->marshal(ptr_xlation, ptr_heaps, str_xlation, str_heaps) < 0) {
-          goto Failed;
-        }
-        break;
-      case HDR_HEAP_OBJ_FIELD_BLOCK:
-        if (((MIMEFieldBlockImpl *)obj)->marshal(ptr_xlation, ptr_heaps, str_xlation, str_heaps) < 0) {
-          goto Failed;
-        }
-        break;
-      case HDR_HEAP_OBJ_MIME_HEADER:
-        if (((MIMEHdrImpl *)obj)->marshal(ptr_xlation, ptr_heaps, str_xlation, str_heaps)) {
-          goto Failed;
-        }
-        break;
-      case HDR_HEAP_OBJ_EMPTY:
-      case HDR_HEAP_OBJ_RAW:
-        // Check to make sure we aren't stuck
-        //   in an infinite loop
-        if (obj->m_length <= 0) {
-          ink_assert(0);
-          goto Failed;
-        }
-        // Nothing to do
-        break;
-      default:
-        ink_release_assert(0);
-      }
-
-      obj_data = obj_data + obj->m_length;
-    }
+  if (marshal_heap_objects(marshal_hdr, ptr_xlation, ptr_heaps, str_xlation, str_heaps) < 0) {
+    goto Failed;
   }
 
   // Add up the total bytes used
@@ -1130,6 +1284,8 @@ HdrStrHeap::free()
 {
   if (m_heap_size == HDR_STR_HEAP_DEFAULT_SIZE) {
     THREAD_FREE(this, strHeapAllocator, this_thread());
+  } else if (m_heap_size == HDR_STR_HEAP_LARGE_SIZE) {
+    THREAD_FREE(this, strHeapLargeAllocator, this_thread());
   } else {
     ats_free(this);
   }
@@ -55,6 +55,9 @@
 
 #define HDR_HEAP_DEFAULT_SIZE 2048
 #define HDR_STR_HEAP_DEFAULT_SIZE 2048
+// Heaps larger than the default up to this size also come from a thread freelist.
+#define HDR_HEAP_LARGE_SIZE (HDR_HEAP_DEFAULT_SIZE * 4)
+#define HDR_STR_HEAP_LARGE_SIZE (HDR_STR_HEAP_DEFAULT_SIZE * 4)
 
 #define HDR_MAX_ALLOC_SIZE (HDR_HEAP_DEFAULT_SIZE - sizeof(HdrHeap))
 #define HDR_HEAP_HDR_SIZE ROUND(sizeof(HdrHeap), HDR_PTR_SIZE)
@@ -195,6 +198,8 @@ public:
   // Marshalling
   inkcoreapi int marshal_length();
   inkcoreapi int marshal(char *buf, int length);
+  bool is_marshal_image() const;
+  int marshal_image(char *buf, int length);
   int unmarshal(int buf_length, int obj_type, HdrHeapObjImpl **found_obj, RefCountObj *block_ref);
   /// Computes the valid data size of an unmarshalled instance.
   /// Callers should round up to HDR_PTR_SIZE to get the actual footprint.
@@ -262,6 +267,7 @@ public:
   // HdrBuf heap pointers
   uint32_t m_free_size;
 
+  void free_chain();
   int demote_rw_str_heap();
   void coalesce_str_heaps(int incoming_size = 0);
   void evacuate_from_str_heaps(HdrStrHeap *new_heap);
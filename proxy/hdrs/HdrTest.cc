@@ -60,6 +60,7 @@ HdrTest::go(RegressionTest *t, int /* atype ATS_UNUSED */)
 
   status = status & test_error_page_selection();
   status = status & test_http_hdr_print_and_copy();
+  status = status & test_http_hdr_remarshal();
   status = status & test_comma_vals();
   status = status & test_parse_comma_list();
   status = status & test_set_comma_vals();
@@ -74,6 +75,8 @@ HdrTest::go(RegressionTest *t, int /* atype ATS_UNUSED */)
   status = status & test_arena();
   status = status & test_regex();
   status = status & test_http_parser_eos_boundary_cases();
+  status = status & test_mime_scanner();
+  status = status & test_hdrtoken();
   status = status & test_http_mutation();
   status = status & test_mime();
   status = status & test_http();
@@ -665,6 +668,264 @@ HdrTest::test_http_parser_eos_boundary_cases()
   return (failures_to_status("test_http_parser_eos_boundary_cases", failures));
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// Parse @a msg in two pieces split at @a split and print the result to @a out.
+static int
+test_mime_scanner_parse(const char *msg, int len, int split, char *out, int out_size, int *consumed)
+{
+  HTTPHdr hdr;
+  HTTPParser parser;
+  const char *start = msg;
+  int err, bufindex = 0, dumpoffset = 0;
+
+  hdr.create(HTTP_TYPE_REQUEST);
+  http_parser_init(&parser);
+
+  err = hdr.parse_req(&parser, &start, msg + split, false);
+  if (err == PARSE_CONT)
+    err = hdr.parse_req(&parser, &start, msg + len, true);
+  *consumed = (int)(start - msg);
+
+  memset(out, 0, out_size);
+  if (err == PARSE_DONE)
+    hdr.print(out, out_size - 1, &bufindex, &dumpoffset);
+
+  http_parser_clear(&parser);
+  hdr.destroy();
+  return err;
+}
+
+int
+HdrTest::test_mime_scanner()
+{
+  static const char *corpus[] = {
+    "GET http://www.example.com/index.html HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/45.0.2454.85 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, sdch\r\n"
+    "Accept-Language: en-US,en;q=0.8\r\n"
+    "Cookie: a=0123456789abcdef0123456789abcdef; b=fedcba9876543210fedcba9876543210\r\n"
+    "\r\n",
+    "GET / HTTP/1.0\nHost: a\nX-Folded: one\n two\n\tthree\n\n",
+    "GET / HTTP/1.0\r\nHost: a\r\nX-Lone-CR: a\rb\r\n\r\n",
+    "GET / HTTP/1.0\r\nHost: a\r\nX-Unterminated: 0123456789012345678901234567890123456789",
+    "GET / HTTP/1.0\r\nX-Nul: 0123456789012345678901234567\00089\r\n\r\n",
+    "GET /0123456789012345678901234567890123456789012345678901234567890123456789 HTTP/1.1\r\n\r\n",
+    NULL};
+
+  int failures = 0;
+  char buf[256];
+  char scalar_out[2048], vector_out[2048];
+  MIMEScanFunc selected = mime_scan_lf_or_nul;
+
+  bri_box("test_mime_scanner");
+
+  // The selected scanner must agree with the scalar one for every alignment and length.
+  for (unsigned i = 0; i < sizeof(buf); ++i) {
+    unsigned r = (i * 2654435761U) >> 24;
+    buf[i] = r < 6 ? '\n' : r < 9 ? '\0' : r < 20 ? '\r' : 'a' + (r % 26);
+  }
+  for (int s = 0; s < 64; ++s) {
+    for (int e = s; e <= (int)sizeof(buf); ++e) {
+      if (selected(buf + s, buf + e) != mime_scan_lf_or_nul_scalar(buf + s, buf + e)) {
+        printf("FAILED: scan mismatch for [%d, %d)\n", s, e);
+        ++failures;
+      }
+    }
+  }
+
+  // Both scanners must parse the corpus identically for every split of the input.
+  for (int i = 0; corpus[i]; ++i) {
+    // Include the NUL in the one test that embeds it.
+    int len = strlen(corpus[i]);
+    if (strstr(corpus[i], "X-Nul"))
+      len += strlen(corpus[i] + len + 1) + 1;
+
+    for (int split = 0; split <= len; ++split) {
+      int scalar_err, vector_err, scalar_consumed, vector_consumed;
+
+      mime_scan_lf_or_nul = mime_scan_lf_or_nul_scalar;
+      scalar_err = test_mime_scanner_parse(corpus[i], len, split, scalar_out, sizeof(scalar_out), &scalar_consumed);
+      mime_scan_lf_or_nul = selected;
+      vector_err = test_mime_scanner_parse(corpus[i], len, split, vector_out, sizeof(vector_out), &vector_consumed);
+
+      if (scalar_err != vector_err || scalar_consumed != vector_consumed || strcmp(scalar_out, vector_out)) {
+        printf("FAILED: test %d split %d: result <%d, %d>, consumed <%d, %d>\n", i, split, scalar_err, vector_err,
+               scalar_consumed, vector_consumed);
+        ++failures;
+      }
+    }
+  }
+
+  // Report the parse rate of both scanners on the first request of the corpus.
+  int len = strlen(corpus[0]);
+  for (int pass = 0; pass < 2; ++pass) {
+    const int iterations = 20000;
+    int consumed;
+
+    mime_scan_lf_or_nul = pass ? selected : mime_scan_lf_or_nul_scalar;
+    ink_hrtime start = ink_get_hrtime_internal();
+    for (int n = 0; n < iterations; ++n)
+      test_mime_scanner_parse(corpus[0], len, len, scalar_out, sizeof(scalar_out), &consumed);
+    ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+    printf("%s scanner: %.0f requests/sec\n", pass ? "selected" : "scalar",
+           elapsed ? (double)iterations * HRTIME_SECOND / elapsed : 0.0);
+  }
+  mime_scan_lf_or_nul = selected;
+
+  return (failures_to_status("test_mime_scanner", failures));
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// The index of the well known string that @a str spells, ignoring case, by brute force.
+static int
+wks_index_of(const char *str, int len)
+{
+  for (int i = 0; i < hdrtoken_num_wks; ++i) {
+    if (hdrtoken_index_to_length(i) == len && strncasecmp(hdrtoken_index_to_wks(i), str, len) == 0)
+      return i;
+  }
+  return -1;
+}
+
+int
+HdrTest::test_hdrtoken()
+{
+  // Field names weighted roughly by how often they show up in requests and responses.
+  static const struct {
+    const char *name;
+    int weight;
+  } names[] = {{"Host", 10},
+               {"User-Agent", 10},
+               {"Accept", 9},
+               {"Accept-Encoding", 9},
+               {"Accept-Language", 8},
+               {"Connection", 8},
+               {"Cookie", 6},
+               {"Referer", 6},
+               {"Content-Type", 8},
+               {"Content-Length", 8},
+               {"Date", 7},
+               {"Server", 7},
+               {"Cache-Control", 7},
+               {"Last-Modified", 5},
+               {"Etag", 5},
+               {"Expires", 4},
+               {"Set-Cookie", 4},
+               {"Vary", 3},
+               {"Via", 2},
+               {"If-Modified-Since", 3},
+               {"X-Forwarded-For", 3},
+               {"Transfer-Encoding", 2},
+               {"X-Requested-With", 2},
+               {"Upgrade-Insecure-Requests", 2},
+               {"X-Cache", 2},
+               {"Dnt", 1},
+               {"Origin", 1},
+               {NULL, 0}};
+
+  int failures = 0;
+  const char *dist[256];
+  int ndist = 0;
+
+  bri_box("test_hdrtoken");
+
+  // Every well known string the DFA tokenizes must tokenize to the same index in any case.
+  for (int i = 0; i < hdrtoken_num_wks; ++i) {
+    const char *wks = hdrtoken_index_to_wks(i);
+    int len = hdrtoken_index_to_length(i);
+    char upper[128], lower[128];
+
+    if (len >= (int)sizeof(upper))
+      continue;
+    int dfa_idx = hdrtoken_tokenize_dfa(wks, len);
+    if (dfa_idx < 0)
+      continue;
+    for (int j = 0; j < len; ++j) {
+      upper[j] = ParseRules::ink_toupper(wks[j]);
+      lower[j] = ParseRules::ink_tolower(wks[j]);
+    }
+    int upper_idx = hdrtoken_tokenize(upper, len);
+    int lower_idx = hdrtoken_tokenize(lower, len);
+    if (upper_idx < 0 || upper_idx != dfa_idx || lower_idx != dfa_idx) {
+      printf("FAILED: '%s' tokenized to %d / %d, expected %d\n", wks, upper_idx, lower_idx, dfa_idx);
+      ++failures;
+    }
+  }
+
+  // Near misses: the well known strings one byte short, one byte long, and with a wrong byte at
+  // the start, middle or end. Each must tokenize to whatever well known string it happens to
+  // spell, which is almost always none.
+  for (int i = 0; i < hdrtoken_num_wks; ++i) {
+    const char *wks = hdrtoken_index_to_wks(i);
+    int len = hdrtoken_index_to_length(i);
+    char buf[128];
+
+    if (len + 1 >= (int)sizeof(buf))
+      continue;
+
+    struct {
+      int len;
+      int pos;
+      char c;
+    } misses[] = {{len - 1, -1, 0},
+                  {len + 1, len, 'x'},
+                  {len, 0, (char)(wks[0] ^ 0x01)},
+                  {len, len / 2, (char)(wks[len / 2] ^ 0x01)},
+                  {len, len - 1, (char)(wks[len - 1] ^ 0x01)},
+                  {len, len - 1, '~'}};
+
+    for (unsigned m = 0; m < SIZEOF(misses); ++m) {
+      if (misses[m].len <= 0 || (misses[m].pos >= 0 && misses[m].c == wks[misses[m].pos]))
+        continue;
+      memcpy(buf, wks, len);
+      if (misses[m].pos >= 0)
+        buf[misses[m].pos] = misses[m].c;
+
+      int expected = wks_index_of(buf, misses[m].len);
+      int idx = hdrtoken_tokenize(buf, misses[m].len);
+      if (idx != expected) {
+        printf("FAILED: near miss '%.*s' of '%s' tokenized to %d, expected %d\n", misses[m].len, buf, wks, idx, expected);
+        ++failures;
+      }
+    }
+  }
+
+  static const char *const strangers[] = {"", "H", "Hos", "Hostx", "Hosu", "Content-Lengtx", "Content_Length", "Accept-Encodin",
+                                          "X-Forwarded-Fo", "Set-Cookie2x", "\xff\xfe\xfd\xfc", NULL};
+  for (int i = 0; strangers[i]; ++i) {
+    int len = strlen(strangers[i]);
+    int expected = wks_index_of(strangers[i], len);
+    int idx = hdrtoken_tokenize(strangers[i], len);
+    if (idx != expected) {
+      printf("FAILED: '%s' tokenized to %d, expected %d\n", strangers[i], idx, expected);
+      ++failures;
+    }
+  }
+
+  // Time lookups over the weighted distribution, a mix of hits and misses.
+  for (int i = 0; names[i].name; ++i)
+    for (int w = 0; w < names[i].weight && ndist < (int)SIZEOF(dist); ++w)
+      dist[ndist++] = names[i].name;
+
+  const int iterations = 1000000;
+  int found = 0;
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int n = 0; n < iterations; ++n) {
+    const char *name = dist[(n * 7919) % ndist];
+    found += hdrtoken_tokenize(name, strlen(name)) >= 0;
+  }
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+  printf("hdrtoken_tokenize: %.1f ns per lookup, %d%% hits\n", (double)elapsed / iterations, found * 100 / iterations);
+
+  return (failures_to_status("test_hdrtoken", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -963,6 +1224,79 @@ HdrTest::test_http_hdr_print_and_copy()
   return (failures_to_status("test_http_hdr_print_and_copy", failures));
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// An unmodified unmarshalled heap is written back as the image it was
+//   read from. That image must unmarshal to the same header again.
+int
+HdrTest::test_http_hdr_remarshal()
+{
+  static const char *requests[] = {"GET http://foo.com/bar.txt HTTP/1.0\r\n"
+                                   "Accept-Language: fjdfjdslkf dsjkfdj flkdsfjlk sjfdlk ajfdlksa\r\n"
+                                   "\r\n",
+                                   "GET http://www.example.com/a/b/c.html?q=1 HTTP/1.1\r\n"
+                                   "Host: www.example.com\r\n"
+                                   "Accept: text/html\r\n"
+                                   "Cookie: a=0123456789abcdef\r\n"
+                                   "X-Custom: one, two, three\r\n"
+                                   "\r\n",
+                                   NULL};
+
+  int failures = 0;
+
+  bri_box("test_http_hdr_remarshal");
+
+  for (int i = 0; requests[i]; i++) {
+    HTTPHdr hdr, marshal_hdr, remarshal_hdr;
+    HTTPParser parser;
+    RefCountObj ref;
+    const char *start = requests[i];
+    const char *end = start + strlen(start);
+    char prt_buf[2048], rem_buf[2048];
+    int prt_bufindex = 0, prt_dumpoffset = 0, rem_bufindex = 0, rem_dumpoffset = 0;
+    char *marshal_buf = (char *)ats_malloc(2048);
+    char *remarshal_buf = (char *)ats_malloc(2048);
+
+    ref.m_refcount = 100;
+    hdr.create(HTTP_TYPE_REQUEST);
+    http_parser_init(&parser);
+    hdr.parse_req(&parser, &start, end, true);
+    http_parser_clear(&parser);
+
+    int marshal_len = hdr.m_heap->marshal(marshal_buf, 2048);
+    marshal_hdr.create(HTTP_TYPE_REQUEST);
+    marshal_hdr.unmarshal(marshal_buf, marshal_len, &ref);
+
+    int remarshal_len = -1;
+    if (!marshal_hdr.m_heap->is_marshal_image()) {
+      printf("FAILED: (test #%d) unmarshalled req hdr is not a marshal image\n", i + 1);
+      ++failures;
+    } else if ((remarshal_len = marshal_hdr.m_heap->marshal(remarshal_buf, 2048)) != marshal_len) {
+      printf("FAILED: (test #%d) remarshal length %d, expected %d\n", i + 1, remarshal_len, marshal_len);
+      ++failures;
+    } else {
+      remarshal_hdr.create(HTTP_TYPE_REQUEST);
+      remarshal_hdr.unmarshal(remarshal_buf, remarshal_len, &ref);
+
+      hdr.print(prt_buf, sizeof(prt_buf), &prt_bufindex, &prt_dumpoffset);
+      remarshal_hdr.print(rem_buf, sizeof(rem_buf), &rem_bufindex, &rem_dumpoffset);
+      if (prt_bufindex != rem_bufindex || memcmp(prt_buf, rem_buf, prt_bufindex) != 0) {
+        printf("FAILED: (test #%d) remarshalled req hdr prints differently\n", i + 1);
+        printf("PRT_BUFF:\n[%.*s]\n", prt_bufindex, prt_buf);
+        printf("REM_BUFF:\n[%.*s]\n", rem_bufindex, rem_buf);
+        ++failures;
+      }
+    }
+
+    hdr.destroy();
+    ats_free(remarshal_buf);
+    ats_free(marshal_buf);
+  }
+
+  return (failures_to_status("test_http_hdr_remarshal", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 static const char *
@@ -50,10 +50,13 @@ public:
 private:
   int test_error_page_selection();
   int test_http_hdr_print_and_copy();
+  int test_http_hdr_remarshal();
   int test_parse_date();
   int test_format_date();
   int test_url();
   int test_http_parser_eos_boundary_cases();
+  int test_mime_scanner();
+  int test_hdrtoken();
   int test_arena();
   int test_regex();
   int test_accept_language_match();
@@ -253,8 +253,17 @@ DFA *hdrtoken_strs_dfa = NULL;
  *                                                                     *
  ***********************************************************************/
 
-#define HDRTOKEN_HASH_TABLE_SIZE 65536
-#define HDRTOKEN_HASH_TABLE_MASK HDRTOKEN_HASH_TABLE_SIZE - 1
+/**
+  The commonly tokenized strings are looked up through a perfect hash
+  built by hdrtoken_hash_init. The low bits of the string hash pick a
+  displacement, and the displacement together with the high bits picks
+  the slot. The displacements are searched so that no two strings share
+  a slot, so a lookup is one hash pass, two table reads and one compare.
+**/
+#define HDRTOKEN_HASH_TABLE_SIZE 256
+#define HDRTOKEN_HASH_TABLE_MASK (HDRTOKEN_HASH_TABLE_SIZE - 1)
+#define HDRTOKEN_HASH_DISP_SIZE 64
+#define HDRTOKEN_HASH_DISP_MASK (HDRTOKEN_HASH_DISP_SIZE - 1)
 
 struct HdrTokenHashBucket {
   const char *wks;
@@ -262,25 +271,41 @@ struct HdrTokenHashBucket {
 };
 
 HdrTokenHashBucket hdrtoken_hash_table[HDRTOKEN_HASH_TABLE_SIZE];
+uint16_t hdrtoken_hash_disp[HDRTOKEN_HASH_DISP_SIZE];
 
-/**
-  basic FNV hash
-**/
-#define TINY_MASK(x) (((uint32_t)1 << (x)) - 1)
+// Lower case ASCII letters without a branch, every other byte is unchanged.
+inline uint32_t
+hdrtoken_fold(uint32_t c)
+{
+  return c | (static_cast<uint32_t>(c - 'A' < 26u) << 5);
+}
 
 inline uint32_t
-hash_to_slot(uint32_t hash)
+hash_to_slot(uint32_t hash, uint32_t disp)
 {
-  return ((hash >> 15) ^ hash) & TINY_MASK(15);
+  return ((hash >> 8) + disp * ((hash >> 20) | 1)) & HDRTOKEN_HASH_TABLE_MASK;
 }
 
+/**
+  basic FNV hash, case insensitive
+**/
 inline uint32_t
 hdrtoken_hash(const unsigned char *string, unsigned int length)
 {
-  ATSHash32FNV1a fnv;
-  fnv.update(string, length, ATSHash::nocase());
-  fnv.final();
-  return fnv.get();
+  uint32_t hash = 0x811c9dc5;
+  for (unsigned int i = 0; i < length; ++i)
+    hash = (hash ^ hdrtoken_fold(string[i])) * 0x01000193;
+  return hash;
+}
+
+// Case insensitive compare of two strings of @a length bytes, without a branch per byte.
+inline bool
+hdrtoken_nocase_eq(const unsigned char *a, const unsigned char *b, unsigned int length)
+{
+  uint32_t diff = 0;
+  for (unsigned int i = 0; i < length; ++i)
+    diff |= hdrtoken_fold(a[i]) ^ hdrtoken_fold(b[i]);
+  return diff == 0;
 }
 
 /*-------------------------------------------------------------------------
@@ -354,33 +379,72 @@ static const char *_hdrtoken_commonly_tokenized_strs[] = {
 void
 hdrtoken_hash_init()
 {
-  uint32_t i;
-  int num_collisions;
+  const int n = SIZEOF(_hdrtoken_commonly_tokenized_strs);
+  const char *wks[SIZEOF(_hdrtoken_commonly_tokenized_strs)];
+  uint32_t hash[SIZEOF(_hdrtoken_commonly_tokenized_strs)];
+  int order[HDRTOKEN_HASH_DISP_SIZE], count[HDRTOKEN_HASH_DISP_SIZE];
+  int i, j;
 
+  ink_release_assert(n <= HDRTOKEN_HASH_TABLE_SIZE);
   memset(hdrtoken_hash_table, 0, sizeof(hdrtoken_hash_table));
-  num_collisions = 0;
+  memset(hdrtoken_hash_disp, 0, sizeof(hdrtoken_hash_disp));
+  memset(count, 0, sizeof(count));
 
-  for (i = 0; i < (int)SIZEOF(_hdrtoken_commonly_tokenized_strs); i++) {
+  for (i = 0; i < n; i++) {
     // convert the common string to the well-known token
-    unsigned const char *wks;
     int wks_idx = hdrtoken_tokenize_dfa(_hdrtoken_commonly_tokenized_strs[i], (int)strlen(_hdrtoken_commonly_tokenized_strs[i]),
-                                        (const char **)&wks);
+                                        &wks[i]);
     ink_release_assert(wks_idx >= 0);
 
-    uint32_t hash = hdrtoken_hash(wks, hdrtoken_str_lengths[wks_idx]);
-    uint32_t slot = hash_to_slot(hash);
+    hash[i] = hdrtoken_hash((const unsigned char *)wks[i], hdrtoken_str_lengths[wks_idx]);
+    for (j = 0; j < i; j++)
+      ink_release_assert(hash[j] != hash[i]); // the displacement can't separate these
+    ++count[hash[i] & HDRTOKEN_HASH_DISP_MASK];
+  }
+
+  // Place the largest groups first, while the table is still empty.
+  for (i = 0; i < HDRTOKEN_HASH_DISP_SIZE; i++)
+    order[i] = i;
+  for (i = 1; i < HDRTOKEN_HASH_DISP_SIZE; i++)
+    for (j = i; j > 0 && count[order[j]] > count[order[j - 1]]; j--) {
+      int t = order[j];
+      order[j] = order[j - 1];
+      order[j - 1] = t;
+    }
 
-    if (hdrtoken_hash_table[slot].wks) {
-      printf("ERROR: hdrtoken_hash_table[%u] collision: '%s' replacing '%s'\n", slot, (const char *)wks,
-             hdrtoken_hash_table[slot].wks);
-      ++num_collisions;
+  for (i = 0; i < HDRTOKEN_HASH_DISP_SIZE && count[order[i]]; i++) {
+    int group = order[i];
+    uint32_t disp;
+
+    for (disp = 0; disp <= UINT16_MAX; disp++) {
+      uint32_t slots[SIZEOF(_hdrtoken_commonly_tokenized_strs)];
+      int used = 0;
+
+      for (j = 0; j < n; j++) {
+        if ((hash[j] & HDRTOKEN_HASH_DISP_MASK) != (uint32_t)group)
+          continue;
+        uint32_t slot = hash_to_slot(hash[j], disp);
+        bool taken = hdrtoken_hash_table[slot].wks != NULL;
+        for (int k = 0; k < used && !taken; k++)
+          taken = slots[k] == slot;
+        if (taken)
+          break;
+        slots[used++] = slot;
+      }
+      if (j == n)
+        break;
+    }
+    ink_release_assert(disp <= UINT16_MAX);
+
+    hdrtoken_hash_disp[group] = disp;
+    for (j = 0; j < n; j++) {
+      if ((hash[j] & HDRTOKEN_HASH_DISP_MASK) == (uint32_t)group) {
+        uint32_t slot = hash_to_slot(hash[j], disp);
+        hdrtoken_hash_table[slot].wks = wks[j];
+        hdrtoken_hash_table[slot].hash = hash[j];
+      }
     }
-    hdrtoken_hash_table[slot].wks = (const char *)wks;
-    hdrtoken_hash_table[slot].hash = hash;
   }
-
-  if (num_collisions > 0)
-    abort();
 }
 
 
@@ -543,10 +607,11 @@ hdrtoken_tokenize(const char *string, int string_len, const char **wks_string_ou
   }
 
   uint32_t hash = hdrtoken_hash((const unsigned char *)string, (unsigned int)string_len);
-  uint32_t slot = hash_to_slot(hash);
+  uint32_t slot = hash_to_slot(hash, hdrtoken_hash_disp[hash & HDRTOKEN_HASH_DISP_MASK]);
 
   bucket = &(hdrtoken_hash_table[slot]);
-  if ((bucket->wks != NULL) && (bucket->hash == hash) && (hdrtoken_wks_to_length(bucket->wks) == string_len)) {
+  if ((bucket->wks != NULL) && (bucket->hash == hash) && (hdrtoken_wks_to_length(bucket->wks) == string_len) &&
+      hdrtoken_nocase_eq((const unsigned char *)bucket->wks, (const unsigned char *)string, string_len)) {
     wks_idx = hdrtoken_wks_to_index(bucket->wks);
     if (wks_string_out)
       *wks_string_out = bucket->wks;
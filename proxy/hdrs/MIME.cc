@@ -26,6 +26,10 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define MIME_SCAN_X86 1
+#endif
 #include "MIME.h"
 #include "HdrHeap.h"
 #include "HdrToken.h"
@@ -68,6 +72,8 @@ static MDY *_days_to_mdy_fast_lookup_table = NULL;
 static unsigned int _days_to_mdy_fast_lookup_table_first_day;
 static unsigned int _days_to_mdy_fast_lookup_table_last_day;
 
+static MIMEScanFunc mime_scan_select();
+
 
 /***********************************************************************
  *                                                                     *
@@ -635,6 +641,7 @@ mime_init()
     init = 0;
 
     hdrtoken_init();
+    mime_scan_lf_or_nul = mime_scan_select();
     day_names_dfa = new DFA;
     day_names_dfa->compile(day_names, SIZEOF(day_names), RE_CASE_INSENSITIVE);
 
@@ -2248,6 +2255,63 @@ MIMEHdr::get_host_port_values(char const **host_ptr, ///< Pointer to host.
  *                          P A R S E R                                *
  *                                                                     *
  ***********************************************************************/
+
+const char *
+mime_scan_lf_or_nul_scalar(const char *s, const char *e)
+{
+  while (s < e && *s != ParseRules::CHAR_LF && *s != '\0')
+    ++s;
+  return s;
+}
+
+#if MIME_SCAN_X86
+// SSE2 is part of the x86_64 baseline, so this needs no CPU check.
+static const char *
+mime_scan_lf_or_nul_sse2(const char *s, const char *e)
+{
+  const __m128i lf = _mm_set1_epi8(ParseRules::CHAR_LF);
+  const __m128i nul = _mm_setzero_si128();
+
+  for (; e - s >= 16; s += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+    unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, nul)));
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+  return mime_scan_lf_or_nul_scalar(s, e);
+}
+
+__attribute__((target("avx2"))) static const char *
+mime_scan_lf_or_nul_avx2(const char *s, const char *e)
+{
+  const __m256i lf = _mm256_set1_epi8(ParseRules::CHAR_LF);
+  const __m256i nul = _mm256_setzero_si256();
+
+  for (; e - s >= 32; s += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s));
+    unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, nul)));
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+  return mime_scan_lf_or_nul_sse2(s, e);
+}
+#endif
+
+static MIMEScanFunc
+mime_scan_select()
+{
+#if MIME_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return mime_scan_lf_or_nul_avx2;
+  return mime_scan_lf_or_nul_sse2;
+#else
+  return mime_scan_lf_or_nul_scalar;
+#endif
+}
+
+MIMEScanFunc mime_scan_lf_or_nul = mime_scan_lf_or_nul_scalar;
+
 void
 _mime_scanner_init(MIMEScanner *scanner)
 {
@@ -2314,6 +2378,7 @@ mime_scanner_get(MIMEScanner *S, const char **raw_input_s, const char *raw_input
 {
   const char *raw_input_c, *lf_ptr;
   MIMEParseResult zret = PARSE_CONT;
+  bool saw_nul = false;
   // Need this for handling dangling CR.
   static char const RAW_CR = ParseRules::CHAR_CR;
 
@@ -2359,8 +2424,12 @@ mime_scanner_get(MIMEScanner *S, const char **raw_input_s, const char *raw_input
       }
       break;
     case MIME_PARSE_INSIDE:
-      lf_ptr = static_cast<char const *>(memchr(raw_input_c, ParseRules::CHAR_LF, runway));
-      if (lf_ptr) {
+      lf_ptr = mime_scan_lf_or_nul(raw_input_c, raw_input_e);
+      if (lf_ptr < raw_input_e && '\0' == *lf_ptr) {
+        // Fails the parse below, keep going to consume the same input as before.
+        saw_nul = true;
+        raw_input_c = lf_ptr + 1;
+      } else if (lf_ptr < raw_input_e) {
         raw_input_c = lf_ptr + 1;
         if (MIME_SCANNER_TYPE_LINE == raw_input_scan_type) {
           zret = PARSE_OK;
@@ -2439,7 +2508,7 @@ mime_scanner_get(MIMEScanner *S, const char **raw_input_s, const char *raw_input
   }
 
   // Make sure there are no '\0' in the input scanned so far
-  if (zret != PARSE_ERROR && memchr(*raw_input_s, '\0', raw_input_c - *raw_input_s) != NULL)
+  if (zret != PARSE_ERROR && saw_nul)
     zret = PARSE_ERROR;
 
   *raw_input_s = raw_input_c; // mark input consumed.
@@ -686,6 +686,12 @@ void mime_field_name_value_set(HdrHeap *heap, MIMEHdrImpl *mh, MIMEField *field,
 void mime_field_value_append(HdrHeap *heap, MIMEHdrImpl *mh, MIMEField *field, const char *value, int length, bool prepend_comma,
                              const char separator);
 
+/// Find the first LF or NUL in [s, e), returns @a e if there is neither.
+typedef const char *(*MIMEScanFunc)(const char *s, const char *e);
+/// Fastest scanner for this CPU, selected by @c mime_init.
+extern MIMEScanFunc mime_scan_lf_or_nul;
+const char *mime_scan_lf_or_nul_scalar(const char *s, const char *e);
+
 void mime_scanner_init(MIMEScanner *scanner);
 void mime_scanner_clear(MIMEScanner *scanner);
 void mime_scanner_append(MIMEScanner *scanner, const char *data, int data_size);
@@ -45,6 +45,45 @@
 
 #define REMEMBER(e, r) master_sm->add_history_entry(__FILE__ ":" _REMEMBER(__LINE__), e, r);
 
+// A fetch being led for collapsed forwarding, keyed by the cache key of the URL.
+struct CollapsedFetch {
+  INK_MD5 key;
+  HttpCacheSM *leader;
+  DList(HttpCacheSM, collapse_link) waiters;
+  LINK(CollapsedFetch, link);
+};
+
+static ClassAllocator<CollapsedFetch> collapsedFetchAllocator("collapsedFetchAllocator");
+
+// The table of fetches being led, split by key so that different URLs rarely share a lock.
+static const int COLLAPSE_SHARDS = 64;
+
+struct CollapseShard {
+  ink_mutex mutex;
+  DLL<CollapsedFetch> fetches;
+
+  CollapseShard() { ink_mutex_init(&mutex, "CollapsedFetch"); }
+};
+
+static CollapseShard collapse_shards[COLLAPSE_SHARDS];
+
+static inline CollapseShard &
+collapse_shard(INK_MD5 const &key)
+{
+  return collapse_shards[key.fold() % COLLAPSE_SHARDS];
+}
+
+static CollapsedFetch *
+collapse_find(CollapseShard &shard, INK_MD5 const &key)
+{
+  for (CollapsedFetch *f = shard.fetches.head; f; f = f->link.next) {
+    if (f->key == key) {
+      return f;
+    }
+  }
+  return NULL;
+}
+
 
 HttpCacheAction::HttpCacheAction() : sm(NULL)
 {
@@ -59,13 +98,15 @@ HttpCacheAction::cancel(Continuation *c)
   this->cancelled = 1;
   if (sm->pending_action)
     sm->pending_action->cancel();
+  sm->collapse_cancel();
 }
 
 HttpCacheSM::HttpCacheSM()
   : Continuation(NULL), cache_read_vc(NULL), cache_write_vc(NULL), read_locked(false), write_locked(false),
     readwhilewrite_inprogress(false), master_sm(NULL), pending_action(NULL), captive_action(), open_read_cb(false),
     open_write_cb(false), open_read_tries(0), read_request_hdr(NULL), read_config(NULL), read_pin_in_cache(0), retry_write(true),
-    open_write_tries(0), lookup_url(NULL), lookup_max_recursive(0), current_lookup_level(0)
+    open_write_tries(0), lookup_url(NULL), lookup_max_recursive(0), current_lookup_level(0), collapse_state(COLLAPSE_NONE),
+    collapse_fetch(NULL), collapse_wake(NULL), collapse_thread(NULL), collapse_waited(false), collapse_after_write(false)
 {
 }
 
@@ -115,7 +156,10 @@ HttpCacheSM::state_cache_open_read(int event, void *data)
   case CACHE_EVENT_OPEN_READ_FAILED:
     if (data == (void *)-ECACHE_DOC_BUSY) {
       // Somebody else is writing the object
-      if (open_read_tries <= master_sm->t_state.txn_conf->max_cache_open_read_retries) {
+      if (collapse_wait(false)) {
+        // Wait for the writer's fetch rather than polling for it
+        open_read_cb = false;
+      } else if (open_read_tries <= master_sm->t_state.txn_conf->max_cache_open_read_retries) {
         // Retry to read; maybe the update finishes in time
         open_read_cb = false;
         do_schedule_in();
@@ -164,10 +208,17 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
     ink_assert(cache_write_vc == NULL);
     cache_write_vc = (CacheVConnection *)data;
     open_write_cb = true;
+    collapse_lead();
     master_sm->handleEvent(event, data);
     break;
 
   case CACHE_EVENT_OPEN_WRITE_FAILED:
+    // If this was a miss and another transaction is fetching the
+    // object, wait for it and read the object it writes instead
+    if (this == &master_sm->get_cache_sm() && cache_read_vc == NULL && master_sm->t_state.cache_info.object_read == NULL &&
+        master_sm->t_state.api_lock_url == HttpTransact::LOCK_URL_FIRST && collapse_wait(true)) {
+      break;
+    }
     // The cache is hosed or full or something.
     // Forward the failure to the main sm
     open_write_cb = true;
@@ -181,6 +232,217 @@ HttpCacheSM::state_cache_open_write(int event, void *data)
   return VC_EVENT_CONT;
 }
 
+//////////////////////////////////////////////////////////////////////////
+//
+//  HttpCacheSM::state_collapse_wait()
+//
+//  State while waiting on another transaction's fetch of the document.
+//  - EVENT_IMMEDIATE
+//    - the leader of the fetch released us
+//  - EVENT_INTERVAL
+//    - proxy.config.http.cache.collapsed_forwarding_timeout expired
+//  Either way the document is looked up again, once.
+//
+//////////////////////////////////////////////////////////////////////////
+int
+HttpCacheSM::state_collapse_wait(int event, void * /* data ATS_UNUSED */)
+{
+  STATE_ENTER(&HttpCacheSM::state_collapse_wait, event);
+  ink_assert(captive_action.cancelled == 0);
+
+  switch (event) {
+  case EVENT_IMMEDIATE: {
+    CollapseShard &shard = collapse_shard(collapse_key);
+
+    ink_mutex_acquire(&shard.mutex);
+    ink_assert(collapse_state == COLLAPSE_WOKEN);
+    collapse_state = COLLAPSE_NONE;
+    collapse_wake = NULL;
+    ink_mutex_release(&shard.mutex);
+    if (pending_action) {
+      pending_action->cancel();
+      pending_action = NULL;
+    }
+    break;
+  }
+
+  case EVENT_INTERVAL:
+    pending_action = NULL;
+    HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_timeout_stat);
+    collapse_cancel();
+    break;
+
+  default:
+    ink_release_assert(0);
+  }
+
+  Debug("http_cache", "[%" PRId64 "] [state_collapse_wait] %s, retrying cache open read", master_sm->sm_id,
+        event == EVENT_IMMEDIATE ? "fetch released" : "timed out");
+
+  if (collapse_after_write) {
+    SET_HANDLER(&HttpCacheSM::state_collapse_read);
+  } else {
+    SET_HANDLER(&HttpCacheSM::state_cache_open_read);
+  }
+  open_read_cb = false;
+  do_cache_open_read();
+
+  return VC_EVENT_CONT;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  HttpCacheSM::state_collapse_read()
+//
+//  The open read issued after waiting for a fetch because the open write
+//  failed. The main sm is still waiting for the open write, so a read is
+//  passed on as the write lock failure read retry, and a failed read as
+//  the original write failure.
+//
+//////////////////////////////////////////////////////////////////////////
+int
+HttpCacheSM::state_collapse_read(int event, void *data)
+{
+  STATE_ENTER(&HttpCacheSM::state_collapse_read, event);
+  ink_assert(captive_action.cancelled == 0);
+  pending_action = NULL;
+
+  switch (event) {
+  case CACHE_EVENT_OPEN_READ:
+    HTTP_INCREMENT_DYN_STAT(http_current_cache_connections_stat);
+    ink_assert(cache_read_vc == NULL);
+    open_read_cb = true;
+    open_write_cb = true;
+    cache_read_vc = (CacheVConnection *)data;
+    master_sm->handleEvent(event, data);
+    break;
+
+  case CACHE_EVENT_OPEN_READ_FAILED:
+    open_read_cb = true;
+    open_write_cb = true;
+    master_sm->handleEvent(CACHE_EVENT_OPEN_WRITE_FAILED, (void *)-ECACHE_DOC_BUSY);
+    break;
+
+  default:
+    ink_release_assert(0);
+  }
+
+  return VC_EVENT_CONT;
+}
+
+// Start leading the fetch of the document we hold the write lock for.
+void
+HttpCacheSM::collapse_lead()
+{
+  if (!master_sm->t_state.http_config_param->cache_collapsed_forwarding || collapse_state != COLLAPSE_NONE || lookup_url == NULL) {
+    return;
+  }
+
+  lookup_url->hash_get(&collapse_key);
+  CollapseShard &shard = collapse_shard(collapse_key);
+
+  ink_mutex_acquire(&shard.mutex);
+  if (collapse_find(shard, collapse_key) == NULL) {
+    CollapsedFetch *f = collapsedFetchAllocator.alloc();
+    f->key = collapse_key;
+    f->leader = this;
+    shard.fetches.push(f);
+    collapse_fetch = f;
+    collapse_state = COLLAPSE_LEADER;
+  }
+  ink_mutex_release(&shard.mutex);
+}
+
+// Stop leading the fetch and wake up everybody waiting on it.
+void
+HttpCacheSM::collapse_release()
+{
+  if (collapse_state != COLLAPSE_LEADER) {
+    return;
+  }
+
+  CollapseShard &shard = collapse_shard(collapse_key);
+  CollapsedFetch *f = collapse_fetch;
+  HttpCacheSM *w;
+
+  ink_mutex_acquire(&shard.mutex);
+  shard.fetches.remove(f);
+  while ((w = f->waiters.pop()) != NULL) {
+    w->collapse_state = COLLAPSE_WOKEN;
+    w->collapse_fetch = NULL;
+    w->collapse_wake = w->collapse_thread->schedule_imm(w);
+  }
+  ink_mutex_release(&shard.mutex);
+
+  collapsedFetchAllocator.free(f);
+  collapse_fetch = NULL;
+  collapse_state = COLLAPSE_NONE;
+}
+
+// Stop waiting on a fetch, whether or not its leader has released us yet.
+void
+HttpCacheSM::collapse_cancel()
+{
+  if (collapse_state != COLLAPSE_WAITING && collapse_state != COLLAPSE_WOKEN) {
+    return;
+  }
+
+  CollapseShard &shard = collapse_shard(collapse_key);
+
+  ink_mutex_acquire(&shard.mutex);
+  if (collapse_state == COLLAPSE_WAITING) {
+    collapse_fetch->waiters.remove(this);
+  } else if (collapse_wake) {
+    collapse_wake->cancel();
+  }
+  collapse_state = COLLAPSE_NONE;
+  collapse_fetch = NULL;
+  collapse_wake = NULL;
+  ink_mutex_release(&shard.mutex);
+}
+
+// Queue on the fetch of our document if another transaction is leading one.
+bool
+HttpCacheSM::collapse_wait(bool after_write)
+{
+  HttpConfigParams *params = master_sm->t_state.http_config_param;
+  CollapsedFetch *f;
+
+  if (!params->cache_collapsed_forwarding || collapse_waited || collapse_state != COLLAPSE_NONE || lookup_url == NULL) {
+    return false;
+  }
+
+  lookup_url->hash_get(&collapse_key);
+  CollapseShard &shard = collapse_shard(collapse_key);
+
+  ink_mutex_acquire(&shard.mutex);
+  f = collapse_find(shard, collapse_key);
+  if (f && f->leader->master_sm != master_sm) {
+    f->waiters.push(this);
+    collapse_fetch = f;
+    collapse_thread = mutex->thread_holding;
+    collapse_wake = NULL;
+    collapse_state = COLLAPSE_WAITING;
+  } else {
+    f = NULL;
+  }
+  ink_mutex_release(&shard.mutex);
+
+  if (f == NULL) {
+    return false;
+  }
+
+  Debug("http_cache", "[%" PRId64 "] [collapse_wait] waiting on another transaction's fetch", master_sm->sm_id);
+  HTTP_INCREMENT_DYN_STAT(http_cache_collapsed_wait_stat);
+  collapse_waited = true;
+  collapse_after_write = after_write;
+  SET_HANDLER(&HttpCacheSM::state_collapse_wait);
+  ink_assert(pending_action == NULL);
+  pending_action = mutex->thread_holding->schedule_in(this, HRTIME_MSECONDS(params->cache_collapsed_forwarding_timeout));
+
+  return true;
+}
+
 void
 HttpCacheSM::do_schedule_in()
 {
@@ -240,6 +502,7 @@ HttpCacheSM::open_read(URL *url, HTTPHdr *hdr, CacheLookupHttpConfig *params, ti
   lookup_max_recursive++;
   current_lookup_level++;
   open_read_cb = false;
+  collapse_waited = false;
   act_return = do_cache_open_read();
   // the following logic is based on the assumption that the secnod
   // lookup won't happen if the HttpSM hasn't been called back for the
@@ -311,3 +574,223 @@ HttpCacheSM::open_write(URL *url, HTTPHdr *request, CacheHTTPInfo *old_info, tim
     return &captive_action;
   }
 }
+
+#if TS_HAS_TESTS
+
+// A state machine that only records the cache event its cache SM hands it.
+struct CollapseTestSM : public HttpSM {
+  int cache_event;
+  ink_hrtime cache_event_at;
+
+  void
+  setup(ProxyMutex *m, URL *url)
+  {
+    mutex = m;
+    init();
+    start_sub_sm();
+    SET_HANDLER(&CollapseTestSM::handle_cache);
+    cache_event = 0;
+    cache_event_at = 0;
+    t_state.hdr_info.client_request.create(HTTP_TYPE_REQUEST);
+    t_state.hdr_info.client_request.method_set(HTTP_METHOD_GET, HTTP_LEN_GET);
+    t_state.hdr_info.client_request.url_set(url);
+    cache_sm.set_lookup_url(url);
+  }
+
+  void
+  teardown()
+  {
+    cleanup();
+    delete this;
+  }
+
+  HttpCacheSM &
+  csm()
+  {
+    return cache_sm;
+  }
+
+  int
+  handle_cache(int event, void * /* data ATS_UNUSED */)
+  {
+    cache_event = event;
+    cache_event_at = ink_get_hrtime();
+    return EVENT_DONE;
+  }
+};
+
+// Drives the collapsed forwarding paths of HttpCacheSM. A leader leads the fetch of one URL with
+//  three transactions queued on it: one whose open read found the document busy, one whose open
+//  write failed and one that cancels. A second leader never releases its URL, so the transaction
+//  queued on it has to time out. Released and timed out transactions repeat their cache lookup
+//  for real, missing, which their state machines see.
+struct CollapseRegression : public Continuation {
+  enum { TIMEOUT_MSECS = 300 };
+
+  RegressionTest *test;
+  int *status;
+  bool failed;
+  URL url, url2;
+  CollapseTestSM *leader, *leader2, *rival, *reader, *writer, *canceller, *sleeper;
+  HttpConfigParams *params; ///< Private config, so the running proxy's is left alone.
+  ink_hrtime released_at;
+  ink_hrtime deadline;
+
+  CollapseRegression(RegressionTest *t, int *pstatus)
+    : Continuation(new_ProxyMutex()), test(t), status(pstatus), failed(false), params(new HttpConfigParams)
+  {
+    params->refcount_inc();
+    params->cache_collapsed_forwarding = 1;
+    params->cache_collapsed_forwarding_timeout = TIMEOUT_MSECS;
+    SET_HANDLER(&CollapseRegression::startEvent);
+  }
+
+  void
+  check(bool ok, const char *what)
+  {
+    if (!ok) {
+      rprintf(test, "HttpCacheSM collapsed forwarding: %s\n", what);
+      failed = true;
+    }
+  }
+
+  CollapseTestSM *
+  new_sm(URL *u)
+  {
+    CollapseTestSM *sm = new CollapseTestSM;
+    sm->setup(mutex, u);
+    // Swap the global config for ours, the state machine releases it when it is cleaned up.
+    HttpConfig::release(sm->t_state.http_config_param);
+    params->refcount_inc();
+    sm->t_state.http_config_param = params;
+    sm->t_state.txn_conf = &params->oride;
+    sm->csm().read_request_hdr = &sm->t_state.hdr_info.client_request;
+    sm->csm().read_config = &sm->t_state.cache_info.config;
+    return sm;
+  }
+
+  // Put @a sm in the state of a cache SM whose lookup, or with @a write whose open write, just
+  //  found the document busy, and pass it the event.
+  void
+  busy(CollapseTestSM *sm, bool write)
+  {
+    HttpCacheSM &c = sm->csm();
+    if (write) {
+      SET_CONTINUATION_HANDLER((&c), &HttpCacheSM::state_cache_open_write);
+      c.handleEvent(CACHE_EVENT_OPEN_WRITE_FAILED, (void *)-ECACHE_DOC_BUSY);
+    } else {
+      SET_CONTINUATION_HANDLER((&c), &HttpCacheSM::state_cache_open_read);
+      c.handleEvent(CACHE_EVENT_OPEN_READ_FAILED, (void *)-ECACHE_DOC_BUSY);
+    }
+  }
+
+  int
+  startEvent(int /* event ATS_UNUSED */, Event *e)
+  {
+    url.create(NULL);
+    url.parse("http://collapse.regression.test/a", -1);
+    url2.create(NULL);
+    url2.parse("http://collapse.regression.test/b", -1);
+
+    leader = new_sm(&url);
+    leader2 = new_sm(&url2);
+    rival = new_sm(&url);
+    reader = new_sm(&url);
+    writer = new_sm(&url);
+    canceller = new_sm(&url);
+    sleeper = new_sm(&url2);
+
+    // Lead: the first cache SM to lead a URL does, nobody else can.
+    leader->csm().collapse_lead();
+    check(leader->csm().collapse_state == HttpCacheSM::COLLAPSE_LEADER, "first cache SM did not lead the fetch");
+    rival->csm().collapse_lead();
+    check(rival->csm().collapse_state == HttpCacheSM::COLLAPSE_NONE, "second cache SM led the same fetch");
+    leader2->csm().collapse_lead();
+    check(leader2->csm().collapse_state == HttpCacheSM::COLLAPSE_LEADER, "cache SM did not lead the fetch of another URL");
+
+    // Wait: a busy read and a failed write queue on the leader, with a timeout pending.
+    busy(reader, false);
+    busy(writer, true);
+    busy(canceller, false);
+    busy(sleeper, false);
+    check(reader->csm().collapse_state == HttpCacheSM::COLLAPSE_WAITING && reader->csm().pending_action,
+          "busy open read did not wait for the fetch");
+    check(writer->csm().collapse_state == HttpCacheSM::COLLAPSE_WAITING && writer->csm().pending_action,
+          "failed open write did not wait for the fetch");
+    check(sleeper->csm().collapse_state == HttpCacheSM::COLLAPSE_WAITING, "busy open read did not wait for the other fetch");
+    CollapsedFetch *fetch = leader->csm().collapse_fetch;
+    check(fetch->waiters.in(&reader->csm()) && fetch->waiters.in(&writer->csm()) && fetch->waiters.in(&canceller->csm()),
+          "fetch is missing a waiter");
+
+    // Cancel: a waiter that goes away leaves the queue and its timeout.
+    canceller->csm().captive_action.cancel();
+    check(canceller->csm().collapse_state == HttpCacheSM::COLLAPSE_NONE, "cancelled waiter is still waiting");
+    check(!fetch->waiters.in(&canceller->csm()), "cancelled waiter is still queued");
+
+    // Release: the waiters are woken, the fetch is gone and the URL can be led again.
+    leader->csm().collapse_release();
+    check(leader->csm().collapse_state == HttpCacheSM::COLLAPSE_NONE, "leader still leads after releasing");
+    check(reader->csm().collapse_state == HttpCacheSM::COLLAPSE_WOKEN && reader->csm().collapse_wake,
+          "released read waiter was not woken");
+    check(writer->csm().collapse_state == HttpCacheSM::COLLAPSE_WOKEN && writer->csm().collapse_wake,
+          "released write waiter was not woken");
+    rival->csm().collapse_lead();
+    check(rival->csm().collapse_state == HttpCacheSM::COLLAPSE_LEADER, "released URL could not be led again");
+    rival->csm().collapse_release();
+
+    released_at = ink_get_hrtime();
+    deadline = released_at + HRTIME_MSECONDS(TIMEOUT_MSECS) + HRTIME_SECONDS(5);
+    SET_HANDLER(&CollapseRegression::waitEvent);
+    e->schedule_in(HRTIME_MSECONDS(50));
+    return EVENT_CONT;
+  }
+
+  int
+  waitEvent(int /* event ATS_UNUSED */, Event *e)
+  {
+    if ((!reader->cache_event || !writer->cache_event || !sleeper->cache_event) && ink_get_hrtime() < deadline) {
+      e->schedule_in(HRTIME_MSECONDS(50));
+      return EVENT_CONT;
+    }
+
+    ink_hrtime timeout = HRTIME_MSECONDS(TIMEOUT_MSECS);
+
+    // Released waiters look the URL up again right away; the read waiter sees the miss, the
+    //  write waiter the original open write failure.
+    check(reader->cache_event == CACHE_EVENT_OPEN_READ_FAILED, "released read waiter did not repeat its lookup");
+    check(reader->cache_event_at - released_at < timeout, "released read waiter waited for its timeout");
+    check(writer->cache_event == CACHE_EVENT_OPEN_WRITE_FAILED, "released write waiter did not report its write failure");
+    check(writer->cache_event_at - released_at < timeout, "released write waiter waited for its timeout");
+    check(canceller->cache_event == 0, "cancelled waiter was called back");
+
+    // A waiter whose leader never releases it gives up after the timeout and looks the URL up.
+    check(sleeper->cache_event == CACHE_EVENT_OPEN_READ_FAILED, "waiter did not time out");
+    check(sleeper->cache_event_at - released_at >= timeout - HRTIME_MSECONDS(50), "waiter timed out early");
+    check(sleeper->csm().collapse_state == HttpCacheSM::COLLAPSE_NONE, "timed out waiter is still waiting");
+    check(leader2->csm().collapse_fetch->waiters.empty(), "timed out waiter is still queued");
+    leader2->csm().collapse_release();
+
+    leader->teardown();
+    leader2->teardown();
+    rival->teardown();
+    reader->teardown();
+    writer->teardown();
+    canceller->teardown();
+    sleeper->teardown();
+    url.destroy();
+    url2.destroy();
+    if (params->refcount_dec() == 0)
+      delete params;
+    *status = failed ? REGRESSION_TEST_FAILED : REGRESSION_TEST_PASSED;
+    delete this;
+    return EVENT_DONE;
+  }
+};
+
+REGRESSION_TEST(HttpCacheSM_collapse)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+  eventProcessor.schedule_imm(new CollapseRegression(t, pstatus), ET_NET);
+}
+
+#endif
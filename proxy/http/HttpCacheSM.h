@@ -43,6 +43,7 @@
 class HttpSM;
 class HttpCacheSM;
 class CacheLookupHttpConfig;
+struct CollapsedFetch;
 
 struct HttpCacheAction : public Action {
   HttpCacheAction();
@@ -109,6 +110,7 @@ public:
   inline void
   abort_write()
   {
+    collapse_release();
     if (cache_write_vc) {
       HTTP_DECREMENT_DYN_STAT(http_current_cache_connections_stat);
       cache_write_vc->do_io(VIO::ABORT);
@@ -118,6 +120,7 @@ public:
   inline void
   close_write()
   {
+    collapse_release();
     if (cache_write_vc) {
       HTTP_DECREMENT_DYN_STAT(http_current_cache_connections_stat);
       cache_write_vc->do_io(VIO::CLOSE);
@@ -140,6 +143,7 @@ public:
     //   records its stats
     close_read();
     abort_write();
+    collapse_cancel();
   }
   inline URL *
   get_lookup_url()
@@ -152,12 +156,34 @@ public:
     lookup_url = url;
   }
 
+  // Collapsed forwarding. The cache SM that holds the write lock for a URL leads its fetch, and
+  //  cache SMs that find the URL busy wait for the leader to release them instead of polling the
+  //  cache. The leader releases its waiters once the response header is in the cache (or, without
+  //  read while writer, once the write is finished) and whenever it gives up the write.
+  void collapse_lead();
+  void collapse_release();
+  void collapse_cancel();
+
+  enum CollapseState {
+    COLLAPSE_NONE,
+    COLLAPSE_LEADER,  // leading a fetch
+    COLLAPSE_WAITING, // queued on a fetch
+    COLLAPSE_WOKEN,   // released by the leader, wake up event scheduled
+  };
+
+  LINK(HttpCacheSM, collapse_link);
+
 private:
+  friend struct CollapseRegression;
+
   void do_schedule_in();
   Action *do_cache_open_read();
+  bool collapse_wait(bool after_write);
 
   int state_cache_open_read(int event, void *data);
   int state_cache_open_write(int event, void *data);
+  int state_collapse_wait(int event, void *data);
+  int state_collapse_read(int event, void *data);
 
   HttpCacheAction captive_action;
   bool open_read_cb;
@@ -179,6 +205,16 @@ private:
   // to keep track of multiple cache lookups
   int lookup_max_recursive;
   int current_lookup_level;
+
+  // Collapsed forwarding state. While waiting, the state, wake up event and fetch are
+  //  changed by the leader's thread, so they are only accessed with the fetch table locked.
+  CollapseState collapse_state;
+  CollapsedFetch *collapse_fetch;
+  Event *collapse_wake;
+  EThread *collapse_thread;
+  INK_MD5 collapse_key;
+  bool collapse_waited;      // waited once for this lookup already
+  bool collapse_after_write; // waiting because the open write failed
 };
 
 #endif
@@ -51,6 +51,9 @@
 
 
 RecRawStatBlock *http_rsb;
+RecRawStatBlock *http_ttfb_hsb;
+RecRawStatBlock *http_origin_connect_hsb;
+RecRawStatBlock *http_cache_open_read_hsb;
 #define HTTP_CLEAR_DYN_STAT(x)          \
   do {                                  \
     RecSetRawStatSum(http_rsb, x, 0);   \
@@ -113,7 +116,8 @@ static const ConfigEnumPair<TSServerSessionSharingMatchType> SessionSharingMatch
 
 static const ConfigEnumPair<TSServerSessionSharingPoolType> SessionSharingPoolStrings[] = {
   {TS_SERVER_SESSION_SHARING_POOL_GLOBAL, "global"},
-  {TS_SERVER_SESSION_SHARING_POOL_THREAD, "thread"}};
+  {TS_SERVER_SESSION_SHARING_POOL_THREAD, "thread"},
+  {TS_SERVER_SESSION_SHARING_POOL_HYBRID, "hybrid"}};
 
 ////////////////////////////////////////////////////////////////
 //
@@ -277,6 +281,22 @@ register_stat_callbacks()
   RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.current_server_connections", RECD_INT, RECP_NON_PERSISTENT,
                      (int)http_current_server_connections_stat, RecRawStatSyncSum);
   HTTP_CLEAR_DYN_STAT(http_current_server_connections_stat);
+
+  // Collapsed forwarding stats
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.cache.collapsed_forwarding.waits", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_cache_collapsed_wait_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.cache.collapsed_forwarding.timeouts", RECD_COUNTER,
+                     RECP_PERSISTENT, (int)http_cache_collapsed_timeout_stat, RecRawStatSyncCount);
+
+  // Server session pool stats
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.server_session_pool.hits", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_server_session_pool_hit_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.server_session_pool.misses", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_server_session_pool_miss_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.server_session_pool.steals", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_server_session_pool_steal_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.server_session_pool.overflows", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_server_session_pool_overflow_stat, RecRawStatSyncCount);
   RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.current_cache_connections", RECD_INT, RECP_NON_PERSISTENT,
                      (int)http_current_cache_connections_stat, RecRawStatSyncSum);
   HTTP_CLEAR_DYN_STAT(http_current_cache_connections_stat);
@@ -508,6 +528,12 @@ register_stat_callbacks()
   RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.cache_hit_stale_served", RECD_COUNTER, RECP_PERSISTENT,
                      (int)http_cache_hit_stale_served_stat, RecRawStatSyncCount);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.cache_hit_stale_while_revalidate", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_cache_hit_stale_while_revalidate_stat, RecRawStatSyncCount);
+
+  RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.background_revalidations", RECD_COUNTER, RECP_PERSISTENT,
+                     (int)http_background_revalidations_stat, RecRawStatSyncCount);
+
   RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.http.cache_miss_cold", RECD_COUNTER, RECP_PERSISTENT,
                      (int)http_cache_miss_cold_stat, RecRawStatSyncCount);
 
@@ -854,6 +880,11 @@ register_stat_callbacks()
                      (int)https_incoming_requests_stat, RecRawStatSyncCount);
   RecRegisterRawStat(http_rsb, RECT_PROCESS, "proxy.process.https.total_client_connections", RECD_COUNTER, RECP_PERSISTENT,
                      (int)https_total_client_connections_stat, RecRawStatSyncCount);
+
+  // Latency histograms
+  RecRegisterHistogram(http_ttfb_hsb, RECT_PROCESS, "proxy.process.http.ttfb_time_us", RECP_NON_PERSISTENT);
+  RecRegisterHistogram(http_origin_connect_hsb, RECT_PROCESS, "proxy.process.http.origin_connect_time_us", RECP_NON_PERSISTENT);
+  RecRegisterHistogram(http_cache_open_read_hsb, RECT_PROCESS, "proxy.process.http.cache_open_read_time_us", RECP_NON_PERSISTENT);
 }
 
 
@@ -866,6 +897,9 @@ void
 HttpConfig::startup()
 {
   http_rsb = RecAllocateRawStatBlock((int)http_stat_count);
+  http_ttfb_hsb = RecAllocateHistogram();
+  http_origin_connect_hsb = RecAllocateHistogram();
+  http_cache_open_read_hsb = RecAllocateHistogram();
   register_stat_callbacks();
 
   HttpConfigParams &c = m_master;
@@ -1047,6 +1081,8 @@ HttpConfig::startup()
   HttpEstablishStaticConfigByte(c.oride.cache_urls_that_look_dynamic, "proxy.config.http.cache.cache_urls_that_look_dynamic");
   HttpEstablishStaticConfigByte(c.cache_enable_default_vary_headers, "proxy.config.http.cache.enable_default_vary_headers");
   HttpEstablishStaticConfigByte(c.cache_post_method, "proxy.config.http.cache.post_method");
+  HttpEstablishStaticConfigByte(c.cache_stale_while_revalidate, "proxy.config.http.cache.stale_while_revalidate");
+  HttpEstablishStaticConfigByte(c.cache_stale_if_error, "proxy.config.http.cache.stale_if_error");
 
   HttpEstablishStaticConfigByte(c.ignore_accept_mismatch, "proxy.config.http.cache.ignore_accept_mismatch");
   HttpEstablishStaticConfigByte(c.ignore_accept_language_mismatch, "proxy.config.http.cache.ignore_accept_language_mismatch");
@@ -1056,6 +1092,9 @@ HttpConfig::startup()
   HttpEstablishStaticConfigByte(c.send_100_continue_response, "proxy.config.http.send_100_continue_response");
   HttpEstablishStaticConfigByte(c.send_408_post_timeout_response, "proxy.config.http.send_408_post_timeout_response");
   HttpEstablishStaticConfigLongLong(c.cache_open_write_fail_action, "proxy.config.http.cache.open_write_fail_action");
+  HttpEstablishStaticConfigByte(c.cache_collapsed_forwarding, "proxy.config.http.cache.collapsed_forwarding");
+  HttpEstablishStaticConfigLongLong(c.cache_collapsed_forwarding_timeout, "proxy.config.http.cache.collapsed_forwarding_timeout");
+  HttpEstablishStaticConfigByte(c.tunnel_splice, "proxy.config.http.tunnel_splice");
   HttpEstablishStaticConfigByte(c.disallow_post_100_continue, "proxy.config.http.disallow_post_100_continue");
   HttpEstablishStaticConfigByte(c.parser_allow_non_http, "proxy.config.http.parse.allow_non_http");
 
@@ -1316,6 +1355,8 @@ HttpConfig::reconfigure()
   params->oride.cache_urls_that_look_dynamic = INT_TO_BOOL(m_master.oride.cache_urls_that_look_dynamic);
   params->cache_enable_default_vary_headers = INT_TO_BOOL(m_master.cache_enable_default_vary_headers);
   params->cache_post_method = INT_TO_BOOL(m_master.cache_post_method);
+  params->cache_stale_while_revalidate = INT_TO_BOOL(m_master.cache_stale_while_revalidate);
+  params->cache_stale_if_error = INT_TO_BOOL(m_master.cache_stale_if_error);
 
   params->ignore_accept_mismatch = m_master.ignore_accept_mismatch;
   params->ignore_accept_language_mismatch = m_master.ignore_accept_language_mismatch;
@@ -1325,6 +1366,9 @@ HttpConfig::reconfigure()
   params->send_100_continue_response = INT_TO_BOOL(m_master.send_100_continue_response);
   params->send_408_post_timeout_response = INT_TO_BOOL(m_master.send_408_post_timeout_response);
   params->cache_open_write_fail_action = m_master.cache_open_write_fail_action;
+  params->cache_collapsed_forwarding = INT_TO_BOOL(m_master.cache_collapsed_forwarding);
+  params->cache_collapsed_forwarding_timeout = m_master.cache_collapsed_forwarding_timeout;
+  params->tunnel_splice = INT_TO_BOOL(m_master.tunnel_splice);
   params->disallow_post_100_continue = INT_TO_BOOL(m_master.disallow_post_100_continue);
   params->parser_allow_non_http = INT_TO_BOOL(m_master.parser_allow_non_http);
 
@@ -77,6 +77,16 @@ enum {
   http_current_server_connections_stat,
   http_current_cache_connections_stat,
 
+  // Collapsed forwarding stats
+  http_cache_collapsed_wait_stat,
+  http_cache_collapsed_timeout_stat,
+
+  // Server session pool stats
+  http_server_session_pool_hit_stat,
+  http_server_session_pool_miss_stat,
+  http_server_session_pool_steal_stat,
+  http_server_session_pool_overflow_stat,
+
   // Http K-A Stats
   http_transactions_per_client_con,
   http_transactions_per_server_con,
@@ -170,6 +180,8 @@ enum {
   http_cache_hit_reval_stat,
   http_cache_hit_ims_stat,
   http_cache_hit_stale_served_stat,
+  http_cache_hit_stale_while_revalidate_stat,
+  http_background_revalidations_stat,
   http_cache_miss_cold_stat,
   http_cache_miss_changed_stat,
   http_cache_miss_client_no_cache_stat,
@@ -293,11 +305,17 @@ enum {
 
 extern RecRawStatBlock *http_rsb;
 
+// Latency histograms, in microseconds
+extern RecRawStatBlock *http_ttfb_hsb;
+extern RecRawStatBlock *http_origin_connect_hsb;
+extern RecRawStatBlock *http_cache_open_read_hsb;
+
 /* Stats should only be accessed using these macros */
 #define HTTP_INCREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, mutex->thread_holding, (int)x, 1)
 #define HTTP_DECREMENT_DYN_STAT(x) RecIncrRawStat(http_rsb, mutex->thread_holding, (int)x, -1)
 #define HTTP_SUM_DYN_STAT(x, y) RecIncrRawStat(http_rsb, mutex->thread_holding, (int)x, (int64_t)y)
 #define HTTP_SUM_GLOBAL_DYN_STAT(x, y) RecIncrGlobalRawStatSum(http_rsb, x, y)
+#define HTTP_HISTOGRAM_RECORD(h, y) RecRecordHistogram(h, mutex->thread_holding, (int64_t)y)
 
 #define HTTP_CLEAR_DYN_STAT(x)          \
   do {                                  \
@@ -674,6 +692,8 @@ public:
   ///////////////////
   MgmtByte cache_enable_default_vary_headers;
   MgmtByte cache_post_method;
+  MgmtByte cache_stale_while_revalidate;
+  MgmtByte cache_stale_if_error;
 
   ////////////////////////////////////////////
   // CONNECT ports (used to be == ssl_ports //
@@ -748,6 +768,9 @@ public:
   MgmtByte send_100_continue_response;
   MgmtByte send_408_post_timeout_response;
   MgmtInt cache_open_write_fail_action;
+  MgmtByte cache_collapsed_forwarding;
+  MgmtInt cache_collapsed_forwarding_timeout; // time is in mseconds
+  MgmtByte tunnel_splice;
   MgmtByte disallow_post_100_continue;
   MgmtByte parser_allow_non_http;
 
@@ -853,13 +876,15 @@ inline HttpConfigParams::HttpConfigParams()
     session_auth_cache_keep_alive_enabled(1), accept_no_activity_timeout(120), parent_connect_timeout(30),
     anonymize_other_header_list(NULL), enable_http_stats(1), icp_enabled(0), stale_icp_enabled(0), cache_vary_default_text(NULL),
     cache_vary_default_images(NULL), cache_vary_default_other(NULL), max_cache_open_write_retries(1),
-    cache_enable_default_vary_headers(0), cache_post_method(0), connect_ports_string(NULL), connect_ports(NULL),
-    push_method_enabled(0), referer_filter_enabled(0), referer_format_redirect(0), reverse_proxy_enabled(0), url_remap_required(1),
+    cache_enable_default_vary_headers(0), cache_post_method(0), cache_stale_while_revalidate(0), cache_stale_if_error(0),
+    connect_ports_string(NULL), connect_ports(NULL), push_method_enabled(0), referer_filter_enabled(0), referer_format_redirect(0),
+    reverse_proxy_enabled(0), url_remap_required(1), reverse_proxy_no_host_redirect(NULL), reverse_proxy_no_host_redirect_len(0),
     record_cop_page(0), errors_log_error_pages(1), enable_http_info(0), cluster_time_delta(0), redirection_enabled(0),
     redirection_host_no_port(0), number_of_redirections(1), post_copy_size(2048), ignore_accept_mismatch(0),
     ignore_accept_language_mismatch(0), ignore_accept_encoding_mismatch(0), ignore_accept_charset_mismatch(0),
     send_100_continue_response(0), send_408_post_timeout_response(0), cache_open_write_fail_action(0),
-    disallow_post_100_continue(0), parser_allow_non_http(1), autoconf_port(0), autoconf_localhost_only(0)
+    cache_collapsed_forwarding(0), cache_collapsed_forwarding_timeout(3000), tunnel_splice(0), disallow_post_100_continue(0),
+    parser_allow_non_http(1), autoconf_port(0), autoconf_localhost_only(0)
 {
 }
 
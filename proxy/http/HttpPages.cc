@@ -33,6 +33,7 @@
 #include "HttpPages.h"
 #include "HttpSM.h"
 #include "HttpDebugNames.h"
+#include "HttpSessionManager.h"
 
 HttpSMListBucket HttpSMList[HTTP_LIST_BUCKETS];
 
@@ -54,6 +55,9 @@ HttpPagesHandler::HttpPagesHandler(Continuation *cont, HTTPHdr *header)
     request = arena.str_store(request, length);
     SET_HANDLER(&HttpPagesHandler::handle_smdetails);
 
+  } else if (strncmp(request, "origin_sessions", sizeof("origin_sessions")) == 0) {
+    SET_HANDLER(&HttpPagesHandler::handle_origin_sessions);
+
   } else {
     SET_HANDLER(&HttpPagesHandler::handle_smlist);
   }
@@ -340,6 +344,56 @@ HttpPagesHandler::handle_smdetails(int event, void * /* data ATS_UNUSED */)
   return handle_callback(EVENT_NONE, NULL);
 }
 
+int
+HttpPagesHandler::handle_origin_sessions(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+{
+  Vec<OriginSessionStats::Entry> entries;
+
+  httpSessionManager.origin_stats().snapshot(entries);
+
+  resp_begin("Http:Origin Sessions");
+  resp_begin_table(1, 4, 60);
+  resp_begin_row();
+  resp_begin_column();
+  resp_add("<b>Origin</b>");
+  resp_end_column();
+  resp_begin_column();
+  resp_add("<b>Reused</b>");
+  resp_end_column();
+  resp_begin_column();
+  resp_add("<b>Missed</b>");
+  resp_end_column();
+  resp_begin_column();
+  resp_add("<b>Reuse ratio</b>");
+  resp_end_column();
+  resp_end_row();
+
+  for (unsigned i = 0; i < entries.length(); ++i) {
+    OriginSessionStats::Entry &e = entries[i];
+    int64_t total = e.counts.reused + e.counts.missed;
+    ip_text_buffer ipb;
+
+    resp_begin_row();
+    resp_begin_column();
+    resp_add("%s", ats_ip_ntop(&e.addr.sa, ipb, sizeof(ipb)));
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%" PRId64, e.counts.reused);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%" PRId64, e.counts.missed);
+    resp_end_column();
+    resp_begin_column();
+    resp_add("%.3f", total ? static_cast<double>(e.counts.reused) / total : 0.0);
+    resp_end_column();
+    resp_end_row();
+  }
+
+  resp_end_table();
+  resp_end();
+  return handle_callback(EVENT_NONE, NULL);
+}
+
 int
 HttpPagesHandler::handle_smlist(int event, void * /* data ATS_UNUSED */)
 {
@@ -61,6 +61,7 @@ public:
 
   int handle_smlist(int event, void *edata);
   int handle_smdetails(int event, void *edata);
+  int handle_origin_sessions(int event, void *edata);
   int handle_callback(int event, void *edata);
   Action action;
 
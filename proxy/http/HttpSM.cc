@@ -23,6 +23,7 @@
  */
 
 #include "HttpSM.h"
+#include "HttpUpdateSM.h"
 #include "ProxyConfig.h"
 #include "HttpClientSession.h"
 #include "HttpServerSession.h"
@@ -3347,6 +3348,12 @@ HttpSM::tunnel_handler_cache_write(int event, HttpTunnelConsumer *c)
     break;
   }
 
+  // The write is finished or abandoned, so transactions waiting on this
+  //  fetch can look the document up again. With read while writer they
+  //  were released when the header was set.
+  HttpCacheSM &c_sm = (c->producer->vc_type == HT_TRANSFORM) ? transform_cache_sm : cache_sm;
+  c_sm.collapse_release();
+
   HTTP_DECREMENT_DYN_STAT(http_current_cache_connections_stat);
   return 0;
 }
@@ -4329,6 +4336,18 @@ HttpSM::do_range_parse(MIMEField *range_field)
   calculate_output_cl(num_chars_for_ct, num_chars_for_cl);
 }
 
+bool
+HttpSM::do_background_revalidate()
+{
+  ink_assert(t_state.cache_info.lookup_url != NULL);
+
+  if (HttpUpdateSM::start_background_revalidate(&t_state.hdr_info.client_request, t_state.cache_info.lookup_url)) {
+    DebugSM("http", "[%" PRId64 "] background revalidation of stale object in progress", sm_id);
+    return true;
+  }
+  return false;
+}
+
 // this function looks for any Range: headers, parses them and either
 // sets up a transform processor to handle the request OR defers to the
 // HttpTunnel
@@ -5851,6 +5870,12 @@ HttpSM::setup_cache_write_transfer(HttpCacheSM *c_sm, VConnection *source_vc, HT
   c_sm->cache_write_vc->set_http_info(store_info);
   store_info->clear();
 
+  // With read while writer, transactions waiting on this fetch can read
+  //  the document now that its header is set
+  if (cache_config_read_while_writer) {
+    c_sm->collapse_release();
+  }
+
   tunnel.add_consumer(c_sm->cache_write_vc, source_vc, &HttpSM::tunnel_handler_cache_write, HT_CACHE_WRITE, name, skip_bytes);
 
   c_sm->cache_write_vc = NULL;
@@ -6670,6 +6695,18 @@ HttpSM::update_stats()
     os_read_time = -1;
   }
 
+  // Latency histograms
+  if (milestones.ua_begin_write != 0) {
+    HTTP_HISTOGRAM_RECORD(http_ttfb_hsb, ink_hrtime_to_usec(milestones.ua_begin_write - milestones.sm_start));
+  }
+  if (milestones.server_connect != 0 && milestones.server_connect_end != 0) {
+    HTTP_HISTOGRAM_RECORD(http_origin_connect_hsb, ink_hrtime_to_usec(milestones.server_connect_end - milestones.server_connect));
+  }
+  if (milestones.cache_open_read_begin != 0 && milestones.cache_open_read_end != 0) {
+    HTTP_HISTOGRAM_RECORD(http_cache_open_read_hsb,
+                          ink_hrtime_to_usec(milestones.cache_open_read_end - milestones.cache_open_read_begin));
+  }
+
   HttpTransact::update_size_and_time_stats(&t_state, total_time, ua_write_time, os_read_time, client_request_hdr_bytes,
                                            client_request_body_bytes, client_response_hdr_bytes, client_response_body_bytes,
                                            server_request_hdr_bytes, server_request_body_bytes, server_response_hdr_bytes,
@@ -216,6 +216,11 @@ public:
   //  directly from transact
   void do_hostdb_update_if_necessary();
 
+  // Called by transact when serving a stale hit. Hands the
+  //  request to a background HttpUpdateSM; returns false if
+  //  the object must be revalidated in the foreground
+  bool do_background_revalidate();
+
   // Called by transact. Decide if cached response supports Range and
   // setup Range transfomration if so.
   // return true when the Range is unsatisfiable
@@ -36,16 +36,28 @@
 #include "HttpSM.h"
 #include "HttpDebugNames.h"
 
+// The per thread pools, so that hybrid pools can look for idle sessions on other threads.
+static ServerSessionPool *thread_pools[MAX_EVENT_THREADS];
+static volatile int n_thread_pools = 0;
+
 // Initialize a thread to handle HTTP session management
 void
 initialize_thread_for_http_sessions(EThread *thread, int /* thread_index ATS_UNUSED */)
 {
-  thread->server_session_pool = new ServerSessionPool;
+  ServerSessionPool *pool = new ServerSessionPool;
+  int idx = ink_atomic_increment(&n_thread_pools, 1);
+
+  ink_release_assert(idx < MAX_EVENT_THREADS);
+  pool->m_thread_index = idx;
+  thread_pools[idx] = pool;
+  thread->server_session_pool = pool;
+  httpSessionManager.origin_stats().init_thread(idx);
 }
 
 HttpSessionManager httpSessionManager;
 
-ServerSessionPool::ServerSessionPool() : Continuation(new_ProxyMutex()), m_ip_pool(1023), m_host_pool(1023)
+ServerSessionPool::ServerSessionPool()
+  : Continuation(new_ProxyMutex()), m_ip_pool(1023), m_host_pool(1023), m_thread_index(-1), m_idle_count(0)
 {
   SET_HANDLER(&ServerSessionPool::eventHandler);
   m_ip_pool.setExpansionPolicy(IPHashTable::MANUAL);
@@ -60,6 +72,7 @@ ServerSessionPool::purge()
   }
   m_ip_pool.clear();
   m_host_pool.clear();
+  m_idle_count = 0;
 }
 
 bool
@@ -105,6 +118,9 @@ ServerSessionPool::acquireSession(sockaddr const *addr, INK_MD5 const &hostname_
       m_host_pool.remove(m_host_pool.find(zret));
     }
   }
+  if (zret) {
+    ink_atomic_increment(&m_idle_count, -1);
+  }
   return zret;
 }
 
@@ -127,6 +143,7 @@ ServerSessionPool::releaseSession(HttpServerSession *ss)
   // put it in the pools.
   m_ip_pool.insert(ss);
   m_host_pool.insert(ss);
+  ink_atomic_increment(&m_idle_count, 1);
 
   Debug("http_ss", "[%" PRId64 "] [release session] "
                    "session placed into shared pool",
@@ -193,6 +210,7 @@ ServerSessionPool::eventHandler(int event, void *data)
       // Out of the pool! Now!
       m_ip_pool.remove(lh);
       m_host_pool.remove(m_host_pool.find(s));
+      ink_atomic_increment(&m_idle_count, -1);
       // Drop connection on this end.
       s->do_io_close();
       found = true;
@@ -211,10 +229,123 @@ ServerSessionPool::eventHandler(int event, void *data)
 }
 
 
+OriginSessionStats::OriginSessionStats()
+{
+  for (int i = 0; i < MAX_EVENT_THREADS; ++i) {
+    m_tables[i] = NULL;
+  }
+}
+
+void
+OriginSessionStats::init_thread(int thread_index)
+{
+  Table *table = static_cast<Table *>(ats_malloc(sizeof(Table)));
+
+  memset(table, 0, sizeof(Table));
+  m_tables[thread_index] = table;
+}
+
+void
+OriginSessionStats::record(EThread *ethread, sockaddr const *addr, bool reused_p)
+{
+  ServerSessionPool *pool = ethread ? ethread->server_session_pool : NULL;
+  Table *table = pool ? m_tables[pool->m_thread_index] : NULL;
+
+  if (!table) {
+    return;
+  }
+
+  ink_hrtime now = ink_get_hrtime();
+  uint32_t hash = ats_ip_hash(addr);
+  Slot *slot = NULL;
+  Slot *victim = NULL;
+
+  for (int i = 0; i < PROBES; ++i) {
+    Slot *s = &table->slots[(hash + i) % SLOTS];
+    if (s->last_used && ats_ip_addr_eq(&s->addr.sa, addr)) {
+      slot = s;
+      break;
+    }
+    if (!victim || s->last_used < victim->last_used) {
+      victim = s;
+    }
+  }
+
+  if (!slot) {
+    // Take over the empty or least recently used slot. Only this thread writes the table, the
+    // version only tells a concurrent snapshot() that the address and counters may not match.
+    slot = victim;
+    ink_atomic_increment(&slot->version, 1);
+    ats_ip_copy(&slot->addr, addr);
+    slot->reused = 0;
+    slot->missed = 0;
+    INK_WRITE_MEMORY_BARRIER;
+    ink_atomic_increment(&slot->version, 1);
+  }
+
+  slot->last_used = now;
+  if (reused_p) {
+    ++slot->reused;
+  } else {
+    ++slot->missed;
+  }
+}
+
+void
+OriginSessionStats::snapshot(Vec<Entry> &entries)
+{
+  CountMap merged;
+
+  for (int t = 0; t < MAX_EVENT_THREADS; ++t) {
+    Table *table = m_tables[t];
+
+    if (!table) {
+      continue;
+    }
+    for (int i = 0; i < SLOTS; ++i) {
+      Slot &slot = table->slots[i];
+      IpEndpoint addr;
+      Counts counts;
+      int version;
+
+      do {
+        version = slot.version;
+        INK_MEMORY_BARRIER;
+        ats_ip_copy(&addr, &slot.addr);
+        counts.reused = slot.reused;
+        counts.missed = slot.missed;
+        INK_MEMORY_BARRIER;
+      } while ((version & 1) || version != slot.version);
+
+      if (!ats_is_ip(&addr)) {
+        continue;
+      }
+
+      ConnectionCount::ConnAddr caddr(addr);
+      CountMap::value_type *elt = merged.get_internal(caddr);
+      if (!elt) {
+        elt = merged.put(caddr, Counts());
+      }
+      elt->value.reused += counts.reused;
+      elt->value.missed += counts.missed;
+    }
+  }
+
+  form_Map(CountMap::value_type, elt, merged)
+  {
+    Entry e;
+    e.addr = elt->key._addr;
+    e.counts = elt->value;
+    entries.add(e);
+  }
+}
+
 void
 HttpSessionManager::init()
 {
   m_g_pool = new ServerSessionPool;
+  m_thread_pool_max = 64;
+  REC_ReadConfigInteger(m_thread_pool_max, "proxy.config.http.server_session_sharing.thread_pool_max");
 }
 
 // TODO: Should this really purge all keep-alive sessions?
@@ -230,6 +361,56 @@ HttpSessionManager::purge_keepalives()
   } // should we do something clever if we don't get the lock?
 }
 
+// Look for a session for a hybrid pool: first in the thread's own pool, then in the global pool,
+// then in the pools of the other threads. Pools that are locked or empty are skipped, so this never
+// asks for a retry; a busy pool is treated as a miss and a new server connection is opened.
+HttpServerSession *
+HttpSessionManager::acquire_hybrid(EThread *ethread, sockaddr const *ip, INK_MD5 const &hostname_hash,
+                                   TSServerSessionSharingMatchType match_style)
+{
+  HttpServerSession *to_return = NULL;
+  ServerSessionPool *own = ethread->server_session_pool;
+  ProxyMutex *mutex = ethread->mutex;
+
+  if (own && own->idleCount() > 0) {
+    MUTEX_TRY_LOCK(lock, own->mutex, ethread);
+    if (lock.is_locked()) {
+      to_return = own->acquireSession(ip, hostname_hash, match_style);
+    }
+  }
+
+  if (!to_return && m_g_pool->idleCount() > 0) {
+    MUTEX_TRY_LOCK(lock, m_g_pool->mutex, ethread);
+    if (lock.is_locked()) {
+      to_return = m_g_pool->acquireSession(ip, hostname_hash, match_style);
+    }
+  }
+
+  if (!to_return) {
+    int n = n_thread_pools;
+    int start = own ? own->m_thread_index + 1 : 0;
+
+    for (int i = 0; i < n && !to_return; ++i) {
+      ServerSessionPool *pool = thread_pools[(start + i) % n];
+
+      if (pool == NULL || pool == own || pool->idleCount() <= 0) {
+        continue;
+      }
+      MUTEX_TRY_LOCK(lock, pool->mutex, ethread);
+      if (lock.is_locked()) {
+        to_return = pool->acquireSession(ip, hostname_hash, match_style);
+        if (to_return) {
+          Debug("http_ss", "[%" PRId64 "] [acquire session] taken from the pool of thread %d", to_return->con_id,
+                pool->m_thread_index);
+          HTTP_INCREMENT_DYN_STAT(http_server_session_pool_steal_stat);
+        }
+      }
+    }
+  }
+
+  return to_return;
+}
+
 HSMresult_t
 HttpSessionManager::acquire_session(Continuation * /* cont ATS_UNUSED */, sockaddr const *ip, const char *hostname,
                                     HttpClientSession *ua_session, HttpSM *sm)
@@ -249,6 +430,7 @@ HttpSessionManager::acquire_session(Continuation * /* cont ATS_UNUSED */, sockad
 
     if (ServerSessionPool::match(to_return, ip, hostname_hash, match_style)) {
       Debug("http_ss", "[%" PRId64 "] [acquire session] returning attached session ", to_return->con_id);
+      m_origin_stats.record(this_ethread(), ip, true);
       to_return->state = HSS_ACTIVE;
       sm->attach_server_session(to_return);
       return HSM_DONE;
@@ -264,9 +446,17 @@ HttpSessionManager::acquire_session(Continuation * /* cont ATS_UNUSED */, sockad
 
   // Now check to see if we have a connection in our shared connection pool
   EThread *ethread = this_ethread();
+  ProxyMutex *mutex = ethread->mutex;
 
   if (TS_SERVER_SESSION_SHARING_POOL_THREAD == sm->t_state.txn_conf->server_session_sharing_pool) {
+    // Only contended if a hybrid pool on another thread is searching this one.
+    MUTEX_TRY_LOCK(lock, ethread->server_session_pool->mutex, ethread);
+    if (!lock.is_locked()) {
+      return HSM_RETRY;
+    }
     to_return = ethread->server_session_pool->acquireSession(ip, hostname_hash, match_style);
+  } else if (TS_SERVER_SESSION_SHARING_POOL_HYBRID == sm->t_state.txn_conf->server_session_sharing_pool) {
+    to_return = acquire_hybrid(ethread, ip, hostname_hash, match_style);
   } else {
     MUTEX_TRY_LOCK(lock, m_g_pool->mutex, ethread);
     if (lock.is_locked()) {
@@ -282,10 +472,16 @@ HttpSessionManager::acquire_session(Continuation * /* cont ATS_UNUSED */, sockad
     Debug("http_ss", "[%" PRId64 "] [acquire session] "
                      "return session from shared pool",
           to_return->con_id);
+    HTTP_INCREMENT_DYN_STAT(http_server_session_pool_hit_stat);
+    m_origin_stats.record(ethread, ip, true);
     to_return->state = HSS_ACTIVE;
     sm->attach_server_session(to_return);
     return HSM_DONE;
   }
+  if (TS_SERVER_SESSION_SHARING_MATCH_NONE != match_style) {
+    HTTP_INCREMENT_DYN_STAT(http_server_session_pool_miss_stat);
+    m_origin_stats.record(ethread, ip, false);
+  }
   return HSM_NOT_FOUND;
 }
 
@@ -294,13 +490,24 @@ HttpSessionManager::release_session(HttpServerSession *to_release)
 {
   EThread *ethread = this_ethread();
   ServerSessionPool *pool =
-    TS_SERVER_SESSION_SHARING_POOL_THREAD == to_release->sharing_pool ? ethread->server_session_pool : m_g_pool;
+    TS_SERVER_SESSION_SHARING_POOL_GLOBAL == to_release->sharing_pool ? m_g_pool : ethread->server_session_pool;
   bool released_p = true;
+  bool overflow_p = false;
+
+  // A full thread pool overflows to the global pool, where any thread can find the session.
+  if (TS_SERVER_SESSION_SHARING_POOL_HYBRID == to_release->sharing_pool && pool->idleCount() >= m_thread_pool_max) {
+    pool = m_g_pool;
+    overflow_p = true;
+  }
 
   // The per thread lock looks like it should not be needed but if it's not locked the close checking I/O op will crash.
   MUTEX_TRY_LOCK(lock, pool->mutex, ethread);
   if (lock.is_locked()) {
     pool->releaseSession(to_release);
+    if (overflow_p) {
+      ProxyMutex *mutex = ethread->mutex;
+      HTTP_INCREMENT_DYN_STAT(http_server_session_pool_overflow_stat);
+    }
   } else {
     Debug("http_ss", "[%" PRId64 "] [release session] could not release session due to lock contention", to_release->con_id);
     released_p = false;
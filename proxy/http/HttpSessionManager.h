@@ -134,10 +134,86 @@ public:
   /// Close all sessions and then clear the table.
   void purge();
 
+  /** Number of idle sessions in the pool.
+
+      This is read without the pool lock and so is only a hint, used to skip pools that
+      cannot satisfy a request without locking them.
+  */
+  int
+  idleCount() const
+  {
+    return m_idle_count;
+  }
+
   // Pools of server sessions.
   // Note that each server session is stored in both pools.
   IPHashTable m_ip_pool;
   HostHashTable m_host_pool;
+
+  /// Index of the owning thread among the threads with session pools, -1 for the global pool.
+  int m_thread_index;
+
+protected:
+  volatile int m_idle_count;
+};
+
+/** Per origin server session re-use counters.
+
+    Counts, for each origin address, how many transactions re-used a shared server session and how
+    many found no session to re-use and had to open a new connection. Each thread with a session
+    pool counts into its own fixed size table, which only that thread writes, so recording takes no
+    lock; the tables are merged when they are read. A table keeps the origins the thread used most
+    recently: an origin that needs a slot takes the least recently used of the slots it may probe,
+    dropping the counts of the origin that was there.
+*/
+class OriginSessionStats
+{
+public:
+  struct Counts {
+    int64_t reused;
+    int64_t missed;
+
+    Counts() : reused(0), missed(0) {}
+  };
+
+  struct Entry {
+    IpEndpoint addr;
+    Counts counts;
+  };
+
+  OriginSessionStats();
+
+  /// Create the counter table of the thread whose session pool has index @a thread_index.
+  void init_thread(int thread_index);
+
+  /// Count a re-used session (@a reused_p true) or a pool miss for the origin @a addr on @a ethread.
+  void record(EThread *ethread, sockaddr const *addr, bool reused_p);
+
+  /// Merge the counters of every thread into @a entries, one per origin.
+  void snapshot(Vec<Entry> &entries);
+
+private:
+  typedef HashMap<ConnectionCount::ConnAddr, ConnectionCount::ConnAddrHashFns, Counts> CountMap;
+
+  enum {
+    SLOTS = 512, ///< Origins tracked per thread.
+    PROBES = 8,  ///< Slots an origin may occupy, starting at its hash.
+  };
+
+  struct Slot {
+    IpEndpoint addr;
+    volatile int64_t reused;
+    volatile int64_t missed;
+    ink_hrtime last_used; ///< 0 if the slot is empty.
+    /// Odd while the owning thread gives the slot to another origin, so readers can retry.
+    volatile int version;
+  };
+
+  struct Table {
+    Slot slots[SLOTS];
+  };
+
+  Table *volatile m_tables[MAX_EVENT_THREADS];
 };
 
 enum HSMresult_t {
@@ -149,7 +225,7 @@ enum HSMresult_t {
 class HttpSessionManager
 {
 public:
-  HttpSessionManager() : m_g_pool(NULL) {}
+  HttpSessionManager() : m_g_pool(NULL), m_thread_pool_max(0) {}
 
   ~HttpSessionManager() {}
 
@@ -160,10 +236,22 @@ public:
   void init();
   int main_handler(int event, void *data);
 
+  OriginSessionStats &
+  origin_stats()
+  {
+    return m_origin_stats;
+  }
+
 private:
-  /// Global pool, used if not per thread pools.
+  HttpServerSession *acquire_hybrid(EThread *ethread, sockaddr const *addr, INK_MD5 const &hostname_hash,
+                                    TSServerSessionSharingMatchType match_style);
+
+  /// Global pool, used if not per thread pools and as the overflow of hybrid pools.
   /// @internal We delay creating this because the session manager is created during global statics init.
   ServerSessionPool *m_g_pool;
+  /// Idle sessions a thread pool holds in hybrid mode before releases overflow to the global pool.
+  int m_thread_pool_max;
+  OriginSessionStats m_origin_stats;
 };
 
 extern HttpSessionManager httpSessionManager;
@@ -2390,6 +2390,15 @@ HttpTransact::HandleCacheOpenReadHitFreshness(State *s)
   if (s->cache_lookup_result == HttpTransact::CACHE_LOOKUP_HIT_STALE)
     SET_VIA_STRING(VIA_DETAIL_CACHE_LOOKUP, VIA_DETAIL_MISS_EXPIRED);
 
+  // Within the object's stale-while-revalidate window the stale copy may
+  // be served while a background transaction brings it up to date. The
+  // background transaction is only started by HandleCacheOpenReadHit(),
+  // once the cache lookup hooks have had their say.
+  if (s->cache_lookup_result == HttpTransact::CACHE_LOOKUP_HIT_STALE && can_serve_stale_while_revalidate(s)) {
+    DebugTxn("http_trans", "[HandleCacheOpenReadHitFreshness] stale hit may be served while revalidating");
+    s->serving_stale_while_revalidate = true;
+  }
+
   if (!s->force_dns) { // If DNS is not performed before
     if (need_to_revalidate(s)) {
       TRANSACT_RETURN(SM_ACTION_API_CACHE_LOOKUP_COMPLETE,
@@ -2472,7 +2481,7 @@ HttpTransact::need_to_revalidate(State *s)
   ink_assert(s->cache_lookup_result == CACHE_LOOKUP_HIT_FRESH || s->cache_lookup_result == CACHE_LOOKUP_HIT_WARNING ||
              s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE);
   if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE &&
-      s->api_update_cached_object != HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE) {
+      s->api_update_cached_object != HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE && !s->serving_stale_while_revalidate) {
     needs_revalidate = true;
   } else
     needs_revalidate = false;
@@ -2566,12 +2575,6 @@ HttpTransact::HandleCacheOpenReadHit(State *s)
 
   ink_assert(s->cache_lookup_result == CACHE_LOOKUP_HIT_FRESH || s->cache_lookup_result == CACHE_LOOKUP_HIT_WARNING ||
              s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE);
-  if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE &&
-      s->api_update_cached_object != HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE) {
-    needs_revalidate = true;
-    SET_VIA_STRING(VIA_DETAIL_CACHE_LOOKUP, VIA_DETAIL_MISS_EXPIRED);
-  } else
-    needs_revalidate = false;
 
   // the response may not be directly returnable to the client. there
   // are several reasons for this: config may force revalidation or
@@ -2589,6 +2592,24 @@ HttpTransact::HandleCacheOpenReadHit(State *s)
   // if the origin server still has to be looked up.
   bool response_returnable = is_cache_response_returnable(s);
 
+  // serve a stale hit while revalidating it only if it is still a stale
+  // hit after the cache lookup hooks, nothing else sends us to the origin,
+  // and the background revalidation is under way. Otherwise revalidate in
+  // the foreground.
+  if (s->serving_stale_while_revalidate) {
+    if (s->cache_lookup_result != CACHE_LOOKUP_HIT_STALE || needs_authenticate || needs_cache_auth || !response_returnable ||
+        !s->state_machine->do_background_revalidate()) {
+      s->serving_stale_while_revalidate = false;
+    }
+  }
+
+  if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE &&
+      s->api_update_cached_object != HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE && !s->serving_stale_while_revalidate) {
+    needs_revalidate = true;
+    SET_VIA_STRING(VIA_DETAIL_CACHE_LOOKUP, VIA_DETAIL_MISS_EXPIRED);
+  } else
+    needs_revalidate = false;
+
   // do we need to revalidate. in other words if the response
   // has to be authorized, is stale or can not be returned, do
   // a revalidate.
@@ -2732,6 +2753,9 @@ HttpTransact::HandleCacheOpenReadHit(State *s)
 
   if (s->cache_lookup_result == CACHE_LOOKUP_HIT_WARNING) {
     build_response_from_cache(s, HTTP_WARNING_CODE_HERUISTIC_EXPIRATION);
+  } else if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE && s->serving_stale_while_revalidate) {
+    HTTP_INCREMENT_TRANS_STAT(http_cache_hit_stale_while_revalidate_stat);
+    build_response_from_cache(s, HTTP_WARNING_CODE_RESPONSE_STALE);
   } else if (s->cache_lookup_result == CACHE_LOOKUP_HIT_STALE) {
     ink_assert(server_up == false);
     build_response_from_cache(s, HTTP_WARNING_CODE_REVALIDATION_FAILED);
@@ -4311,6 +4335,20 @@ HttpTransact::handle_cache_operation_on_forward_server_response(State *s)
       return;
     }
 
+    /* if the cached object carries stale-if-error (RFC 5861) and is still
+       within it, answer a 5xx received while revalidating with the stale
+       copy. The object stays stale so the next request tries the origin again.
+     */
+    if ((server_response_code == HTTP_STATUS_INTERNAL_SERVER_ERROR || server_response_code == HTTP_STATUS_GATEWAY_TIMEOUT ||
+         server_response_code == HTTP_STATUS_BAD_GATEWAY || server_response_code == HTTP_STATUS_SERVICE_UNAVAILABLE) &&
+        s->cache_info.action == CACHE_DO_UPDATE && is_stale_if_error_permitted(s) && is_stale_cache_response_returnable(s)) {
+      DebugTxn("http_trans", "[hcoofsr] stale-if-error: serve stale object from cache");
+
+      SET_VIA_STRING(VIA_SERVER_RESULT, VIA_SERVER_ERROR);
+      build_response_from_cache(s, HTTP_WARNING_CODE_REVALIDATION_FAILED);
+      return;
+    }
+
     s->next_action = SM_ACTION_SERVER_READ;
     client_response_code = server_response_code;
     base_response = &s->hdr_info.server_response;
@@ -5846,8 +5884,9 @@ HttpTransact::is_stale_cache_response_returnable(State *s)
   time_t current_age = HttpTransactHeaders::calculate_document_age(s->cache_info.object_read->request_sent_time_get(),
                                                                    s->cache_info.object_read->response_received_time_get(),
                                                                    cached_response, cached_response->get_date(), s->current.now);
-  // Negative age is overflow
-  if ((current_age < 0) || (current_age > s->txn_conf->cache_max_stale_age)) {
+  // Negative age is overflow. The object's own stale-if-error may
+  //   extend the configured limit
+  if ((current_age < 0) || (current_age > s->txn_conf->cache_max_stale_age && !is_stale_if_error_permitted(s))) {
     DebugTxn("http_trans", "[is_stale_cache_response_returnable] "
                            "document age is too large %" PRId64,
              (int64_t)current_age);
@@ -5866,6 +5905,130 @@ HttpTransact::is_stale_cache_response_returnable(State *s)
   return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Name       : can_serve_stale_while_revalidate()
+// Description: check if a stale hit may be served while it is revalidated
+//              in the background (RFC 5861 stale-while-revalidate)
+//
+// Input      : State
+// Output     : true or false
+//
+// Details    :
+//
+// Only client GET and HEAD requests that place no freshness requirements
+// of their own qualify, and only while the object is no more stale than
+// the stale-while-revalidate delta it was cached with.
+//
+///////////////////////////////////////////////////////////////////////////////
+bool
+HttpTransact::can_serve_stale_while_revalidate(State *s)
+{
+  HTTPHdr *cached_response = s->cache_info.object_read->response_get();
+
+  if (!s->http_config_param->cache_stale_while_revalidate || s->state_machine->ua_session == NULL ||
+      s->redirect_info.redirect_in_process || s->api_update_cached_object == HttpTransact::UPDATE_CACHED_OBJECT_CONTINUE) {
+    return false;
+  }
+  if (s->method != HTTP_WKSIDX_GET && s->method != HTTP_WKSIDX_HEAD) {
+    return false;
+  }
+  if (s->hdr_info.client_request.get_cooked_cc_mask() & (MIME_COOKED_MASK_CC_MAX_AGE | MIME_COOKED_MASK_CC_MIN_FRESH)) {
+    return false;
+  }
+
+  int window = cached_cc_extension_value(cached_response, "stale-while-revalidate", sizeof("stale-while-revalidate") - 1);
+  if (window <= 0) {
+    return false;
+  }
+
+  int staleness = cached_document_staleness(s, cached_response);
+  if (staleness > window) {
+    DebugTxn("http_trans", "[can_serve_stale_while_revalidate] stale for %d seconds, window is %d", staleness, window);
+    return false;
+  }
+
+  return is_cache_response_returnable(s) && is_stale_cache_response_returnable(s);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Name       : is_stale_if_error_permitted()
+// Description: check if the cached object may be served stale in place of
+//              an origin error (RFC 5861 stale-if-error)
+//
+///////////////////////////////////////////////////////////////////////////////
+bool
+HttpTransact::is_stale_if_error_permitted(State *s)
+{
+  if (!s->http_config_param->cache_stale_if_error) {
+    return false;
+  }
+
+  HTTPHdr *cached_response = s->cache_info.object_read->response_get();
+  int window = cached_cc_extension_value(cached_response, "stale-if-error", sizeof("stale-if-error") - 1);
+
+  return window > 0 && cached_document_staleness(s, cached_response) <= window;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Name       : cached_cc_extension_value()
+// Description: find a "name=delta-seconds" Cache-Control extension
+//
+// Output     : the delta, or -1 if the directive is absent
+//
+///////////////////////////////////////////////////////////////////////////////
+int
+HttpTransact::cached_cc_extension_value(HTTPHdr *cached_response, const char *name, int name_len)
+{
+  MIMEField *field = cached_response->field_find(MIME_FIELD_CACHE_CONTROL, MIME_LEN_CACHE_CONTROL);
+
+  if (field == NULL) {
+    return -1;
+  }
+
+  HdrCsvIter csv;
+  int len;
+
+  for (const char *value = csv.get_first(field, &len); value; value = csv.get_next(&len)) {
+    if (len > name_len + 1 && value[name_len] == '=' && strncasecmp(value, name, name_len) == 0) {
+      const char *delta = value + name_len + 1;
+      int delta_len = len - name_len - 1;
+
+      if (*delta == '"') {
+        ++delta;
+        --delta_len;
+      }
+      return ParseRules::is_digit(*delta) ? ink_atoi(delta, delta_len) : -1;
+    }
+  }
+
+  return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Name       : cached_document_staleness()
+// Description: number of seconds the cached object is past its freshness
+//              lifetime, 0 if it is not
+//
+///////////////////////////////////////////////////////////////////////////////
+int
+HttpTransact::cached_document_staleness(State *s, HTTPHdr *cached_response)
+{
+  bool heuristic;
+  time_t response_date = cached_response->get_date();
+  int fresh_limit = calculate_document_freshness_limit(s, cached_response, response_date, &heuristic);
+  ink_time_t current_age = HttpTransactHeaders::calculate_document_age(s->cache_info.object_read->request_sent_time_get(),
+                                                                       s->cache_info.object_read->response_received_time_get(),
+                                                                       cached_response, response_date, s->current.now);
+
+  // Negative age is overflow
+  if (current_age < 0) {
+    return NUM_SECONDS_IN_ONE_YEAR;
+  }
+  current_age = min((ink_time_t)NUM_SECONDS_IN_ONE_YEAR, current_age);
+
+  return max(0, (int)(current_age - fresh_limit));
+}
+
 
 bool
 HttpTransact::url_looks_dynamic(URL *url)
@@ -963,6 +963,9 @@ public:
     bool transparent_passthrough;
     bool range_in_cache;
 
+    // Serving a stale hit while a background revalidation refreshes it (RFC 5861)
+    bool serving_stale_while_revalidate;
+
     // Methods
     void
     init()
@@ -999,7 +1002,7 @@ public:
         congestion_congested_or_failed(0), congestion_connection_opened(0), reverse_proxy(false), url_remap_success(false),
         remap_redirect(NULL), filter_mask(0), already_downgraded(false), pristine_url(), api_skip_all_remapping(false),
         range_setup(RANGE_NONE), num_range_fields(0), range_output_cl(0), ranges(NULL), txn_conf(NULL),
-        transparent_passthrough(false), range_in_cache(false)
+        transparent_passthrough(false), range_in_cache(false), serving_stale_while_revalidate(false)
     {
       int i;
       char *via_ptr = via_string;
@@ -1208,6 +1211,10 @@ public:
   static bool is_cache_response_returnable(State *s);
   static bool is_stale_cache_response_returnable(State *s);
   static bool need_to_revalidate(State *s);
+  static bool can_serve_stale_while_revalidate(State *s);
+  static bool is_stale_if_error_permitted(State *s);
+  static int cached_cc_extension_value(HTTPHdr *cached_response, const char *name, int name_len);
+  static int cached_document_staleness(State *s, HTTPHdr *cached_response);
   static bool url_looks_dynamic(URL *url);
   static bool is_request_cache_lookupable(State *s);
   static bool is_request_valid(State *s, HTTPHdr *incoming_request);
@@ -29,6 +29,7 @@
 #include "time.h"
 #include "HTTP.h"
 #include "HttpCompat.h"
+#include "HdrUtils.h"
 #include "Error.h"
 #include "InkErrno.h"
 
@@ -200,6 +201,18 @@ HttpTransactCache::SelectFromAlternates(CacheHTTPInfoVector *cache_vector, HTTPH
     return 0;
   }
 
+  // The Vary digests stored with the vector let us discard alternates
+  // whose selecting headers cannot match before doing any Accept
+  // scoring. That is only equivalent to the full check when nothing can
+  // override variability: PURGE matches anything and a SELECT_ALT plugin
+  // may force an alternate.
+  bool vary_prefilter =
+    client_request->method_get_wksidx() != HTTP_WKSIDX_PURGE && http_global_hooks->get(TS_HTTP_SELECT_ALT_HOOK) == NULL;
+  unsigned vary_ignore = (http_config_params->cache_global_user_agent_header ? VaryDigest::USER_AGENT : 0) |
+                         (http_config_params->ignore_accept_encoding_mismatch ? VaryDigest::ACCEPT_ENCODING : 0);
+  VaryDigest client_vary[4]; // client digests, memoized per distinct Vary list
+  int n_client_vary = 0;
+
   for (int i = 0; i < alt_count; i++) {
     float Q;
     CacheHTTPInfo *obj = cache_vector->get(i);
@@ -210,6 +223,26 @@ HttpTransactCache::SelectFromAlternates(CacheHTTPInfoVector *cache_vector, HTTPH
       ink_assert(cached_request->valid());
       ink_assert(cached_response->valid());
 
+      VaryDigest *obj_vary = vary_prefilter ? cache_vector->vary_digest_get(i) : NULL;
+      if (obj_vary && !(obj_vary->flags & vary_ignore)) {
+        VaryDigest *cv = NULL;
+        for (int j = 0; j < n_client_vary && !cv; j++) {
+          if (client_vary[j].names == obj_vary->names)
+            cv = &client_vary[j];
+        }
+        if (!cv && n_client_vary < (int)countof(client_vary)) {
+          cv = &client_vary[n_client_vary];
+          if (CalcVaryDigest(cached_response, client_request, cv) && cv->names == obj_vary->names)
+            n_client_vary++;
+          else
+            cv = NULL;
+        }
+        if (cv && cv->values != obj_vary->values) {
+          Debug("http_match", "[SelectFromAlternates] alternate #%d skipped, Vary digest mismatch", i);
+          continue;
+        }
+      }
+
       Q = calculate_quality_of_match(http_config_params, client_request, cached_request, cached_response);
 
       if (alt_count > 1) {
@@ -1257,6 +1290,77 @@ HttpTransactCache::CalcVariability(CacheLookupHttpConfig *http_config_params, HT
   return variability;
 }
 
+/**
+  Compute the Vary digest of @a request for the fields named in the
+  explicit Vary header of @a obj_origin_server_response. Values are
+  hashed the way do_header_values_rfc2068_14_43_match compares them:
+  element count, then each element's length and its case folded bytes
+  up to the first end-of-word character.
+
+  @return false (and an invalid digest) if the response has no usable
+  Vary header or varies on '*'.
+
+*/
+bool
+HttpTransactCache::CalcVaryDigest(HTTPHdr *obj_origin_server_response, HTTPHdr *request, VaryDigest *digest)
+{
+  StrList vary_list;
+  ATSHash32FNV1a names, values;
+  static const uint8_t absent = 0, present = 1;
+
+  digest->flags = 0;
+  if (!obj_origin_server_response->presence(MIME_PRESENCE_VARY) ||
+      obj_origin_server_response->value_get_comma_list(MIME_FIELD_VARY, MIME_LEN_VARY, &vary_list) <= 0)
+    return false;
+
+  for (Str *field = vary_list.head; field != NULL; field = field->next) {
+    if (field->len == 0)
+      continue;
+    if ((field->str[0] == '*') && (field->str[1] == NUL))
+      return false;
+
+    if (!strcasecmp((char *)field->str, "User-Agent"))
+      digest->flags |= VaryDigest::USER_AGENT;
+    else if (!strcasecmp((char *)field->str, "Accept-Encoding"))
+      digest->flags |= VaryDigest::ACCEPT_ENCODING;
+
+    names.update(field->str, field->len + 1, ATSHash::nocase());
+
+    char *field_name_str = (char *)hdrtoken_string_to_wks(field->str, field->len);
+    if (field_name_str == NULL)
+      field_name_str = (char *)field->str;
+
+    MIMEField *hdr_field = request->field_find(field_name_str, field->len);
+    if (!hdr_field) {
+      values.update(&absent, sizeof(absent));
+      continue;
+    }
+
+    HdrCsvIter iter;
+    int count = iter.count_values(hdr_field);
+    values.update(&present, sizeof(present));
+    values.update(&count, sizeof(count));
+
+    int val_len;
+    const char *val = iter.get_first(hdr_field, &val_len);
+    while (val) {
+      int eow_len = 0;
+      while (eow_len < val_len && !ParseRules::is_eow(val[eow_len]))
+        ++eow_len;
+      values.update(&val_len, sizeof(val_len));
+      values.update(val, eow_len, ATSHash::nocase());
+      val = iter.get_next(&val_len);
+    }
+  }
+
+  names.final();
+  values.final();
+  digest->names = names.get();
+  digest->values = values.get();
+  digest->flags |= VaryDigest::VALID;
+  return true;
+}
+
 /**
   If the request has If-modified-since or If-none-match,
   HTTP_STATUS_NOT_MODIFIED is returned if both or the existing one
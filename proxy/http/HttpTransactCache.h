@@ -84,6 +84,25 @@ enum Variability_t {
   VARIABILITY_ALL,
 };
 
+/**
+  Digest of the request header values selected by a response's Vary
+  header. @a names covers the Vary field list and @a values the request
+  values of those fields, hashed so that two requests whose values match
+  under RFC 2068 14.43 always hash equal. A digest mismatch therefore
+  proves CalcVariability would fail, while a match proves nothing.
+*/
+struct VaryDigest {
+  enum {
+    VALID = 1,
+    USER_AGENT = 2,      // Vary list names User-Agent
+    ACCEPT_ENCODING = 4, // Vary list names Accept-Encoding
+  };
+
+  uint32_t names;
+  uint32_t values;
+  uint32_t flags;
+};
+
 enum ContentEncoding {
   NO_GZIP = 0,
   GZIP,
@@ -125,6 +144,8 @@ public:
                                        HTTPHdr *obj_origin_server_response                                 // in
                                        );
 
+  static bool CalcVaryDigest(HTTPHdr *obj_origin_server_response, HTTPHdr *request, VaryDigest *digest);
+
   static HTTPStatus match_response_to_request_conditionals(HTTPHdr *ua_request, HTTPHdr *c_response);
 };
 
@@ -34,10 +34,15 @@
 #include "HttpConfig.h"
 #include "HttpTunnel.h"
 #include "HttpSM.h"
+#include "HttpServerSession.h"
 #include "HttpDebugNames.h"
 #include "ParseRules.h"
 
 static const int min_block_transfer_bytes = 256;
+// Chunk bodies shorter than min_block_transfer_bytes are still referenced
+// rather than copied while the dechunked buffer holds fewer blocks than
+// this, which keeps the chain short enough to release recursively.
+static const int max_dechunked_block_count = 64;
 static char const *const CHUNK_HEADER_FMT = "%" PRIx64 "\r\n";
 // This should be as small as possible because it will only hold the
 // header and trailer per chunk - the chunk body will be a reference to
@@ -146,62 +151,104 @@ ChunkedHandler::set_max_chunk_size(int64_t size)
   max_chunk_header_len = snprintf(max_chunk_header, sizeof(max_chunk_header), CHUNK_HEADER_FMT, max_chunk_size);
 }
 
+// Value of the hex digit @a c, or -1 if it is not one.
+static inline int
+chunk_hex_value(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c |= 0x20; // fold to lower case
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// Chunk sizes with more hex digits than this are rejected rather than overflowing.
+static int const CHUNK_SIZE_MAX_DIGITS = 15;
+
+// First LF in [s, e), or NULL. This uses the SSE2/AVX2 scanner selected by
+//   mime_init(), which also stops at NUL bytes, so those are stepped over.
+static inline const char *
+chunk_scan_lf(const char *s, const char *e)
+{
+  while ((s = mime_scan_lf_or_nul(s, e)) < e) {
+    if (ParseRules::is_lf(*s)) {
+      return s;
+    }
+    ++s;
+  }
+  return NULL;
+}
+
+//   Parse the size line of the next chunk. Whole runs of the block are
+//   handled at a time: the size digits are accumulated in a tight loop and
+//   the rest of the line (chunk extensions, CR) and the CRLF that ends the
+//   previous chunk are skipped with chunk_scan_lf() rather than byte by byte.
 void
 ChunkedHandler::read_size()
 {
-  int64_t bytes_used;
   bool done = false;
 
   while (chunked_reader->read_avail() > 0 && !done) {
-    const char *tmp = chunked_reader->start();
-    int64_t data_size = chunked_reader->block_read_avail();
+    const char *start = chunked_reader->start();
+    const char *end = start + chunked_reader->block_read_avail();
+    const char *tmp = start;
 
-    ink_assert(data_size > 0);
-    bytes_used = 0;
+    ink_assert(end > start);
 
-    while (data_size > 0) {
-      bytes_used++;
+    while (tmp < end && !done) {
       if (state == CHUNK_READ_SIZE) {
         // The http spec says the chunked size is always in hex
-        if (ParseRules::is_hex(*tmp)) {
-          num_digits++;
-          running_sum *= 16;
-
-          if (ParseRules::is_digit(*tmp)) {
-            running_sum += *tmp - '0';
-          } else {
-            running_sum += ParseRules::ink_tolower(*tmp) - 'a' + 10;
-          }
-        } else {
-          // We are done parsing size
-          if (num_digits == 0 || running_sum < 0) {
-            // Bogus chunk size
-            state = CHUNK_READ_ERROR;
-            done = true;
+        int v;
+        while (tmp < end && (v = chunk_hex_value(*tmp)) >= 0) {
+          if (++num_digits > CHUNK_SIZE_MAX_DIGITS) {
             break;
-          } else {
-            state = CHUNK_READ_SIZE_CRLF; // now look for CRLF
           }
+          running_sum = running_sum * 16 + v;
+          ++tmp;
+        }
+        if (tmp == end) {
+          break; // the size continues in the next block
+        }
+        // We are done parsing size
+        if (num_digits == 0 || num_digits > CHUNK_SIZE_MAX_DIGITS) {
+          // Bogus chunk size
+          state = CHUNK_READ_ERROR;
+          done = true;
+        } else if (ParseRules::is_lf(*tmp)) {
+          state = CHUNK_READ_SIZE_CRLF; // a bare LF ends the line
+        } else {
+          state = CHUNK_READ_SIZE_CRLF; // now look for CRLF
+          ++tmp;
         }
       } else if (state == CHUNK_READ_SIZE_CRLF) { // Scan for a linefeed
-        if (ParseRules::is_lf(*tmp)) {
-          Debug("http_chunk", "read chunk size of %d bytes", running_sum);
+        const char *lf = chunk_scan_lf(tmp, end);
+        if (lf == NULL) {
+          tmp = end;
+        } else {
+          tmp = lf + 1;
+          Debug("http_chunk", "read chunk size of %" PRId64 " bytes", running_sum);
           bytes_left = (cur_chunk_size = running_sum);
           state = (running_sum == 0) ? CHUNK_READ_TRAILER_BLANK : CHUNK_READ_CHUNK;
           done = true;
-          break;
         }
-      } else if (state == CHUNK_READ_SIZE_START) {
-        if (ParseRules::is_lf(*tmp)) {
+      } else if (state == CHUNK_READ_SIZE_START) { // Skip the CRLF after the chunk data
+        const char *lf = chunk_scan_lf(tmp, end);
+        if (lf == NULL) {
+          tmp = end;
+        } else {
+          tmp = lf + 1;
           running_sum = 0;
           num_digits = 0;
           state = CHUNK_READ_SIZE;
         }
+      } else {
+        ink_release_assert(!"Unexpected chunk size state");
       }
-      tmp++;
-      data_size--;
     }
-    chunked_reader->consume(bytes_used);
+    chunked_reader->consume(tmp - start);
   }
 }
 
@@ -209,7 +256,8 @@ ChunkedHandler::read_size()
 //
 //   Transfer bytes from chunked_reader to dechunked buffer
 //   Use block reference method when there is a sufficient
-//   size to move.  Otherwise, uses memcpy method
+//   size to move, or while the dechunked buffer has few
+//   enough blocks.  Otherwise, uses memcpy method
 //
 int64_t
 ChunkedHandler::transfer_bytes()
@@ -233,6 +281,10 @@ ChunkedHandler::transfer_bytes()
 
     if (to_move >= min_block_transfer_bytes) {
       moved = dechunked_buffer->write(chunked_reader, bytes_left);
+    } else if (dechunked_buffer->max_block_count() < max_dechunked_block_count) {
+      // Small amount of data available, but the chain is short
+      // so reference just this slice of the block
+      moved = dechunked_buffer->write(chunked_reader, to_move);
     } else {
       // Small amount of data available.  We want to copy the
       // data rather than block reference to prevent the buildup
@@ -279,6 +331,18 @@ ChunkedHandler::read_trailer()
 
     ink_assert(data_size > 0);
     for (bytes_used = 0; data_size > 0; data_size--) {
+      if (state == CHUNK_READ_TRAILER_LINE) {
+        // Nothing but the LF matters until the end of a
+        //   trailer line, so skip straight to it
+        const char *lf = chunk_scan_lf(tmp, tmp + data_size);
+        if (lf == NULL) {
+          bytes_used += data_size;
+          break;
+        }
+        bytes_used += lf - tmp;
+        data_size -= lf - tmp;
+        tmp = lf;
+      }
       bytes_used++;
 
       if (ParseRules::is_cr(*tmp)) {
@@ -339,11 +403,39 @@ ChunkedHandler::process_chunked_content()
   return (state == CHUNK_READ_DONE || state == CHUNK_READ_ERROR);
 }
 
+// Write the chunk header for @a size to @a buf, preceded by the CRLF that
+//   ends the previous chunk if @a crlf. Returns the length written.
+static inline int
+chunk_header(char *buf, int64_t size, bool crlf)
+{
+  static char const hex_digits[] = "0123456789abcdef";
+  char digits[16];
+  int n = 0;
+  int len = 0;
+
+  do {
+    digits[n++] = hex_digits[size & 0xf];
+    size >>= 4;
+  } while (size > 0);
+
+  if (crlf) {
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+  }
+  while (n > 0) {
+    buf[len++] = digits[--n];
+  }
+  buf[len++] = '\r';
+  buf[len++] = '\n';
+  return len;
+}
+
 bool
 ChunkedHandler::generate_chunked_content()
 {
-  char tmp[16];
+  char tmp[24];
   bool server_done = false;
+  bool crlf = false; // the CRLF ending the last chunk is still to be written
   int64_t r_avail;
 
   ink_assert(max_chunk_header_len);
@@ -358,19 +450,26 @@ ChunkedHandler::generate_chunked_content()
 
   while ((r_avail = dechunked_reader->read_avail()) > 0 && state != CHUNK_WRITE_DONE) {
     int64_t write_val = MIN(max_chunk_size, r_avail);
+    int len;
 
     state = CHUNK_WRITE_CHUNK;
     Debug("http_chunk", "creating a chunk of size %" PRId64 " bytes", write_val);
 
-    // Output the chunk size.
+    // Output the trailing CRLF of the previous chunk and the chunk size,
+    //   so that each chunk costs one small copy and one block reference.
     if (write_val != max_chunk_size) {
-      int len = snprintf(tmp, sizeof(tmp), CHUNK_HEADER_FMT, write_val);
-      chunked_buffer->write(tmp, len);
-      chunked_size += len;
+      len = chunk_header(tmp, write_val, crlf);
     } else {
-      chunked_buffer->write(max_chunk_header, max_chunk_header_len);
-      chunked_size += max_chunk_header_len;
+      len = 0;
+      if (crlf) {
+        tmp[len++] = '\r';
+        tmp[len++] = '\n';
+      }
+      memcpy(tmp + len, max_chunk_header, max_chunk_header_len);
+      len += max_chunk_header_len;
     }
+    chunked_buffer->write(tmp, len);
+    chunked_size += len;
 
     // Output the chunk itself.
     //
@@ -385,20 +484,28 @@ ChunkedHandler::generate_chunked_content()
     chunked_buffer->write(dechunked_reader, write_val);
     chunked_size += write_val;
     dechunked_reader->consume(write_val);
-
-    // Output the trailing CRLF.
-    chunked_buffer->write("\r\n", 2);
-    chunked_size += 2;
+    crlf = true;
   }
 
   if (server_done) {
     state = CHUNK_WRITE_DONE;
 
     // Add the chunked transfer coding trailer.
-    chunked_buffer->write("0\r\n\r\n", 5);
-    chunked_size += 5;
+    if (crlf) {
+      chunked_buffer->write("\r\n0\r\n\r\n", 7);
+      chunked_size += 7;
+    } else {
+      chunked_buffer->write("0\r\n\r\n", 5);
+      chunked_size += 5;
+    }
     return true;
   }
+
+  // Output the trailing CRLF.
+  if (crlf) {
+    chunked_buffer->write("\r\n", 2);
+    chunked_size += 2;
+  }
   return false;
 }
 
@@ -754,6 +861,41 @@ HttpTunnel::tunnel_run(HttpTunnelProducer *p_arg)
   }
 }
 
+static NetVConnection *
+tunnel_netvc(VConnection *vc, HttpTunnelType_t vc_type)
+{
+  if (vc_type == HT_HTTP_CLIENT)
+    return static_cast<HttpClientSession *>(vc)->get_netvc();
+  if (vc_type == HT_HTTP_SERVER)
+    return static_cast<HttpServerSession *>(vc)->get_netvc();
+  return NULL;
+}
+
+// void HttpTunnel::producer_splice(HttpTunnelProducer* p)
+//
+//   If the producer forwards bytes unchanged from one network
+//    connection to another, let the net layer move them from
+//    socket to socket without copying them through the buffer.
+//    Transforms, cache writes, chunking and POST buffering for
+//    redirects all need the bytes so they keep the buffered path.
+//    The net layer also refuses TLS and cross thread pairs.
+//
+void
+HttpTunnel::producer_splice(HttpTunnelProducer *p)
+{
+  HttpTunnelConsumer *c = p->consumer_list.head;
+
+  if (!sm->t_state.http_config_param->tunnel_splice || p->num_consumers != 1 || !c->alive || p->do_chunking ||
+      p->do_dechunking || p->do_chunked_passthru || (p->vc_type == HT_HTTP_CLIENT && sm->enable_redirection))
+    return;
+
+  NetVConnection *src = tunnel_netvc(p->vc, p->vc_type);
+  NetVConnection *dst = tunnel_netvc(c->vc, c->vc_type);
+
+  if (src && dst && src->set_splice_target(dst))
+    Debug("http_tunnel", "[%" PRId64 "] [producer_splice] %s spliced to %s", sm->sm_id, p->name, c->name);
+}
+
 void
 HttpTunnel::producer_run(HttpTunnelProducer *p)
 {
@@ -992,6 +1134,7 @@ HttpTunnel::producer_run(HttpTunnelProducer *p)
         p->read_vio = ((CacheVC *)p->vc)->do_io_pread(this, producer_n, p->read_buffer, read_start_pos);
       } else {
         p->read_vio = p->vc->do_io_read(this, producer_n, p->read_buffer);
+        producer_splice(p);
       }
     }
   }
@@ -1683,3 +1826,119 @@ HttpTunnel::deallocate_redirect_postdata_buffers()
     postbuf = NULL;
   }
 }
+
+#if TS_HAS_TESTS
+
+#include "ts/TestBox.h"
+
+// Dechunk @a input, all at once or a byte at a time, into @a body. Returns the final parser state.
+static ChunkedHandler::ChunkedState
+dechunk(const char *input, bool bytewise, char *body, int body_size, int64_t *chunk_size, int64_t *left_over)
+{
+  ChunkedHandler h;
+  MIOBuffer *in = new_MIOBuffer(BUFFER_SIZE_INDEX_4K);
+  IOBufferReader *in_reader = in->alloc_reader();
+  int len = strlen(input);
+
+  h.init_by_action(in_reader, ChunkedHandler::ACTION_DECHUNK);
+  h.state = ChunkedHandler::CHUNK_READ_SIZE;
+  IOBufferReader *out = h.dechunked_buffer->alloc_reader();
+
+  if (bytewise) {
+    for (int i = 0; i < len && !h.process_chunked_content(); i++) {
+      in->write(input + i, 1);
+    }
+    h.process_chunked_content();
+  } else {
+    in->write(input, len);
+    h.process_chunked_content();
+  }
+
+  int n = out->read(body, body_size - 1);
+  body[n] = '\0';
+  *chunk_size = h.cur_chunk_size;
+  *left_over = h.chunked_reader->read_avail();
+
+  ChunkedHandler::ChunkedState state = h.state;
+  h.clear();
+  free_MIOBuffer(in);
+  return state;
+}
+
+REGRESSION_TEST(ChunkedHandler_parse)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+  static const ChunkedHandler::ChunkedState DONE = ChunkedHandler::CHUNK_READ_DONE;
+  static const ChunkedHandler::ChunkedState ERROR = ChunkedHandler::CHUNK_READ_ERROR;
+  static const ChunkedHandler::ChunkedState CHUNK = ChunkedHandler::CHUNK_READ_CHUNK;
+  static const struct {
+    const char *input;
+    ChunkedHandler::ChunkedState state;
+    const char *body;
+    int64_t left_over; // bytes past the end of the chunked body
+  } cases[] = {
+    {"5\r\nhello\r\n0\r\n\r\n", DONE, "hello", 0},
+    {"5\r\nhello\r\n0\r\n\r\nHTTP/1.1", DONE, "hello", 8},
+    {"A\r\n0123456789\r\na\r\nabcdefghij\r\n0\r\n\r\n", DONE, "0123456789abcdefghij", 0},
+    // LF only line endings, on their own and mixed with CRLF
+    {"5\nhello\n6\n world\n0\n\n", DONE, "hello world", 0},
+    {"5\nhello\r\n6\r\n world\n0\r\n\n", DONE, "hello world", 0},
+    {"3\nabc\n0\nX-Trailer: yes\n\nNEXT", DONE, "abc", 4},
+    // chunk extensions are skipped, including on the last chunk
+    {"4;name=value\r\nwiki\r\n5;a=b;c=\"x y\"\r\npedia\r\n0;last\r\n\r\n", DONE, "wikipedia", 0},
+    {"4 ; spaced\r\nwiki\r\n5;lf-only\npedia\n0\r\n\r\n", DONE, "wikipedia", 0},
+    // trailers
+    {"3\r\nabc\r\n0\r\nX-Foo: bar\r\nX-Baz: q\r\n\r\nX", DONE, "abc", 1},
+    // up to 15 hex digits are accepted, 16 are an overflow
+    {"000000000000005\r\nhello\r\n0\r\n\r\n", DONE, "hello", 0},
+    {"0000000000000005\r\nhello\r\n0\r\n\r\n", ERROR, "", -1},
+    {"FFFFFFFFFFFFFFFF\r\n", ERROR, "", -1},
+    {"10000000000000000\r\n", ERROR, "", -1},
+    {"FFFFFFFFFFFFFFF\r\n", CHUNK, "", 0},
+    // no size at all
+    {"\r\nhello\r\n", ERROR, "", -1},
+    {";ext\r\nhello\r\n", ERROR, "", -1},
+    {"zz\r\n", ERROR, "", -1},
+  };
+
+  box = REGRESSION_TEST_PASSED;
+
+  for (unsigned i = 0; i < countof(cases); i++) {
+    for (int bytewise = 0; bytewise < 2; bytewise++) {
+      char body[256];
+      int64_t chunk_size, left_over;
+      ChunkedHandler::ChunkedState state = dechunk(cases[i].input, bytewise, body, sizeof(body), &chunk_size, &left_over);
+
+      box.check(state == cases[i].state, "case %u%s: state %d, expected %d", i, bytewise ? " bytewise" : "", state, cases[i].state);
+      box.check(strcmp(body, cases[i].body) == 0, "case %u%s: body '%s', expected '%s'", i, bytewise ? " bytewise" : "", body,
+                cases[i].body);
+      // a byte at a time, nothing is written past the end of the chunked body
+      if (cases[i].left_over >= 0) {
+        int64_t expect = bytewise ? 0 : cases[i].left_over;
+        box.check(left_over == expect, "case %u%s: %" PRId64 " bytes left over, expected %" PRId64, i, bytewise ? " bytewise" : "",
+                  left_over, expect);
+      }
+      if (state == CHUNK) {
+        box.check(chunk_size == 0xFFFFFFFFFFFFFFFLL, "case %u%s: chunk size %" PRIx64, i, bytewise ? " bytewise" : "", chunk_size);
+      }
+    }
+  }
+
+  // Enough small chunks to go from referencing them to copying them.
+  char input[1024], expect[256], body[256];
+  int len = 0, body_len = 0;
+  for (int i = 0; i < 2 * max_dechunked_block_count; i++) {
+    len += snprintf(input + len, sizeof(input) - len, "1\r\n%c\r\n", 'a' + i % 26);
+    expect[body_len++] = 'a' + i % 26;
+  }
+  snprintf(input + len, sizeof(input) - len, "0\r\n\r\n");
+  expect[body_len] = '\0';
+  for (int bytewise = 0; bytewise < 2; bytewise++) {
+    int64_t chunk_size, left_over;
+    ChunkedHandler::ChunkedState state = dechunk(input, bytewise, body, sizeof(body), &chunk_size, &left_over);
+    box.check(state == DONE && strcmp(body, expect) == 0, "small chunks%s: state %d, body '%s'", bytewise ? " bytewise" : "", state,
+              body);
+  }
+}
+
+#endif
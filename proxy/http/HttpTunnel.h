@@ -125,7 +125,7 @@ struct ChunkedHandler {
   int last_server_event;
 
   // Parsing Info
-  int running_sum;
+  int64_t running_sum;
   int num_digits;
 
   /// @name Output data.
@@ -366,6 +366,7 @@ private:
   void finish_all_internal(HttpTunnelProducer *p, bool chain);
   void update_stats_after_abort(HttpTunnelType_t t);
   void producer_run(HttpTunnelProducer *p);
+  void producer_splice(HttpTunnelProducer *p);
 
   HttpTunnelProducer *get_producer(VIO *vio);
   HttpTunnelConsumer *get_consumer(VIO *vio);
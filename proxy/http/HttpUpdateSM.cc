@@ -56,7 +56,7 @@ HttpUpdateSM::destroy()
 }
 
 Action *
-HttpUpdateSM::start_scheduled_update(Continuation *cont, HTTPHdr *request)
+HttpUpdateSM::start_scheduled_update(Continuation *cont, HTTPHdr *request, URL *lookup_url)
 {
   // Use passed continuation's mutex for this state machine
   this->mutex = cont->mutex;
@@ -72,6 +72,15 @@ HttpUpdateSM::start_scheduled_update(Continuation *cont, HTTPHdr *request)
   t_state.hdr_info.client_request.create(HTTP_TYPE_REQUEST);
   t_state.hdr_info.client_request.copy(request);
 
+  // A request handed over by another transaction has already been
+  //   remapped; skip remap and look up exactly the object it found
+  if (lookup_url) {
+    t_state.api_skip_all_remapping = true;
+    t_state.cache_info.lookup_url_storage.create(NULL);
+    t_state.cache_info.lookup_url_storage.copy(lookup_url);
+    t_state.cache_info.lookup_url = &t_state.cache_info.lookup_url_storage;
+  }
+
   // Fix ME: What should these be set to since there is not a
   //   real client
   ats_ip4_set(&t_state.client_info.addr, htonl(INADDR_LOOPBACK), 0);
@@ -152,8 +161,33 @@ HttpUpdateSM::handle_api_return()
     }
     break;
   }
+  case HttpTransact::SM_ACTION_SERVER_READ: {
+    if (t_state.cache_info.action == HttpTransact::CACHE_DO_WRITE || t_state.cache_info.action == HttpTransact::CACHE_DO_REPLACE) {
+      // The object changed on the origin, stream the new
+      //   copy straight into the cache
+      cache_sm.close_read();
+      t_state.cache_info.write_status = HttpTransact::CACHE_WRITE_IN_PROGRESS;
+      setup_server_transfer_to_cache_only();
+      tunnel.tunnel_run();
+
+      cb_event = HTTP_SCH_UPDATE_EVENT_WRITTEN;
+      t_state.squid_codes.log_code = SQUID_LOG_TCP_REFRESH_MISS;
+      return;
+    }
+    if (t_state.cache_info.action == HttpTransact::CACHE_DO_DELETE) {
+      // The new response can't be cached, so drop the stale copy
+      //   rather than leave it to be revalidated again
+      perform_cache_write_action();
+
+      cb_event = HTTP_SCH_UPDATE_EVENT_DELETED;
+      t_state.squid_codes.log_code = SQUID_LOG_TCP_MISS;
+      terminate_sm = true;
+      return;
+    }
+  }
+  // fallthrough
+
   case HttpTransact::SM_ACTION_INTERNAL_CACHE_WRITE:
-  case HttpTransact::SM_ACTION_SERVER_READ:
   case HttpTransact::SM_ACTION_INTERNAL_CACHE_NOOP:
   case HttpTransact::SM_ACTION_SEND_ERROR_CACHE_NOOP:
   case HttpTransact::SM_ACTION_SERVE_FROM_CACHE: {
@@ -223,3 +257,112 @@ HttpUpdateSM::kill_this_async_hook(int event, void * /* data ATS_UNUSED */)
 
   return HttpSM::kill_this_async_hook(EVENT_NONE, NULL);
 }
+
+/*-------------------------------------------------------------------------
+  Background revalidation
+
+  A client transaction that finds an object inside its stale-while-revalidate
+  window (RFC 5861) serves the stale copy and hands the request over to an
+  HttpUpdateSM, which revalidates or refetches the object into the cache.
+
+  The pending table holds the folded cache key of every revalidation in
+  flight so each object is revalidated only once. A key that lands on a slot
+  owned by a different object is refused; the caller then revalidates in the
+  foreground as it would without stale-while-revalidate.
+  -------------------------------------------------------------------------*/
+
+static const int BACKGROUND_REVALIDATE_SLOTS = 4096;
+static volatile uint64_t background_revalidate_pending[BACKGROUND_REVALIDATE_SLOTS];
+
+struct BackgroundRevalidateCont : public Continuation {
+  uint64_t key;
+  volatile uint64_t *slot;
+  HTTPHdr request;
+  URL lookup_url;
+
+  int
+  start_event(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    SET_HANDLER(&BackgroundRevalidateCont::done_event);
+    HTTP_INCREMENT_DYN_STAT(http_background_revalidations_stat);
+
+    HttpUpdateSM *sm = HttpUpdateSM::allocate();
+    sm->init();
+    // The update may complete, and free us, before this returns
+    sm->start_scheduled_update(this, &request, &lookup_url);
+    return EVENT_DONE;
+  }
+
+  int
+  done_event(int event, void * /* data ATS_UNUSED */)
+  {
+    Debug("http_sch", "background revalidation finished with %s", HttpDebugNames::get_event_name(event));
+    ink_atomic_cas(slot, key, (uint64_t)0);
+    delete this;
+    return EVENT_DONE;
+  }
+
+  BackgroundRevalidateCont(uint64_t k, volatile uint64_t *s, HTTPHdr *req, URL *url)
+    : Continuation(new_ProxyMutex()), key(k), slot(s)
+  {
+    request.create(HTTP_TYPE_REQUEST);
+    request.copy(req);
+    lookup_url.create(NULL);
+    lookup_url.copy(url);
+    HttpUpdateSM::background_revalidate_request(&request);
+
+    SET_HANDLER(&BackgroundRevalidateCont::start_event);
+  }
+
+  ~BackgroundRevalidateCont()
+  {
+    request.destroy();
+    lookup_url.destroy();
+  }
+};
+
+// Turn the client request @a req that found the object stale into the
+//   request that revalidates it. That is a plain GET of the object: a HEAD
+//   response can't refresh the cached body, so the object would only be
+//   deleted, and the client's range and conditions are its own.
+void
+HttpUpdateSM::background_revalidate_request(HTTPHdr *req)
+{
+  req->method_set(HTTP_METHOD_GET, HTTP_LEN_GET);
+  req->field_delete(MIME_FIELD_RANGE, MIME_LEN_RANGE);
+  req->field_delete(MIME_FIELD_IF_RANGE, MIME_LEN_IF_RANGE);
+  req->field_delete(MIME_FIELD_IF_MATCH, MIME_LEN_IF_MATCH);
+  req->field_delete(MIME_FIELD_IF_NONE_MATCH, MIME_LEN_IF_NONE_MATCH);
+  req->field_delete(MIME_FIELD_IF_MODIFIED_SINCE, MIME_LEN_IF_MODIFIED_SINCE);
+  req->field_delete(MIME_FIELD_IF_UNMODIFIED_SINCE, MIME_LEN_IF_UNMODIFIED_SINCE);
+}
+
+// Returns true if a revalidation of @a lookup_url is in flight once this
+//   returns, either one started here or one started earlier.
+bool
+HttpUpdateSM::start_background_revalidate(HTTPHdr *req, URL *lookup_url)
+{
+  CryptoHash hash;
+
+  lookup_url->hash_get(&hash);
+  uint64_t key = hash.fold();
+  if (key == 0) {
+    key = 1; // 0 marks a free slot
+  }
+
+  volatile uint64_t *slot = &background_revalidate_pending[key % BACKGROUND_REVALIDATE_SLOTS];
+  for (;;) {
+    uint64_t current = *slot;
+
+    if (current == key) {
+      return true;
+    } else if (current != 0) {
+      return false;
+    } else if (ink_atomic_cas(slot, (uint64_t)0, key)) {
+      break;
+    }
+  }
+
+  eventProcessor.schedule_imm(new BackgroundRevalidateCont(key, slot, req, lookup_url), ET_NET);
+  return true;
+}
@@ -54,7 +54,10 @@ public:
   static HttpUpdateSM *allocate();
   void destroy();
 
-  Action *start_scheduled_update(Continuation *cont, HTTPHdr *req);
+  Action *start_scheduled_update(Continuation *cont, HTTPHdr *req, URL *lookup_url = NULL);
+
+  static bool start_background_revalidate(HTTPHdr *req, URL *lookup_url);
+  static void background_revalidate_request(HTTPHdr *req);
 
   //  private:
   bool cb_occured;
@@ -24,6 +24,7 @@
 #include "Regression.h"
 #include "HttpTransact.h"
 #include "HttpSM.h"
+#include "HttpUpdateSM.h"
 
 void
 forceLinkRegressionHttpTransact()
@@ -136,3 +137,244 @@ REGRESSION_TEST(HttpTransact_handle_request)(RegressionTest * /* t */, int /* le
   // To be added..
   *pstatus = REGRESSION_TEST_PASSED;
 }
+
+static void
+parse_hdr(HTTPHdr *hdr, HTTPType type, const char *text)
+{
+  MIOBuffer *read_buffer = new_MIOBuffer(HTTP_HEADER_BUFFER_SIZE_INDEX);
+  IOBufferReader *buffer_reader = read_buffer->alloc_reader();
+  read_buffer->write(text, strlen(text));
+
+  HTTPParser httpParser;
+  http_parser_init(&httpParser);
+  int bytes_used = 0;
+  hdr->create(type, NULL);
+  if (type == HTTP_TYPE_REQUEST)
+    hdr->parse_req(&httpParser, buffer_reader, &bytes_used, true /* eos */);
+  else
+    hdr->parse_resp(&httpParser, buffer_reader, &bytes_used, true /* eos */);
+  http_parser_clear(&httpParser);
+  free_MIOBuffer(read_buffer);
+}
+
+REGRESSION_TEST(HttpTransactCache_CalcVaryDigest)(RegressionTest *t, int /* level */, int *pstatus)
+{
+  CacheLookupHttpConfig config;
+  HTTPHdr response, cached_request, client_request;
+  VaryDigest cached, client;
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  parse_hdr(&response, HTTP_TYPE_RESPONSE, "HTTP/1.1 200 OK\r\nVary: Accept-Language, X-Variant\r\n\r\n");
+  parse_hdr(&cached_request, HTTP_TYPE_REQUEST, "GET / HTTP/1.1\r\nHost: abc.com\r\nAccept-Language: en-US, fr\r\n\r\n");
+
+  if (!HttpTransactCache::CalcVaryDigest(&response, &cached_request, &cached)) {
+    rprintf(t, "HttpTransactCache::CalcVaryDigest - no digest for a response with Vary\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  const char *requests[] = {"GET / HTTP/1.1\r\nHost: abc.com\r\nAccept-Language: en-US, fr\r\n\r\n",
+                            "GET / HTTP/1.1\r\nHost: abc.com\r\naccept-language: en-us,   FR\r\n\r\n",
+                            "GET / HTTP/1.1\r\nHost: abc.com\r\nAccept-Language: en-US\r\nAccept-Language: fr\r\n\r\n",
+                            "GET / HTTP/1.1\r\nHost: abc.com\r\nAccept-Language: fr, en-US\r\n\r\n",
+                            "GET / HTTP/1.1\r\nHost: abc.com\r\nAccept-Language: en-US\r\n\r\n",
+                            "GET / HTTP/1.1\r\nHost: abc.com\r\n\r\n",
+                            "GET / HTTP/1.1\r\nHost: abc.com\r\nAccept-Language: en-US, fr\r\nX-Variant: a\r\n\r\n",
+                            NULL};
+
+  for (int i = 0; requests[i]; i++) {
+    parse_hdr(&client_request, HTTP_TYPE_REQUEST, requests[i]);
+    bool varies = HttpTransactCache::CalcVariability(&config, &client_request, &cached_request, &response) != VARIABILITY_NONE;
+    bool same = HttpTransactCache::CalcVaryDigest(&response, &client_request, &client) && client.names == cached.names &&
+                client.values == cached.values;
+
+    if (varies == same) {
+      rprintf(t, "HttpTransactCache::CalcVaryDigest - digest %s but variability %s for request = '%s'\n",
+              same ? "matches" : "differs", varies ? "found" : "not found", requests[i]);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+    client_request.destroy();
+  }
+
+  response.destroy();
+  cached_request.destroy();
+}
+
+REGRESSION_TEST(HttpTransact_stale_while_revalidate_window)(RegressionTest *t, int /* level */, int *pstatus)
+{
+  HTTPHdr response;
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  struct {
+    const char *resp;
+    int value;
+  } extensions[] = {
+    {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60, stale-while-revalidate=30\r\n\r\n", 30},
+    {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60, stale-while-revalidate=\"45\"\r\n\r\n", 45},
+    {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\n\r\n", -1},
+    {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60, stale-while-revalidate\r\n\r\n", -1},
+    {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60, stale-while-revalidate=abc\r\n\r\n", -1},
+    {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60, x-stale-while-revalidate=5\r\n\r\n", -1},
+    {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nCache-Control: Stale-While-Revalidate=10\r\n\r\n", 10},
+    {"HTTP/1.1 200 OK\r\n\r\n", -1},
+  };
+
+  for (unsigned i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+    parse_hdr(&response, HTTP_TYPE_RESPONSE, extensions[i].resp);
+    int value = HttpTransact::cached_cc_extension_value(&response, "stale-while-revalidate", 22);
+    if (value != extensions[i].value) {
+      rprintf(t, "HttpTransact::cached_cc_extension_value - expected %d, got %d for response = '%s'\n", extensions[i].value, value,
+              extensions[i].resp);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+    response.destroy();
+  }
+
+  // A response received (and dated) at t0 with max-age=60 is stale by
+  // however long it has been past t0 + 60.
+  const time_t t0 = 1000000000;
+  HttpSM sm;
+  HTTPHdr request;
+  HTTPInfo info;
+
+  init_sm(&sm);
+  parse_hdr(&request, HTTP_TYPE_REQUEST, "GET / HTTP/1.1\r\nHost: abc.com\r\n\r\n");
+  parse_hdr(&response, HTTP_TYPE_RESPONSE, "HTTP/1.1 200 OK\r\nCache-Control: max-age=60, stale-while-revalidate=30\r\n\r\n");
+  response.set_date(t0);
+
+  info.create();
+  info.request_set(&request);
+  info.response_set(&response);
+  info.request_sent_time_set(t0);
+  info.response_received_time_set(t0);
+  sm.t_state.cache_info.object_read = &info;
+
+  struct {
+    time_t now;
+    int staleness;
+  } ages[] = {{t0, 0}, {t0 + 30, 0}, {t0 + 60, 0}, {t0 + 75, 15}, {t0 + 90, 30}, {t0 + 100, 40}};
+
+  for (unsigned i = 0; i < sizeof(ages) / sizeof(ages[0]); i++) {
+    sm.t_state.current.now = ages[i].now;
+    int staleness = HttpTransact::cached_document_staleness(&sm.t_state, info.response_get());
+    if (staleness != ages[i].staleness) {
+      rprintf(t, "HttpTransact::cached_document_staleness - expected %d, got %d at t0 + %d\n", ages[i].staleness, staleness,
+              (int)(ages[i].now - t0));
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  sm.t_state.cache_info.object_read = NULL;
+  info.destroy();
+  request.destroy();
+  response.destroy();
+}
+
+REGRESSION_TEST(HttpUpdateSM_background_revalidate_request)(RegressionTest *t, int /* level */, int *pstatus)
+{
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  // Whatever the client asked that found the object stale, it is revalidated with a plain GET of the object.
+  const char *requests[] = {"HEAD /a HTTP/1.1\r\nHost: abc.com\r\nX-Keep: yes\r\n\r\n",
+                            "HEAD /a HTTP/1.1\r\nHost: abc.com\r\nX-Keep: yes\r\nRange: bytes=0-10\r\n"
+                            "If-None-Match: \"x\"\r\nIf-Modified-Since: Sat, 29 Oct 1994 19:43:31 GMT\r\n\r\n",
+                            "GET /a HTTP/1.1\r\nHost: abc.com\r\nX-Keep: yes\r\nIf-Range: \"x\"\r\nRange: bytes=5-\r\n"
+                            "If-Match: \"x\"\r\nIf-Unmodified-Since: Sat, 29 Oct 1994 19:43:31 GMT\r\n\r\n",
+                            NULL};
+  const char *dropped[] = {MIME_FIELD_RANGE,         MIME_FIELD_IF_RANGE,          MIME_FIELD_IF_MATCH,
+                           MIME_FIELD_IF_NONE_MATCH, MIME_FIELD_IF_MODIFIED_SINCE, MIME_FIELD_IF_UNMODIFIED_SINCE};
+
+  for (int i = 0; requests[i]; i++) {
+    HTTPHdr request;
+    int len;
+
+    parse_hdr(&request, HTTP_TYPE_REQUEST, requests[i]);
+    HttpUpdateSM::background_revalidate_request(&request);
+
+    if (request.method_get_wksidx() != HTTP_WKSIDX_GET) {
+      const char *method = request.method_get(&len);
+      rprintf(t, "HttpUpdateSM::background_revalidate_request - method is '%.*s' for request = '%s'\n", len, method, requests[i]);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+    for (unsigned f = 0; f < sizeof(dropped) / sizeof(dropped[0]); f++) {
+      if (request.field_find(dropped[f], strlen(dropped[f]))) {
+        rprintf(t, "HttpUpdateSM::background_revalidate_request - kept %s for request = '%s'\n", dropped[f], requests[i]);
+        *pstatus = REGRESSION_TEST_FAILED;
+      }
+    }
+    if (!request.field_find(MIME_FIELD_HOST, MIME_LEN_HOST) || !request.field_find("X-Keep", 6)) {
+      rprintf(t, "HttpUpdateSM::background_revalidate_request - dropped other fields for request = '%s'\n", requests[i]);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+    request.destroy();
+  }
+}
+
+REGRESSION_TEST(CacheHTTPInfoVector_VaryIndex)(RegressionTest *t, int /* level */, int *pstatus)
+{
+  // More alternates than a Vary index used to be allowed to carry.
+  const int nalts = 40;
+  CacheHTTPInfoVector vector, copy;
+  HTTPHdr request, response;
+  HTTPInfo infos[nalts];
+  char text[256];
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  parse_hdr(&response, HTTP_TYPE_RESPONSE, "HTTP/1.1 200 OK\r\nVary: Accept-Language\r\n\r\n");
+  for (int i = 0; i < nalts; i++) {
+    snprintf(text, sizeof(text), "GET / HTTP/1.1\r\nHost: abc.com\r\nAccept-Language: x-lang-%d\r\n\r\n", i);
+    parse_hdr(&request, HTTP_TYPE_REQUEST, text);
+    infos[i].create();
+    infos[i].request_set(&request);
+    infos[i].response_set(&response);
+    vector.insert(&infos[i]);
+    request.destroy();
+  }
+
+  int length = vector.marshal_length();
+  char *buf = (char *)ats_malloc(length);
+  int used = vector.marshal(buf, length);
+
+  if (used != length || CacheHTTPInfoVector::alternates_index_length(buf, length) == 0) {
+    rprintf(t, "CacheHTTPInfoVector - marshalled %d of %d bytes, index %d bytes\n", used, length,
+            CacheHTTPInfoVector::alternates_index_length(buf, length));
+    *pstatus = REGRESSION_TEST_FAILED;
+  } else if (copy.unmarshal(buf, length, true, NULL) != length || copy.count() != nalts) {
+    rprintf(t, "CacheHTTPInfoVector - unmarshalled %d of %d alternates\n", copy.count(), nalts);
+    *pstatus = REGRESSION_TEST_FAILED;
+  } else {
+    for (int i = 0; i < nalts; i++) {
+      VaryDigest *a = vector.vary_digest_get(i);
+      VaryDigest *b = copy.vary_digest_get(i);
+      if (!a || !b || a->names != b->names || a->values != b->values || (i && b->values == copy.vary_digest_get(0)->values)) {
+        rprintf(t, "CacheHTTPInfoVector - Vary digest of alternate %d was not carried by the index\n", i);
+        *pstatus = REGRESSION_TEST_FAILED;
+        break;
+      }
+    }
+  }
+
+  // The unmarshalled alternates point into buf, so let go of them first.
+  copy.clear(false);
+  ats_free(buf);
+
+  // Without the index flag every byte belongs to the alternates, whatever they end with.
+  length = vector.marshal_length(false);
+  buf = (char *)ats_malloc(length);
+  used = vector.marshal(buf, length, false);
+  if (used != length || CacheHTTPInfoVector::alternates_length(buf, length, false) != length) {
+    rprintf(t, "CacheHTTPInfoVector - marshalled %d of %d bytes without an index\n", used, length);
+    *pstatus = REGRESSION_TEST_FAILED;
+  } else if (copy.unmarshal(buf, length, false, NULL) != length || copy.count() != nalts || copy.vary_digest_get(0)) {
+    rprintf(t, "CacheHTTPInfoVector - unmarshalled %d of %d alternates without an index\n", copy.count(), nalts);
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  copy.clear(false);
+  ats_free(buf);
+  vector.clear(false);
+  for (int i = 0; i < nalts; i++) {
+    infos[i].destroy();
+  }
+  response.destroy();
+}
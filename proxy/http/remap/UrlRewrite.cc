@@ -584,6 +584,7 @@ UrlRewrite::_addToStore(MappingsStore &store, url_mapping *new_mapping, RegexMap
 
   new_mapping->setRank(count); // Use the mapping rules number count for rank
   if (is_cur_mapping_regex) {
+    reg_map->prefilter_idx = store.regex_prefilter.add(src_host);
     store.regex_list.enqueue(reg_map);
     retval = true;
   } else {
@@ -722,6 +723,13 @@ UrlRewrite::BuildTable(const char *path)
       return 3;
     }
   }
+  // Compile the literal prefilters for the regex mappings
+  forward_mappings.regex_prefilter.compile();
+  reverse_mappings.regex_prefilter.compile();
+  permanent_redirects.regex_prefilter.compile();
+  temporary_redirects.regex_prefilter.compile();
+  forward_mappings_with_recv_port.regex_prefilter.compile();
+
   // Destroy unused tables
   if (num_rules_forward == 0) {
     forward_mappings.hash_lookup = ink_hash_table_destroy(forward_mappings.hash_lookup);
@@ -816,8 +824,8 @@ UrlRewrite::_mappingLookup(MappingsStore &mappings, URL *request_url, int reques
     mapping_container.set(mapping);
     retval = true;
   }
-  if (_regexMappingLookup(mappings.regex_list, request_url, request_port, request_host_lower, request_host_len, rank_ceiling,
-                          mapping_container)) {
+  if (_regexMappingLookup(mappings.regex_list, mappings.regex_prefilter, request_url, request_port, request_host_lower,
+                          request_host_len, rank_ceiling, mapping_container)) {
     Debug("url_rewrite", "Using regex mapping with rank %d", (mapping_container.getMapping())->getRank());
     retval = true;
   }
@@ -873,11 +881,16 @@ lOverFlow:
 }
 
 bool
-UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_url, int request_port, const char *request_host,
-                                int request_host_len, int rank_ceiling, UrlMappingContainer &mapping_container)
+UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, const RegexPrefilter &prefilter, URL *request_url,
+                                int request_port, const char *request_host, int request_host_len, int rank_ceiling,
+                                UrlMappingContainer &mapping_container)
 {
   bool retval = false;
 
+  if (regex_mappings.empty()) {
+    return false;
+  }
+
   if (rank_ceiling == -1) { // we will now look at all regex mappings
     rank_ceiling = INT_MAX;
     Debug("url_rewrite_regex", "Going to match all regexes");
@@ -891,6 +904,11 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
   int request_path_len, reg_map_path_len;
   const char *request_path = request_url->path_get(&request_path_len), *reg_map_path;
 
+  // One pass over the host finds every regex that could match it; the
+  //   list is still walked in rank order so the first match wins as before
+  bool *candidates = (bool *)alloca(prefilter.count() * sizeof(bool));
+  prefilter.scan(request_host, request_host_len, candidates);
+
   // Loop over the entire linked list, or until we're satisfied
   forl_LL(RegexMapping, list_iter, regex_mappings)
   {
@@ -900,6 +918,11 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
       break;
     }
 
+    if (!candidates[list_iter->prefilter_idx]) {
+      Debug("url_rewrite_regex", "Skipping regex with rank %d as host lacks its required literal", reg_map_rank);
+      continue;
+    }
+
     reg_map_scheme = list_iter->url_map->fromURL.scheme_get(&reg_map_scheme_len);
     if ((request_scheme_len != reg_map_scheme_len) || strncmp(request_scheme, reg_map_scheme, request_scheme_len)) {
       Debug("url_rewrite_regex", "Skipping regex with rank %d as scheme does not match request scheme", reg_map_rank);
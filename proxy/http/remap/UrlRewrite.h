@@ -91,6 +91,9 @@ public:
     int substitution_markers[MAX_REGEX_SUBS];
     int substitution_ids[MAX_REGEX_SUBS];
 
+    // index of this mapping in the store's regex_prefilter
+    int prefilter_idx;
+
     LINK(RegexMapping, link);
   };
 
@@ -99,6 +102,7 @@ public:
   struct MappingsStore {
     InkHashTable *hash_lookup;
     RegexMappingList regex_list;
+    RegexPrefilter regex_prefilter; // literal prefilter over regex_list, in list order
     bool
     empty()
     {
@@ -186,8 +190,8 @@ private:
   bool _mappingLookup(MappingsStore &mappings, URL *request_url, int request_port, const char *request_host, int request_host_len,
                       UrlMappingContainer &mapping_container);
   url_mapping *_tableLookup(InkHashTable *h_table, URL *request_url, int request_port, char *request_host, int request_host_len);
-  bool _regexMappingLookup(RegexMappingList &regex_mappings, URL *request_url, int request_port, const char *request_host,
-                           int request_host_len, int rank_ceiling, UrlMappingContainer &mapping_container);
+  bool _regexMappingLookup(RegexMappingList &regex_mappings, const RegexPrefilter &prefilter, URL *request_url, int request_port,
+                           const char *request_host, int request_host_len, int rank_ceiling, UrlMappingContainer &mapping_container);
   int _expandSubstitutions(int *matches_info, const RegexMapping *reg_map, const char *matched_string, char *dest_buf,
                            int dest_buf_size);
   void _destroyTable(InkHashTable *h_table);
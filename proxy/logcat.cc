@@ -40,6 +40,7 @@
 #include "LogObject.h"
 #include "LogConfig.h"
 #include "LogBuffer.h"
+#include "LogColumnar.h"
 #include "LogUtils.h"
 #include "LogSock.h"
 #include "LogPredefined.h"
@@ -54,6 +55,9 @@ static int elf2_flag = 0;
 static int auto_filenames = 0;
 static int overwrite_existing_file = 0;
 static char output_file[1024];
+static char fields[1024];
+static char *fields_format = NULL;
+static LogColumnar columnar;
 int auto_clear_cache_flag = 0;
 
 static const ArgumentDescription argument_descriptions[] = {
@@ -67,6 +71,7 @@ static const ArgumentDescription argument_descriptions[] = {
   {"debug_tags", 'T', "Colon-Separated Debug Tags", "S1023", error_tags, NULL, NULL},
   {"overwrite_output", 'w', "Overwrite existing output file(s)", "T", &overwrite_existing_file, NULL, NULL},
   {"elf2", '2', "Convert to Extended2 Logging Format", "T", &elf2_flag, NULL, NULL},
+  {"fields", 'F', "Comma-Separated Field Symbols to Print", "S1023", &fields, NULL, NULL},
   HELP_ARGUMENT_DESCRIPTION(),
   VERSION_ARGUMENT_DESCRIPTION()};
 
@@ -148,7 +153,7 @@ process_file(int in_fd, int out_fd)
     // see if there is an alternate format request from the command
     // line
     //
-    const char *alt_format = NULL;
+    const char *alt_format = fields_format;
     if (squid_flag)
       alt_format = PreDefinedFormatInfo::squid;
     if (clf_flag)
@@ -158,6 +163,21 @@ process_file(int in_fd, int out_fd)
     if (elf2_flag)
       alt_format = PreDefinedFormatInfo::extended2;
 
+    // columnar buffers are decoded back to rows first; only the
+    // requested columns are decoded, so no alternate format is needed
+    //
+    LogBufferHeader *rows = NULL;
+    if (LogColumnar::is_columnar(header)) {
+      rows = columnar.decode(header, fields[0] ? fields : NULL);
+      if (!rows) {
+        fprintf(stderr, "Bad columnar LogBuffer!\n");
+        return 1;
+      }
+      header = rows;
+      if (alt_format == fields_format) {
+        alt_format = NULL;
+      }
+    }
     // convert the buffer to ascii entries and place onto stdout
     //
     if (header->fmt_fieldlist()) {
@@ -165,7 +185,31 @@ process_file(int in_fd, int out_fd)
     } else {
       // TODO investigate why this buffer goes wonky
     }
+    LogColumnar::free_segment(rows);
+  }
+}
+
+/*-------------------------------------------------------------------------
+  build_fields_format
+
+  Turn the comma separated field symbols given with -F into an alternate
+  format string, which projects row-wise buffers onto the same columns.
+  -------------------------------------------------------------------------*/
+
+static char *
+build_fields_format(const char *symbols)
+{
+  size_t len = 0;
+  char *copy = ats_strdup(symbols);
+  char *tok_state = NULL;
+  char *format = (char *)ats_malloc(4 * strlen(symbols) + 1);
+
+  for (char *sym = strtok_r(copy, ", ", &tok_state); sym; sym = strtok_r(NULL, ", ", &tok_state)) {
+    len += sprintf(&format[len], "%s%%<%s>", len ? " " : "", sym);
   }
+  format[len] = 0;
+  ats_free(copy);
+  return format;
 }
 
 static int
@@ -231,6 +275,13 @@ main(int /* argc ATS_UNUSED */, const char *argv[])
     fprintf(stderr, "Error: specify only one of -o <file> and -a\n");
     _exit(CMD_LINE_OPTION_ERROR);
   }
+  if (fields[0] != 0) {
+    if (squid_flag || clf_flag || elf_flag || elf2_flag) {
+      fprintf(stderr, "Error: -F cannot be combined with -S, -C, -E or -2\n");
+      _exit(CMD_LINE_OPTION_ERROR);
+    }
+    fields_format = build_fields_format(fields);
+  }
   // initialize this application for standalone logging operation
   //
   init_log_standalone_basic(PROGRAM_NAME);
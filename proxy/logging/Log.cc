@@ -50,6 +50,7 @@
 #include "LogObject.h"
 #include "LogConfig.h"
 #include "LogBuffer.h"
+#include "LogColumnar.h"
 #include "LogUtils.h"
 #include "Log.h"
 #include "LogSock.h"
@@ -1047,6 +1048,8 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
   LogFile *logfile;
   LogBuffer *logbuffer;
   LogFlushData *fdata;
+  LogColumnar columnar;
+  LogBufferHeader *columns;
   ink_hrtime now, last_time = 0;
   int len, bytes_written, total_bytes;
   SLL<LogFlushData, LogFlushData::Link_link> link, invert_link;
@@ -1067,6 +1070,7 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
     //
     while ((fdata = invert_link.pop())) {
       buf = NULL;
+      columns = NULL;
       bytes_written = 0;
       logfile = fdata->m_logfile;
 
@@ -1095,6 +1099,16 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
         continue;
       }
 
+      // transpose binary buffers into columns just before they hit the disk;
+      // buffers that would not shrink are written as they are.
+      //
+      if (logfile->m_file_format == LOG_FILE_BINARY && Log::config->binary_columnar) {
+        if ((columns = columnar.encode((LogBufferHeader *)buf)) != NULL) {
+          buf = (char *)columns;
+          total_bytes = columns->byte_count;
+        }
+      }
+
       // write *all* data to target file as much as possible
       //
       while (total_bytes - bytes_written) {
@@ -1123,6 +1137,7 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
 
       ink_atomic_increment(&logfile->m_bytes_written, bytes_written);
 
+      LogColumnar::free_segment(columns);
       delete fdata;
     }
 
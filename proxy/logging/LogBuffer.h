@@ -35,6 +35,7 @@ class LogBufferIterator;
 
 #define LOG_SEGMENT_COOKIE 0xaceface
 #define LOG_SEGMENT_VERSION 2
+#define LOG_SEGMENT_COLUMNAR_VERSION 3
 
 #if defined(linux)
 #define LB_DEFAULT_ALIGN 512
@@ -0,0 +1,879 @@
+/** @file
+
+  Columnar encoding of binary log segments.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  @section description
+  This file implements the LogColumnar class, which transposes binary log
+  segments between the row-wise LogBuffer layout and the columnar layout
+  described in LogColumnar.h.
+ */
+#include "libts.h"
+
+#include "Error.h"
+#include "LogField.h"
+#include "LogFormat.h"
+#include "LogColumnar.h"
+
+/*-------------------------------------------------------------------------
+  Varint helpers.  Integers are written 7 bits at a time, low bits first,
+  with the high bit of each byte set when more bytes follow.  Signed values
+  are zigzag mapped first so that small negative deltas stay short.
+  -------------------------------------------------------------------------*/
+
+static inline unsigned
+varint_len(uint64_t val)
+{
+  unsigned len = 1;
+  while (val >= 0x80) {
+    val >>= 7;
+    ++len;
+  }
+  return len;
+}
+
+static inline uint8_t *
+put_varint(uint8_t *p, uint64_t val)
+{
+  while (val >= 0x80) {
+    *p++ = (uint8_t)(val | 0x80);
+    val >>= 7;
+  }
+  *p++ = (uint8_t)val;
+  return p;
+}
+
+static inline bool
+get_varint(const uint8_t *&p, const uint8_t *end, uint64_t *val)
+{
+  uint64_t v = 0;
+  for (unsigned shift = 0; shift < 64 && p < end; shift += 7) {
+    uint8_t byte = *p++;
+    v |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      *val = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline uint64_t
+zigzag(int64_t val)
+{
+  return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+static inline int64_t
+unzigzag(uint64_t val)
+{
+  return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+static inline uint32_t
+slice_hash(const char *p, unsigned len)
+{
+  uint32_t hash = 2166136261U; // FNV-1a
+  for (unsigned i = 0; i < len; i++) {
+    hash = (hash ^ (uint8_t)p[i]) * 16777619U;
+  }
+  return hash;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::LogColumnar
+  -------------------------------------------------------------------------*/
+
+LogColumnar::LogColumnar() : m_cache_entries(0)
+{
+}
+
+LogColumnar::~LogColumnar()
+{
+  int n = m_cache_entries < FIELDLIST_CACHE_SIZE ? m_cache_entries : FIELDLIST_CACHE_SIZE;
+  for (int i = 0; i < n; i++) {
+    delete m_cache[i].fieldlist;
+    ats_free(m_cache[i].symbol_str);
+  }
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::fieldlist
+
+  Return the parsed fieldlist for the given symbol string.  The cache is
+  small and round-robin; a returned list stays valid until the next call.
+  -------------------------------------------------------------------------*/
+
+LogFieldList *
+LogColumnar::fieldlist(const char *symbol_str)
+{
+  int n = m_cache_entries < FIELDLIST_CACHE_SIZE ? m_cache_entries : FIELDLIST_CACHE_SIZE;
+  for (int i = 0; i < n; i++) {
+    if (strcmp(symbol_str, m_cache[i].symbol_str) == 0) {
+      return m_cache[i].fieldlist;
+    }
+  }
+
+  int slot = m_cache_entries++ % FIELDLIST_CACHE_SIZE;
+  if (slot < n) {
+    delete m_cache[slot].fieldlist;
+    ats_free(m_cache[slot].symbol_str);
+  }
+
+  LogFieldList *list = new LogFieldList;
+  bool contains_aggregates = false;
+  LogFormat::parse_symbol_string(symbol_str, list, &contains_aggregates);
+  m_cache[slot].fieldlist = list;
+  m_cache[slot].symbol_str = ats_strdup(symbol_str);
+  return list;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::encode
+
+  The segment is first cut into per-field slices, using the fieldlist from
+  the segment header and the marshalled length of each field.  A segment
+  with an entry that the slices do not cover exactly is not encoded, so it
+  is written in the row format instead.  Each column then gets whichever
+  of its candidate encodings is smallest.  Since every encoding is bounded
+  by the raw slice encoding, the output buffer is sized from that bound.
+  -------------------------------------------------------------------------*/
+
+LogBufferHeader *
+LogColumnar::encode(LogBufferHeader *header)
+{
+  if (header->version != LOG_SEGMENT_VERSION || header->format_type != LOG_FORMAT_CUSTOM || header->entry_count == 0 ||
+      !header->fmt_fieldlist()) {
+    return NULL;
+  }
+
+  LogFieldList *fl = fieldlist(header->fmt_fieldlist());
+  unsigned nfields = fl->count();
+  unsigned nentries = header->entry_count;
+
+  if (nfields == 0) {
+    return NULL;
+  }
+
+  char *buf = (char *)header;
+  char *buf_end = buf + header->byte_count;
+  char *next = buf + header->data_offset;
+  char **slice = (char **)ats_malloc(nentries * nfields * sizeof(char *));
+  uint32_t *slice_len = (uint32_t *)ats_malloc(nentries * nfields * sizeof(uint32_t));
+  LogEntryHeader **entries = (LogEntryHeader **)ats_malloc(nentries * sizeof(LogEntryHeader *));
+  size_t bound = header->data_offset + 16;
+  size_t ts_payload = 0;
+  int64_t prev_ts = 0;
+  LogBufferHeader *out = NULL;
+  uint32_t *table = NULL;
+  uint32_t *dict_first = NULL;
+  uint32_t *dict_idx = NULL;
+  unsigned table_mask = 0;
+  uint8_t *p;
+
+  // Pass 1: cut each entry into its field slices.
+  for (unsigned e = 0; e < nentries; e++) {
+    LogEntryHeader *entry = (LogEntryHeader *)next;
+    if (next + sizeof(LogEntryHeader) > buf_end || entry->entry_len < sizeof(LogEntryHeader) ||
+        entry->entry_len > (size_t)(buf_end - next)) {
+      goto done;
+    }
+
+    char *entry_end = next + entry->entry_len;
+    char *read_from = next + sizeof(LogEntryHeader);
+    unsigned i = 0;
+
+    for (LogField *f = fl->first(); f; f = fl->next(f), ++i) {
+      unsigned len = f->unmarshal_len(read_from, entry_end);
+      if (len == 0) {
+        goto done;
+      }
+      slice[e * nfields + i] = read_from;
+      slice_len[e * nfields + i] = len;
+      read_from += len;
+    }
+    // The slices must cover the entry exactly, or it would not round trip.
+    if (read_from != entry_end) {
+      goto done;
+    }
+
+    entries[e] = entry;
+    ts_payload += varint_len(zigzag(entry->timestamp - prev_ts)) + varint_len((uint32_t)entry->timestamp_usec);
+    prev_ts = entry->timestamp;
+    next = entry_end;
+  }
+
+  bound += 1 + 10 + ts_payload;
+  for (unsigned i = 0; i < nfields; i++) {
+    bound += 1 + 10;
+    for (unsigned e = 0; e < nentries; e++) {
+      bound += 5 + slice_len[e * nfields + i];
+    }
+  }
+
+  for (table_mask = 1; table_mask < 2 * nentries; table_mask <<= 1)
+    ;
+  table = (uint32_t *)ats_malloc(table_mask * sizeof(uint32_t));
+  dict_first = (uint32_t *)ats_malloc(nentries * sizeof(uint32_t));
+  dict_idx = (uint32_t *)ats_malloc(nentries * sizeof(uint32_t));
+  table_mask -= 1;
+
+  out = (LogBufferHeader *)ats_malloc(bound);
+  memcpy(out, header, header->data_offset);
+  out->version = LOG_SEGMENT_COLUMNAR_VERSION;
+
+  p = (uint8_t *)out + header->data_offset;
+  p = put_varint(p, nfields + 1);
+
+  *p++ = COLUMN_TIMESTAMP;
+  p = put_varint(p, ts_payload);
+  prev_ts = 0;
+  for (unsigned e = 0; e < nentries; e++) {
+    LogEntryHeader *entry = entries[e];
+
+    p = put_varint(p, zigzag(entry->timestamp - prev_ts));
+    p = put_varint(p, (uint32_t)entry->timestamp_usec);
+    prev_ts = entry->timestamp;
+  }
+
+  // Pass 2: size each candidate encoding of a column, then emit the best.
+  {
+    unsigned i = 0;
+    for (LogField *f = fl->first(); f; f = fl->next(f), ++i) {
+      size_t raw_size = 0;
+      size_t int_size = 0, delta_size = 0;
+      size_t dict_size = 0;
+      unsigned ndict = 0;
+      bool is_int = (f->type() == LogField::sINT || f->type() == LogField::dINT);
+      int64_t prev = 0;
+
+      for (unsigned e = 0; e < nentries; e++) {
+        unsigned len = slice_len[e * nfields + i];
+        raw_size += varint_len(len) + len;
+        if (is_int) {
+          if (len == INK_MIN_ALIGN) {
+            int64_t val = *(int64_t *)slice[e * nfields + i];
+            int_size += varint_len(zigzag(val));
+            delta_size += varint_len(zigzag((int64_t)((uint64_t)val - (uint64_t)prev)));
+            prev = val;
+          } else {
+            is_int = false;
+          }
+        }
+      }
+
+      if (is_int) {
+        uint8_t encoding = delta_size < int_size ? COLUMN_INT_DELTA : COLUMN_INT;
+        size_t size = encoding == COLUMN_INT_DELTA ? delta_size : int_size;
+
+        if (size < raw_size) {
+          *p++ = encoding;
+          p = put_varint(p, size);
+          prev = 0;
+          for (unsigned e = 0; e < nentries; e++) {
+            int64_t val = *(int64_t *)slice[e * nfields + i];
+            p = put_varint(p, zigzag(encoding == COLUMN_INT_DELTA ? (int64_t)((uint64_t)val - (uint64_t)prev) : val));
+            prev = val;
+          }
+          continue;
+        }
+      } else {
+        memset(table, 0, (table_mask + 1) * sizeof(uint32_t));
+        for (unsigned e = 0; e < nentries; e++) {
+          char *s = slice[e * nfields + i];
+          unsigned len = slice_len[e * nfields + i];
+          unsigned h = slice_hash(s, len) & table_mask;
+
+          while (table[h]) {
+            unsigned id = table[h] - 1;
+            unsigned first = dict_first[id] * nfields + i;
+            if (slice_len[first] == len && memcmp(slice[first], s, len) == 0) {
+              break;
+            }
+            h = (h + 1) & table_mask;
+          }
+          if (!table[h]) {
+            dict_first[ndict] = e;
+            table[h] = ++ndict;
+            dict_size += varint_len(len) + len;
+          }
+          dict_idx[e] = table[h] - 1;
+          dict_size += varint_len(dict_idx[e]);
+        }
+        dict_size += varint_len(ndict);
+
+        if (dict_size < raw_size) {
+          *p++ = COLUMN_DICT;
+          p = put_varint(p, dict_size);
+          p = put_varint(p, ndict);
+          for (unsigned id = 0; id < ndict; id++) {
+            unsigned first = dict_first[id] * nfields + i;
+            p = put_varint(p, slice_len[first]);
+            memcpy(p, slice[first], slice_len[first]);
+            p += slice_len[first];
+          }
+          for (unsigned e = 0; e < nentries; e++) {
+            p = put_varint(p, dict_idx[e]);
+          }
+          continue;
+        }
+      }
+
+      *p++ = COLUMN_RAW;
+      p = put_varint(p, raw_size);
+      for (unsigned e = 0; e < nentries; e++) {
+        unsigned len = slice_len[e * nfields + i];
+        p = put_varint(p, len);
+        memcpy(p, slice[e * nfields + i], len);
+        p += len;
+      }
+    }
+  }
+
+  out->byte_count = (char *)p - (char *)out;
+  ink_assert(out->byte_count <= bound);
+
+  if (out->byte_count >= header->byte_count) {
+    ats_free(out);
+    out = NULL;
+  }
+
+done:
+  ats_free(dict_idx);
+  ats_free(dict_first);
+  ats_free(table);
+  ats_free(entries);
+  ats_free(slice_len);
+  ats_free(slice);
+  return out;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::decode
+
+  The column directory is read first so that columns left out of the
+  projection are skipped without being decoded.  Selected columns are
+  expanded into per-entry (pointer, length) slices, which are then laid
+  back down as rows behind a fresh copy of the segment header.
+  -------------------------------------------------------------------------*/
+
+struct LogColumn {
+  uint8_t encoding;
+  const uint8_t *start;
+  const uint8_t *end;
+  const char **ptr;
+  uint32_t *len;
+  int64_t *ival;
+};
+
+static bool
+decode_column(LogColumn *col, unsigned nentries)
+{
+  const uint8_t *p = col->start;
+  uint64_t val;
+  int64_t prev = 0;
+
+  col->ptr = (const char **)ats_malloc(nentries * sizeof(char *));
+  col->len = (uint32_t *)ats_malloc(nentries * sizeof(uint32_t));
+
+  switch (col->encoding) {
+  case LogColumnar::COLUMN_INT:
+  case LogColumnar::COLUMN_INT_DELTA:
+    col->ival = (int64_t *)ats_malloc(nentries * sizeof(int64_t));
+    for (unsigned e = 0; e < nentries; e++) {
+      if (!get_varint(p, col->end, &val)) {
+        return false;
+      }
+      col->ival[e] = (int64_t)((uint64_t)unzigzag(val) + (col->encoding == LogColumnar::COLUMN_INT_DELTA ? (uint64_t)prev : 0));
+      prev = col->ival[e];
+      col->ptr[e] = (const char *)&col->ival[e];
+      col->len[e] = INK_MIN_ALIGN;
+    }
+    return true;
+
+  case LogColumnar::COLUMN_RAW:
+    for (unsigned e = 0; e < nentries; e++) {
+      if (!get_varint(p, col->end, &val) || val > (uint64_t)(col->end - p)) {
+        return false;
+      }
+      col->ptr[e] = (const char *)p;
+      col->len[e] = val;
+      p += val;
+    }
+    return true;
+
+  case LogColumnar::COLUMN_DICT: {
+    uint64_t ndict;
+    if (!get_varint(p, col->end, &ndict) || ndict > (uint64_t)(col->end - p)) {
+      return false;
+    }
+
+    const char **dict_ptr = (const char **)ats_malloc(ndict * sizeof(char *));
+    uint32_t *dict_len = (uint32_t *)ats_malloc(ndict * sizeof(uint32_t));
+    bool ok = true;
+
+    for (unsigned id = 0; ok && id < ndict; id++) {
+      if (!get_varint(p, col->end, &val) || val > (uint64_t)(col->end - p)) {
+        ok = false;
+        break;
+      }
+      dict_ptr[id] = (const char *)p;
+      dict_len[id] = val;
+      p += val;
+    }
+    for (unsigned e = 0; ok && e < nentries; e++) {
+      if (!get_varint(p, col->end, &val) || val >= ndict) {
+        ok = false;
+        break;
+      }
+      col->ptr[e] = dict_ptr[val];
+      col->len[e] = dict_len[val];
+    }
+
+    ats_free(dict_len);
+    ats_free(dict_ptr);
+    return ok;
+  }
+
+  default:
+    return false;
+  }
+}
+
+static unsigned
+add_header_str(const char *str, char *buf_ptr)
+{
+  unsigned len = 0;
+  if (str) {
+    len = (unsigned)(::strlen(str) + 1);
+    memcpy(buf_ptr, str, len);
+  }
+  return len;
+}
+
+LogBufferHeader *
+LogColumnar::decode(LogBufferHeader *header, const char *projection)
+{
+  if (!is_columnar(header) || !header->fmt_fieldlist() || header->data_offset > header->byte_count ||
+      header->entry_count > header->byte_count) {
+    return NULL;
+  }
+
+  LogFieldList *fl = fieldlist(header->fmt_fieldlist());
+  unsigned nfields = fl->count();
+  unsigned nentries = header->entry_count;
+  const uint8_t *p = (const uint8_t *)header + header->data_offset;
+  const uint8_t *end = (const uint8_t *)header + header->byte_count;
+  uint64_t ncols;
+
+  if (!get_varint(p, end, &ncols) || ncols != nfields + 1) {
+    return NULL;
+  }
+
+  LogColumn *cols = (LogColumn *)ats_calloc(ncols, sizeof(LogColumn));
+  unsigned *out_field = (unsigned *)ats_malloc((projection ? strlen(projection) + 1 : nfields) * sizeof(unsigned));
+  unsigned nout = 0;
+  int64_t *ts = (int64_t *)ats_malloc(nentries * sizeof(int64_t));
+  int32_t *usec = (int32_t *)ats_malloc(nentries * sizeof(int32_t));
+  char *out_fieldlist = NULL;
+  char *out_printf = NULL;
+  LogBufferHeader *out = NULL;
+  size_t hdr_len, data_len;
+  uint64_t val;
+  int64_t prev_ts = 0;
+  char *w;
+
+  for (unsigned c = 0; c < ncols; c++) {
+    if (p >= end) {
+      goto done;
+    }
+    cols[c].encoding = *p++;
+    if (!get_varint(p, end, &val) || val > (uint64_t)(end - p)) {
+      goto done;
+    }
+    cols[c].start = p;
+    cols[c].end = p + val;
+    p += val;
+  }
+
+  // Select the output columns.
+  if (projection) {
+    char *tok_state = NULL;
+    char *symbols = ats_strdup(projection);
+    size_t fieldlist_len = 0;
+
+    for (char *sym = strtok_r(symbols, ", ", &tok_state); sym; sym = strtok_r(NULL, ", ", &tok_state)) {
+      unsigned i = 0;
+      LogField *f;
+      for (f = fl->first(); f && strcmp(f->symbol(), sym) != 0; f = fl->next(f)) {
+        ++i;
+      }
+      if (!f) {
+        Note("Field %s is not present in the columnar log segment", sym);
+        ats_free(symbols);
+        goto done;
+      }
+      out_field[nout++] = i;
+      fieldlist_len += strlen(sym) + 1;
+    }
+    ats_free(symbols);
+
+    if (nout == 0) {
+      goto done;
+    }
+
+    out_fieldlist = (char *)ats_malloc(fieldlist_len);
+    out_printf = (char *)ats_malloc(2 * nout);
+    w = out_fieldlist;
+    for (unsigned o = 0; o < nout; o++) {
+      unsigned i = 0;
+      LogField *f;
+      for (f = fl->first(); i < out_field[o]; f = fl->next(f)) {
+        ++i;
+      }
+      w += add_header_str(f->symbol(), w);
+      w[-1] = ',';
+      out_printf[2 * o] = LOG_FIELD_MARKER;
+      out_printf[2 * o + 1] = ' ';
+    }
+    w[-1] = '\0';
+    out_printf[2 * nout - 1] = '\0';
+  } else {
+    for (unsigned i = 0; i < nfields; i++) {
+      out_field[nout++] = i;
+    }
+  }
+
+  // Decode the timestamps and the selected columns.
+  p = cols[0].start;
+  if (cols[0].encoding != COLUMN_TIMESTAMP) {
+    goto done;
+  }
+  for (unsigned e = 0; e < nentries; e++) {
+    uint64_t us;
+    if (!get_varint(p, cols[0].end, &val) || !get_varint(p, cols[0].end, &us)) {
+      goto done;
+    }
+    ts[e] = prev_ts + unzigzag(val);
+    usec[e] = (int32_t)us;
+    prev_ts = ts[e];
+  }
+
+  data_len = 0;
+  for (unsigned o = 0; o < nout; o++) {
+    LogColumn *col = &cols[out_field[o] + 1];
+    if (!col->ptr && !decode_column(col, nentries)) {
+      goto done;
+    }
+  }
+  for (unsigned e = 0; e < nentries; e++) {
+    data_len += sizeof(LogEntryHeader);
+    for (unsigned o = 0; o < nout; o++) {
+      data_len += cols[out_field[o] + 1].len[e];
+    }
+  }
+
+  // Lay down the header, then the rows.
+  if (projection) {
+    hdr_len = sizeof(LogBufferHeader);
+    hdr_len += header->fmt_name() ? strlen(header->fmt_name()) + 1 : 0;
+    hdr_len += strlen(out_fieldlist) + 1 + strlen(out_printf) + 1;
+    hdr_len += header->src_hostname() ? strlen(header->src_hostname()) + 1 : 0;
+    hdr_len += header->log_filename() ? strlen(header->log_filename()) + 1 : 0;
+    hdr_len = INK_ALIGN_DEFAULT(hdr_len);
+
+    out = (LogBufferHeader *)ats_malloc(hdr_len + data_len);
+    memset(out, 0, hdr_len);
+    memcpy(out, header, sizeof(LogBufferHeader));
+
+    w = (char *)out + sizeof(LogBufferHeader);
+    out->fmt_name_offset = header->fmt_name() ? w - (char *)out : 0;
+    w += add_header_str(header->fmt_name(), w);
+    out->fmt_fieldlist_offset = w - (char *)out;
+    w += add_header_str(out_fieldlist, w);
+    out->fmt_printf_offset = w - (char *)out;
+    w += add_header_str(out_printf, w);
+    out->src_hostname_offset = header->src_hostname() ? w - (char *)out : 0;
+    w += add_header_str(header->src_hostname(), w);
+    out->log_filename_offset = header->log_filename() ? w - (char *)out : 0;
+    w += add_header_str(header->log_filename(), w);
+  } else {
+    hdr_len = header->data_offset;
+    out = (LogBufferHeader *)ats_malloc(hdr_len + data_len);
+    memcpy(out, header, hdr_len);
+  }
+
+  out->version = LOG_SEGMENT_VERSION;
+  out->data_offset = hdr_len;
+  out->byte_count = hdr_len + data_len;
+
+  w = (char *)out + hdr_len;
+  for (unsigned e = 0; e < nentries; e++) {
+    LogEntryHeader *entry = (LogEntryHeader *)w;
+    w += sizeof(LogEntryHeader);
+    for (unsigned o = 0; o < nout; o++) {
+      LogColumn *col = &cols[out_field[o] + 1];
+      memcpy(w, col->ptr[e], col->len[e]);
+      w += col->len[e];
+    }
+
+    entry->timestamp = ts[e];
+    entry->timestamp_usec = usec[e];
+    entry->entry_len = w - (char *)entry;
+  }
+
+done:
+  for (unsigned c = 0; c < ncols; c++) {
+    ats_free(cols[c].ival);
+    ats_free(cols[c].len);
+    ats_free(cols[c].ptr);
+  }
+  ats_free(cols);
+  ats_free(out_printf);
+  ats_free(out_fieldlist);
+  ats_free(usec);
+  ats_free(ts);
+  ats_free(out_field);
+  return out;
+}
+
+#if TS_HAS_TESTS
+#include "ts/TestBox.h"
+
+/*-------------------------------------------------------------------------
+  Build a row segment for the regression test.  Status codes and methods
+  repeat, lengths grow steadily, URLs are mostly distinct with the odd
+  empty one, and the server host name is always empty.  Entry
+  COLUMNAR_TEST_LONG_URL has a URL longer than LOG_MAX_FORMATTED_LINE,
+  which can't be unmarshalled.  With tail, junk follows the fields of the
+  last entry.
+  -------------------------------------------------------------------------*/
+
+static const char columnar_test_fieldlist[] = "pssc,psql,cqhm,cquc,cqhv,shn,cqtx";
+static const unsigned COLUMNAR_TEST_FIELDS = 7;
+static const unsigned COLUMNAR_TEST_LONG_URL = 42;
+static const unsigned COLUMNAR_TEST_LONG_URL_LEN = LOG_MAX_FORMATTED_LINE + 2048;
+
+static char *
+columnar_test_put_str(char *w, const char *str)
+{
+  unsigned len = INK_ALIGN_DEFAULT(strlen(str) + 1);
+  memset(w, 0, len);
+  memcpy(w, str, strlen(str));
+  return w + len;
+}
+
+static char *
+columnar_test_put_int(char *w, int64_t val)
+{
+  memcpy(w, &val, sizeof(val));
+  return w + INK_MIN_ALIGN;
+}
+
+static LogBufferHeader *
+columnar_test_segment(unsigned nentries, bool tail = false)
+{
+  char printf_str[32];
+  unsigned nfields = COLUMNAR_TEST_FIELDS;
+  char *long_url = (char *)ats_malloc(COLUMNAR_TEST_LONG_URL_LEN + 1);
+
+  for (unsigned i = 0; i < nfields; i++) {
+    printf_str[2 * i] = LOG_FIELD_MARKER;
+    printf_str[2 * i + 1] = ' ';
+  }
+  printf_str[2 * nfields - 1] = '\0';
+
+  size_t hdr_len = INK_ALIGN_DEFAULT(sizeof(LogBufferHeader) + strlen("columnar") + 1 + strlen(columnar_test_fieldlist) + 1 +
+                                     strlen(printf_str) + 1 + strlen("localhost") + 1 + strlen("test.blog") + 1);
+  size_t max_entry = sizeof(LogEntryHeader) + 6 * INK_MIN_ALIGN + 2 * 64 + 2 * 64 + INK_MIN_ALIGN;
+  LogBufferHeader *header = (LogBufferHeader *)ats_malloc(hdr_len + nentries * max_entry + 2 * COLUMNAR_TEST_LONG_URL_LEN);
+  char *w;
+
+  memcpy(long_url, "http://www.example.com/", 23);
+  for (unsigned i = 23; i < COLUMNAR_TEST_LONG_URL_LEN; i++) {
+    long_url[i] = 'a' + i % 26;
+  }
+  long_url[COLUMNAR_TEST_LONG_URL_LEN] = '\0';
+
+  memset(header, 0, hdr_len);
+  header->cookie = LOG_SEGMENT_COOKIE;
+  header->version = LOG_SEGMENT_VERSION;
+  header->format_type = LOG_FORMAT_CUSTOM;
+  header->entry_count = nentries;
+
+  w = (char *)header + sizeof(LogBufferHeader);
+  header->fmt_name_offset = w - (char *)header;
+  w += add_header_str("columnar", w);
+  header->fmt_fieldlist_offset = w - (char *)header;
+  w += add_header_str(columnar_test_fieldlist, w);
+  header->fmt_printf_offset = w - (char *)header;
+  w += add_header_str(printf_str, w);
+  header->src_hostname_offset = w - (char *)header;
+  w += add_header_str("localhost", w);
+  header->log_filename_offset = w - (char *)header;
+  w += add_header_str("test.blog", w);
+  header->data_offset = hdr_len;
+
+  w = (char *)header + hdr_len;
+  for (unsigned e = 0; e < nentries; e++) {
+    LogEntryHeader *entry = (LogEntryHeader *)w;
+    char url_buf[64];
+    const char *url = url_buf;
+    const char *method = e % 5 ? "GET" : "POST";
+
+    if (e == COLUMNAR_TEST_LONG_URL) {
+      url = long_url;
+    } else if (e % 11) {
+      snprintf(url_buf, sizeof(url_buf), "http://www.example.com/path/%u", e);
+    } else {
+      url_buf[0] = '\0';
+    }
+
+    w += sizeof(LogEntryHeader);
+    w = columnar_test_put_int(w, e % 7 ? 200 : 404);
+    w = columnar_test_put_int(w, 1000 + 13 * e);
+    w = columnar_test_put_str(w, method);
+    w = columnar_test_put_str(w, url);
+    w = columnar_test_put_int(w, (1 << 16) | 1);
+    w = columnar_test_put_str(w, "");
+    // cqtx is the method, the URL and the version's major and minor
+    w = columnar_test_put_str(w, method);
+    w = columnar_test_put_str(w, url);
+    w = columnar_test_put_int(w, 1);
+    w = columnar_test_put_int(w, 1);
+    if (tail && e == nentries - 1) {
+      memset(w, 0xab, INK_MIN_ALIGN);
+      w += INK_MIN_ALIGN;
+    }
+
+    entry->timestamp = 1400000000 + e / 10;
+    entry->timestamp_usec = (e * 7919) % 1000000;
+    entry->entry_len = w - (char *)entry;
+  }
+  header->byte_count = w - (char *)header;
+  ats_free(long_url);
+  return header;
+}
+
+REGRESSION_TEST(LogColumnar)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+  LogColumnar columnar;
+  LogBufferHeader *row = columnar_test_segment(200);
+  LogBufferHeader *col;
+  LogBufferHeader *dec;
+
+  box = REGRESSION_TEST_PASSED;
+
+  // A row segment is not columnar, and a columnar one can't be encoded again.
+  box.check(columnar.decode(row) == NULL, "decoded a row segment");
+
+  col = columnar.encode(row);
+  if (!box.check(col != NULL, "row segment was not encoded")) {
+    LogColumnar::free_segment(row);
+    return;
+  }
+  box.check(LogColumnar::is_columnar(col), "encoded segment has version %u", col->version);
+  box.check(col->byte_count < row->byte_count, "encoded segment is %u bytes, row segment %u", col->byte_count, row->byte_count);
+  box.check(columnar.encode(col) == NULL, "encoded a columnar segment");
+
+  // An entry with bytes after its fields is left in the row format rather than losing them.
+  LogBufferHeader *tail = columnar_test_segment(200, true);
+  LogBufferHeader *tail_col = columnar.encode(tail);
+  box.check(tail_col == NULL, "encoded a segment with bytes after the fields of an entry");
+  LogColumnar::free_segment(tail_col);
+  LogColumnar::free_segment(tail);
+
+  // The round trip is byte for byte, including the URL too long to unmarshal in cquc and cqtx.
+  dec = columnar.decode(col);
+  if (box.check(dec != NULL, "columnar segment was not decoded")) {
+    box.check(dec->byte_count == row->byte_count && memcmp(dec, row, row->byte_count) == 0,
+              "decoded segment (%u bytes) differs from the row segment (%u bytes)", dec->byte_count, row->byte_count);
+    LogColumnar::free_segment(dec);
+  }
+
+  // A projection keeps the timestamps and just the selected fields, in the order asked for.
+  dec = columnar.decode(col, "cqhm,pssc");
+  if (box.check(dec != NULL, "projection was not decoded")) {
+    box.check(strcmp(dec->fmt_fieldlist(), "cqhm,pssc") == 0, "projection has fieldlist '%s'", dec->fmt_fieldlist());
+    box.check(dec->entry_count == row->entry_count, "projection has %u entries", dec->entry_count);
+
+    char *r = (char *)dec + dec->data_offset;
+    for (unsigned e = 0; e < dec->entry_count && r < (char *)dec + dec->byte_count; e++) {
+      LogEntryHeader *entry = (LogEntryHeader *)r;
+      char *f = r + sizeof(LogEntryHeader);
+      int64_t status;
+
+      memcpy(&status, f + INK_ALIGN_DEFAULT(strlen(f) + 1), sizeof(status));
+      box.check(entry->timestamp == 1400000000 + e / 10 && entry->timestamp_usec == (int32_t)((e * 7919) % 1000000),
+                "projected entry %u has timestamp %" PRId64 ".%06d", e, entry->timestamp, entry->timestamp_usec);
+      box.check(strcmp(f, e % 5 ? "GET" : "POST") == 0, "projected entry %u has method '%s'", e, f);
+      box.check(status == (e % 7 ? 200 : 404), "projected entry %u has status %" PRId64, e, status);
+      box.check(entry->entry_len == sizeof(LogEntryHeader) + INK_ALIGN_DEFAULT(strlen(f) + 1) + INK_MIN_ALIGN,
+                "projected entry %u is %u bytes", e, entry->entry_len);
+      r += entry->entry_len;
+    }
+    box.check(r == (char *)dec + dec->byte_count, "projected entries don't fill the segment");
+    LogColumnar::free_segment(dec);
+  }
+  box.check(columnar.decode(col, "cqhm,nosuchfield") == NULL, "decoded a projection of an unknown field");
+
+  // Every truncation is rejected. Each copy is allocated at its truncated size so reads past it are caught.
+  for (uint32_t len = col->data_offset; len < col->byte_count; len++) {
+    LogBufferHeader *cut = (LogBufferHeader *)ats_malloc(len);
+    memcpy(cut, col, len);
+    cut->byte_count = len;
+    dec = columnar.decode(cut);
+    box.check(dec == NULL, "decoded a segment truncated to %u of %u bytes", len, col->byte_count);
+    LogColumnar::free_segment(dec);
+    ats_free(cut);
+  }
+
+  // Corrupt the column count, the timestamp column's encoding, a field column's encoding, and the entry count.
+  LogBufferHeader *bad = (LogBufferHeader *)ats_malloc(col->byte_count);
+  uint8_t *data = (uint8_t *)bad + col->data_offset;
+  const uint8_t *p = (const uint8_t *)col + col->data_offset + 1;
+  uint64_t ts_len;
+
+  memcpy(bad, col, col->byte_count);
+  data[0] += 1;
+  box.check(columnar.decode(bad) == NULL, "decoded a segment with the wrong column count");
+
+  memcpy(bad, col, col->byte_count);
+  data[1] = LogColumnar::COLUMN_INT;
+  box.check(columnar.decode(bad) == NULL, "decoded a segment without a timestamp column");
+
+  memcpy(bad, col, col->byte_count);
+  ++p;
+  if (box.check(get_varint(p, (const uint8_t *)col + col->byte_count, &ts_len), "no timestamp column length")) {
+    data[(p - ((const uint8_t *)col + col->data_offset)) + ts_len] = 0x7f;
+    box.check(columnar.decode(bad) == NULL, "decoded a segment with an unknown column encoding");
+  }
+
+  memcpy(bad, col, col->byte_count);
+  bad->entry_count += 1;
+  box.check(columnar.decode(bad) == NULL, "decoded a segment with too many entries");
+
+  ats_free(bad);
+  LogColumnar::free_segment(col);
+  LogColumnar::free_segment(row);
+}
+
+#endif /* TS_HAS_TESTS */
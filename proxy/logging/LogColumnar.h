@@ -0,0 +1,114 @@
+/** @file
+
+  Columnar encoding of binary log segments.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef LOG_COLUMNAR_H
+#define LOG_COLUMNAR_H
+
+#include "libts.h"
+#include "LogBuffer.h"
+
+class LogFieldList;
+
+/*-------------------------------------------------------------------------
+  LogColumnar
+
+  Converts a row-wise binary log segment (a LogBufferHeader followed by
+  LogEntryHeader-prefixed entries) to and from a columnar segment.  The
+  columnar segment keeps the LogBufferHeader and header strings of the row
+  segment it came from, but carries LOG_SEGMENT_COLUMNAR_VERSION, and its
+  data section stores the entry timestamps followed by one column per
+  LogField of the format:
+
+    varint column_count
+    column_count x { uint8 encoding, varint payload_len, payload }
+
+  Timestamps are delta encoded.  Integer fields are stored as zigzag
+  varints, either plain or delta encoded, whichever is smaller.  All other
+  fields are stored as raw byte slices or, when the segment repeats values
+  often enough to pay for it, as a dictionary of distinct slices plus one
+  varint index per entry.  The encoding is lossless: decode() reproduces
+  the original row segment byte for byte, so every existing reader of row
+  segments works unchanged on the result.  Segments whose entries can't be
+  cut exactly into field slices are not encoded.
+
+  Each instance caches the fieldlists it has parsed, so a thread that
+  encodes or decodes segments should use its own instance.
+  -------------------------------------------------------------------------*/
+
+class LogColumnar
+{
+public:
+  enum ColumnEncoding {
+    COLUMN_TIMESTAMP = 0,
+    COLUMN_INT,
+    COLUMN_INT_DELTA,
+    COLUMN_RAW,
+    COLUMN_DICT,
+  };
+
+  LogColumnar();
+  ~LogColumnar();
+
+  // Returns a newly allocated columnar segment for the given row segment,
+  // or NULL if the segment cannot be transposed or would not shrink.
+  LogBufferHeader *encode(LogBufferHeader *header);
+
+  // Returns a newly allocated row segment for the given columnar segment,
+  // or NULL if it is malformed.  If projection is a comma separated list
+  // of field symbols, only those columns are decoded, in that order, and
+  // the returned segment's fieldlist and printf string describe them.
+  LogBufferHeader *decode(LogBufferHeader *header, const char *projection = NULL);
+
+  static void
+  free_segment(LogBufferHeader *header)
+  {
+    ats_free(header);
+  }
+
+  static bool
+  is_columnar(const LogBufferHeader *header)
+  {
+    return header->version == LOG_SEGMENT_COLUMNAR_VERSION;
+  }
+
+private:
+  enum {
+    FIELDLIST_CACHE_SIZE = 16,
+  };
+
+  LogFieldList *fieldlist(const char *symbol_str);
+
+  struct FieldListCacheElement {
+    LogFieldList *fieldlist;
+    char *symbol_str;
+  };
+
+  FieldListCacheElement m_cache[FIELDLIST_CACHE_SIZE];
+  int m_cache_entries;
+
+  // -- member functions that are not allowed --
+  LogColumnar(const LogColumnar &rhs);
+  LogColumnar &operator=(const LogColumnar &rhs);
+};
+
+#endif
@@ -153,6 +153,7 @@ LogConfig::setup_default_values()
 
   ascii_buffer_size = 4 * 9216;
   max_line_size = 9216; // size of pipe buffer for SunOS 5.6
+  binary_columnar = false;
 }
 
 void *
@@ -442,6 +443,9 @@ LogConfig::read_configuration_variables()
     max_line_size = val;
   }
 
+  val = (int)REC_ConfigReadInteger("proxy.config.log.binary_columnar");
+  binary_columnar = (val > 0);
+
   /* The following variables are initialized after reading the     */
   /* variable values from records.config                           */
 
@@ -725,6 +729,7 @@ LogConfig::display(FILE *fd)
   fprintf(fd, "   sampling_frequency = %d\n", sampling_frequency);
   fprintf(fd, "   file_stat_frequency = %d\n", file_stat_frequency);
   fprintf(fd, "   space_used_frequency = %d\n", space_used_frequency);
+  fprintf(fd, "   binary_columnar = %d\n", binary_columnar);
 
   fprintf(fd, "\n");
   fprintf(fd, "************ Log Objects (%u objects) ************\n", (unsigned int)log_object_manager.get_num_objects());
@@ -1099,7 +1104,7 @@ LogConfig::register_config_callbacks()
     "proxy.config.log.xml_config_file", "proxy.config.log.hosts_config_file", "proxy.config.log.sampling_frequency",
     "proxy.config.log.file_stat_frequency", "proxy.config.log.space_used_frequency", "proxy.config.log.search_rolling_interval_sec",
     "proxy.config.log.search_log_enabled", "proxy.config.log.search_top_sites", "proxy.config.log.search_server_ip_addr",
-    "proxy.config.log.search_server_port", "proxy.config.log.search_url_filter",
+    "proxy.config.log.search_server_port", "proxy.config.log.search_url_filter", "proxy.config.log.binary_columnar",
   };
 
 
@@ -1177,6 +1182,8 @@ LogConfig::register_stat_callbacks()
                      (int)log_stat_log_files_open_stat, RecRawStatSyncSum);
   RecRegisterRawStat(log_rsb, RECT_PROCESS, "proxy.process.log.log_files_space_used", RECD_INT, RECP_NON_PERSISTENT,
                      (int)log_stat_log_files_space_used_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(log_rsb, RECT_PROCESS, "proxy.process.log.buffer_checkout_contention", RECD_COUNTER, RECP_NON_PERSISTENT,
+                     (int)log_stat_buffer_checkout_contention_stat, RecRawStatSyncSum);
 }
 
 /*-------------------------------------------------------------------------
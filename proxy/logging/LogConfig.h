@@ -67,6 +67,9 @@ enum {
   log_stat_log_files_open_stat,
   log_stat_log_files_space_used_stat,
 
+  // Buffer checkout
+  log_stat_buffer_checkout_contention_stat,
+
   log_stat_count
 };
 
@@ -220,6 +223,7 @@ public:
 
   int ascii_buffer_size;
   int max_line_size;
+  bool binary_columnar;
 
   char *hostname;
   char *logfile_dir;
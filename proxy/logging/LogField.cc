@@ -366,6 +366,72 @@ LogField::unmarshal(char **buf, char *dest, int len)
   }
 }
 
+/*-------------------------------------------------------------------------
+  LogField::unmarshal_len
+
+  This routine returns the number of bytes this field occupies in a
+  marshalled entry starting at buf and ending before end.  The length is
+  read from the marshalled layout of the field, never from formatting it,
+  so it is right even for values too long to unmarshal.  It returns 0 if
+  the field runs past end or has a layout this routine does not know.
+  -------------------------------------------------------------------------*/
+static unsigned
+marshalled_str_len(char *buf, char *end)
+{
+  char *nul = (char *)memchr(buf, 0, end - buf);
+
+  if (nul == NULL) {
+    return 0;
+  }
+  unsigned len = INK_ALIGN_DEFAULT(nul - buf + 1);
+  return len <= (size_t)(end - buf) ? len : 0;
+}
+
+unsigned
+LogField::unmarshal_len(char *buf, char *end)
+{
+  unsigned len = 0;
+
+  if (buf >= end) {
+    return 0;
+  }
+
+  if (m_unmarshal_func_map != NULL || m_unmarshal_func == &(LogAccess::unmarshal_int_to_str) ||
+      m_unmarshal_func == &(LogAccess::unmarshal_int_to_str_hex) || m_unmarshal_func == &(LogAccess::unmarshal_ttmsf) ||
+      m_unmarshal_func == &(LogAccess::unmarshal_http_status)) {
+    len = INK_MIN_ALIGN;
+  } else if (m_unmarshal_func == &(LogAccess::unmarshal_http_version)) {
+    len = 2 * INK_MIN_ALIGN;
+  } else if (m_unmarshal_func == (UnmarshalFunc)LogAccess::unmarshal_str) {
+    len = marshalled_str_len(buf, end);
+  } else if (m_unmarshal_func == (UnmarshalFunc)LogAccess::unmarshal_http_text) {
+    // method, URL, then the version
+    unsigned method = marshalled_str_len(buf, end);
+    unsigned url = method ? marshalled_str_len(buf + method, end) : 0;
+    len = url ? method + url + 2 * INK_MIN_ALIGN : 0;
+  } else if (m_unmarshal_func == &(LogAccess::unmarshal_ip_to_str) || m_unmarshal_func == &(LogAccess::unmarshal_ip_to_hex)) {
+    if ((size_t)(end - buf) < sizeof(LogFieldIp)) {
+      return 0;
+    }
+    // this is how unmarshal_ip() steps over it
+    switch (reinterpret_cast<LogFieldIp *>(buf)->_family) {
+    case AF_INET:
+      len = INK_ALIGN_DEFAULT(sizeof(LogFieldIp4));
+      break;
+    case AF_INET6:
+      len = INK_ALIGN_DEFAULT(sizeof(LogFieldIp6));
+      break;
+    default:
+      len = INK_ALIGN_DEFAULT(sizeof(LogFieldIp));
+      break;
+    }
+  } else if (m_unmarshal_func == &(LogAccess::unmarshal_record)) {
+    len = MARSHAL_RECORD_LENGTH;
+  }
+
+  return len <= (size_t)(end - buf) ? len : 0;
+}
+
 /*-------------------------------------------------------------------------
   LogField::display
   -------------------------------------------------------------------------*/
@@ -129,6 +129,7 @@ public:
   unsigned marshal(LogAccess *lad, char *buf);
   unsigned marshal_agg(char *buf);
   unsigned unmarshal(char **buf, char *dest, int len);
+  unsigned unmarshal_len(char *buf, char *end);
   void display(FILE *fd = stdout);
   bool operator==(LogField &rhs);
   void updateField(LogAccess *lad, char *val, int len);
@@ -51,6 +51,27 @@ should_roll_on_size(Log::RollingEnabledValues roll)
   return roll == Log::ROLL_ON_SIZE_ONLY || roll == Log::ROLL_ON_TIME_OR_SIZE;
 }
 
+// Every thread that logs is given a small index the first time it does,
+// which selects its work buffer slot in each LogObject.
+static vint32 log_thread_count = 0;
+static __thread int log_thread_index = -1;
+
+static inline int
+log_thread_idx()
+{
+  if (unlikely(log_thread_index < 0)) {
+    log_thread_index = ink_atomic_increment(&log_thread_count, 1);
+  }
+  return log_thread_index;
+}
+
+static inline int
+log_thread_slots()
+{
+  int n = log_thread_count;
+  return n < LOG_OBJECT_MAX_THREAD_BUFFERS ? n : LOG_OBJECT_MAX_THREAD_BUFFERS;
+}
+
 size_t
 LogBufferManager::preproc_buffers(LogBufferSink *sink)
 {
@@ -114,10 +135,7 @@ LogObject::LogObject(const LogFormat *format, const char *log_dir, const char *b
   //
   m_logFile = new LogFile(m_filename, header, file_format, m_signature, Log::config->ascii_buffer_size, Log::config->max_line_size);
 
-  LogBuffer *b = new LogBuffer(this, Log::config->log_buffer_size);
-  ink_assert(b);
-  SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
-
+  _init_buffers();
   _setup_rolling(rolling_enabled, rolling_interval_sec, rolling_offset_hr, rolling_size_mb);
 
   Debug("log-config", "exiting LogObject constructor, filename=%s this=%p", m_filename, this);
@@ -147,11 +165,9 @@ LogObject::LogObject(LogObject &rhs)
     add_loghost(host);
   }
 
-  // copy gets a fresh log buffer
+  // copy gets fresh log buffers
   //
-  LogBuffer *b = new LogBuffer(this, Log::config->log_buffer_size);
-  ink_assert(b);
-  SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+  _init_buffers();
 
   Debug("log-config", "exiting LogObject copy constructor, "
                       "filename=%s this=%p",
@@ -176,6 +192,51 @@ LogObject::~LogObject()
   delete m_format;
   delete[] m_buffer_manager;
   delete (LogBuffer *)FREELIST_POINTER(m_log_buffer);
+  for (int i = 0; i < LOG_OBJECT_MAX_THREAD_BUFFERS; i++) {
+    delete (LogBuffer *)FREELIST_POINTER(m_thread_buffers[i].buffer);
+  }
+  ats_memalign_free(m_thread_buffers);
+}
+
+void
+LogObject::_init_buffers()
+{
+  LogBuffer *b = new LogBuffer(this, Log::config->log_buffer_size);
+  ink_assert(b);
+  SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+
+  // per-thread buffers are created the first time each thread logs
+  m_thread_buffers = (LogThreadBuffer *)ats_memalign(sizeof(LogThreadBuffer), LOG_OBJECT_MAX_THREAD_BUFFERS * sizeof(LogThreadBuffer));
+  memset(m_thread_buffers, 0, LOG_OBJECT_MAX_THREAD_BUFFERS * sizeof(LogThreadBuffer));
+
+  m_buffers_full = 0;
+  m_buffers_forced = 0;
+  m_checkout_contention = 0;
+}
+
+/*-------------------------------------------------------------------------
+  LogObject::_thread_slot
+
+  Return the work buffer slot of the calling thread, creating its buffer
+  if this is the first time the thread logs to this object.  Only the
+  owning thread ever installs a buffer into an empty slot.
+  -------------------------------------------------------------------------*/
+
+volatile head_p *
+LogObject::_thread_slot()
+{
+  int idx = log_thread_idx();
+  if (idx >= LOG_OBJECT_MAX_THREAD_BUFFERS) {
+    return &m_log_buffer;
+  }
+
+  volatile head_p *slot = &m_thread_buffers[idx].buffer;
+  if (unlikely(FREELIST_POINTER(*slot) == NULL)) {
+    LogBuffer *b = new LogBuffer(this, Log::config->log_buffer_size);
+    INK_WRITE_MEMORY_BARRIER;
+    SET_FREELIST_POINTER_VERSION(*slot, b, 0);
+  }
+  return slot;
 }
 
 //-----------------------------------------------------------------------------
@@ -343,6 +404,8 @@ LogObject::display(FILE *fd)
     fprintf(fd, "full path = %s\n", get_full_filename());
   }
   m_filter_list.display(fd);
+  fprintf(fd, "buffers flushed full = %" PRId64 ", forced = %" PRId64 ", checkout contention = %" PRId64 "\n", m_buffers_full,
+          m_buffers_forced, m_checkout_contention);
   fprintf(fd, "++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
 }
 
@@ -377,12 +440,13 @@ LogObject::displayAsXML(FILE *fd, bool extended)
 
 
 LogBuffer *
-LogObject::_checkout_write(size_t *write_offset, size_t bytes_needed)
+LogObject::_checkout_write(volatile head_p *slot, size_t *write_offset, size_t bytes_needed)
 {
   LogBuffer::LB_ResultCode result_code;
   LogBuffer *buffer;
   LogBuffer *new_buffer;
   bool retry = true;
+  int contention = 0;
 
   do {
     // To avoid a race condition, we keep a count of held references in
@@ -390,14 +454,15 @@ LogObject::_checkout_write(size_t *write_offset, size_t bytes_needed)
     head_p h;
     int result = 0;
     do {
-      INK_QUEUE_LD(h, m_log_buffer);
+      INK_QUEUE_LD(h, *slot);
       head_p new_h;
       SET_FREELIST_POINTER_VERSION(new_h, FREELIST_POINTER(h), FREELIST_VERSION(h) + 1);
 #if TS_HAS_128BIT_CAS
-      result = ink_atomic_cas((__int128_t *)&m_log_buffer.data, h.data, new_h.data);
+      result = ink_atomic_cas((__int128_t *)&slot->data, h.data, new_h.data);
 #else
-      result = ink_atomic_cas((int64_t *)&m_log_buffer.data, h.data, new_h.data);
+      result = ink_atomic_cas((int64_t *)&slot->data, h.data, new_h.data);
 #endif
+      contention += !result;
     } while (!result);
     buffer = (LogBuffer *)FREELIST_POINTER(h);
     result_code = buffer->checkout_write(write_offset, bytes_needed);
@@ -419,27 +484,32 @@ LogObject::_checkout_write(size_t *write_offset, size_t bytes_needed)
       INK_WRITE_MEMORY_BARRIER;
       head_p old_h;
       do {
-        INK_QUEUE_LD(old_h, m_log_buffer);
+        INK_QUEUE_LD(old_h, *slot);
         if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h)) {
           ink_atomic_increment(&buffer->m_references, -1);
 
           // another thread should be taking care of creating a new
           // buffer, so delete new_buffer and try again
           delete new_buffer;
+          ++contention;
           break;
         }
         head_p tmp_h;
         SET_FREELIST_POINTER_VERSION(tmp_h, new_buffer, 0);
 #if TS_HAS_128BIT_CAS
-        result = ink_atomic_cas((__int128_t *)&m_log_buffer.data, old_h.data, tmp_h.data);
+        result = ink_atomic_cas((__int128_t *)&slot->data, old_h.data, tmp_h.data);
 #else
-        result = ink_atomic_cas((int64_t *)&m_log_buffer.data, old_h.data, tmp_h.data);
+        result = ink_atomic_cas((int64_t *)&slot->data, old_h.data, tmp_h.data);
 #endif
       } while (!result);
       if (FREELIST_POINTER(old_h) == FREELIST_POINTER(h)) {
         ink_atomic_increment(&buffer->m_references, FREELIST_VERSION(old_h) - 1);
+        ink_atomic_increment(write_offset ? &m_buffers_full : &m_buffers_forced, 1);
 
-        int idx = m_buffer_manager_idx++ % m_flush_threads;
+        // buffers from a thread's own slot always go to the same flush
+        // queue, so that its entries are flushed in the order written
+        int idx = slot == &m_log_buffer ? m_buffer_manager_idx++ % m_flush_threads :
+                                          ((LogThreadBuffer *)slot - m_thread_buffers) % m_flush_threads;
         Debug("log-logbuffer", "adding buffer %d to flush list after checkout", buffer->get_id());
         m_buffer_manager[idx].add_to_flush_queue(buffer);
         Log::preproc_notify[idx].signal();
@@ -451,6 +521,7 @@ LogObject::_checkout_write(size_t *write_offset, size_t bytes_needed)
       // no more room, but another thread should be taking care of
       // creating a new buffer, so try again
       //
+      ++contention;
       break;
 
     case LogBuffer::LB_BUFFER_TOO_SMALL:
@@ -467,15 +538,15 @@ LogObject::_checkout_write(size_t *write_offset, size_t bytes_needed)
     if (!decremented) {
       head_p old_h;
       do {
-        INK_QUEUE_LD(old_h, m_log_buffer);
+        INK_QUEUE_LD(old_h, *slot);
         if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h))
           break;
         head_p tmp_h;
         SET_FREELIST_POINTER_VERSION(tmp_h, FREELIST_POINTER(h), FREELIST_VERSION(old_h) - 1);
 #if TS_HAS_128BIT_CAS
-        result = ink_atomic_cas((__int128_t *)&m_log_buffer.data, old_h.data, tmp_h.data);
+        result = ink_atomic_cas((__int128_t *)&slot->data, old_h.data, tmp_h.data);
 #else
-        result = ink_atomic_cas((int64_t *)&m_log_buffer.data, old_h.data, tmp_h.data);
+        result = ink_atomic_cas((int64_t *)&slot->data, old_h.data, tmp_h.data);
 #endif
       } while (!result);
       if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h))
@@ -485,6 +556,10 @@ LogObject::_checkout_write(size_t *write_offset, size_t bytes_needed)
   // not retry because we really do
   // not want to write to the buffer
   // only to set it as full
+  if (unlikely(contention)) {
+    ink_atomic_increment(&m_checkout_contention, contention);
+    RecIncrGlobalRawStat(log_rsb, log_stat_buffer_checkout_contention_stat, contention);
+  }
   if (result_code == LogBuffer::LB_BUFFER_TOO_SMALL) {
     buffer = NULL;
   }
@@ -598,7 +673,7 @@ LogObject::log(LogAccess *lad, const char *text_entry)
   }
 
   // Now try to place this entry in the current LogBuffer.
-  buffer = _checkout_write(&offset, bytes_needed);
+  buffer = _checkout_write(_thread_slot(), &offset, bytes_needed);
 
   if (!buffer) {
     Note("Skipping the current log entry for %s because its size (%zu) exceeds "
@@ -787,7 +862,26 @@ LogObject::check_buffer_expiration(long time_now)
 {
   LogBuffer *b = (LogBuffer *)FREELIST_POINTER(m_log_buffer);
   if (b && time_now > b->expiration_time()) {
-    force_new_buffer();
+    _checkout_write(&m_log_buffer, NULL, 0);
+  }
+
+  for (int i = 0, n = log_thread_slots(); i < n; i++) {
+    b = (LogBuffer *)FREELIST_POINTER(m_thread_buffers[i].buffer);
+    if (b && time_now > b->expiration_time()) {
+      _checkout_write(&m_thread_buffers[i].buffer, NULL, 0);
+    }
+  }
+}
+
+void
+LogObject::force_new_buffer()
+{
+  _checkout_write(&m_log_buffer, NULL, 0);
+
+  for (int i = 0, n = log_thread_slots(); i < n; i++) {
+    if (FREELIST_POINTER(m_thread_buffers[i].buffer)) {
+      _checkout_write(&m_thread_buffers[i].buffer, NULL, 0);
+    }
   }
 }
 
@@ -56,6 +56,10 @@
 
 #define LOG_OBJECT_ARRAY_DELTA 8
 
+// the number of threads that get a work buffer of their own in each
+// LogObject; any further threads share the object's common buffer
+#define LOG_OBJECT_MAX_THREAD_BUFFERS 256
+
 #define ACQUIRE_API_MUTEX(_f)   \
   ink_mutex_acquire(_APImutex); \
   Debug("log-api-mutex", _f)
@@ -83,6 +87,21 @@ public:
   size_t preproc_buffers(LogBufferSink *sink);
 };
 
+/*-------------------------------------------------------------------------
+  LogThreadBuffer
+
+  A per-thread work buffer slot.  Each logging thread checks its entries
+  out of its own slot, so the reference counting CAS in _checkout_write
+  only races with the periodic expiration check, not with other writers.
+  Slots are padded to a cache line so that neighbouring threads do not
+  share one.
+  -------------------------------------------------------------------------*/
+
+struct LogThreadBuffer {
+  volatile head_p buffer;
+  char pad[64 - sizeof(head_p)];
+};
+
 // LogObject is atomically reference counted, and the reference count is always owned by
 // one or more LogObjectManagers.
 class LogObject : public RefCountObj
@@ -259,11 +278,7 @@ public:
     return (m_format ? m_format->format_string() : "<none>");
   }
 
-  void
-  force_new_buffer()
-  {
-    _checkout_write(NULL, 0);
-  }
+  void force_new_buffer();
 
   bool operator==(LogObject &rhs);
   int do_filesystem_checks();
@@ -298,16 +313,24 @@ private:
   long m_last_roll_time;   // the last time this object rolled
   // its files
 
-  volatile head_p m_log_buffer; // current work buffer
+  volatile head_p m_log_buffer;      // shared work buffer, for threads without a slot
+  LogThreadBuffer *m_thread_buffers; // per-thread work buffers
   unsigned m_buffer_manager_idx;
   LogBufferManager *m_buffer_manager;
 
+  // flush statistics (see display())
+  volatile int64_t m_buffers_full;        // buffers flushed because they filled up
+  volatile int64_t m_buffers_forced;      // buffers flushed on expiration or on demand
+  volatile int64_t m_checkout_contention; // checkouts that raced with another thread
+
   void generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format);
   void _setup_rolling(Log::RollingEnabledValues rolling_enabled, int rolling_interval_sec, int rolling_offset_hr,
                       int rolling_size_mb);
   unsigned _roll_files(long interval_start, long interval_end);
 
-  LogBuffer *_checkout_write(size_t *write_offset, size_t write_size);
+  void _init_buffers();
+  volatile head_p *_thread_slot();
+  LogBuffer *_checkout_write(volatile head_p *slot, size_t *write_offset, size_t write_size);
 
 private:
   // -- member functions not allowed --
@@ -32,6 +32,7 @@
 #include "LogStandalone.cc"
 
 #include "LogObject.h"
+#include "LogColumnar.h"
 #include "hdrs/HTTP.h"
 
 #include <math.h>
@@ -1669,7 +1670,7 @@ process_file(int in_fd, off_t offset, unsigned max_age)
     }
 
     Debug("logstats", "LogBuffer version %d, current = %d", header->version, LOG_SEGMENT_VERSION);
-    if (header->version != LOG_SEGMENT_VERSION)
+    if (header->version != LOG_SEGMENT_VERSION && !LogColumnar::is_columnar(header))
       return 1;
 
     // read the rest of the header
@@ -1722,10 +1723,20 @@ process_file(int in_fd, off_t offset, unsigned max_age)
 
     // Possibly skip too old entries (the entire buffer is skipped)
     if (header->high_timestamp >= max_age) {
-      if (parse_log_buff(header, cl.summary != 0) != 0) {
+      LogBufferHeader *rows = NULL;
+      if (LogColumnar::is_columnar(header)) {
+        static LogColumnar columnar;
+        if (!(rows = columnar.decode(header))) {
+          Debug("logstats", "Failed to decode columnar log buffer.");
+          return 1;
+        }
+      }
+      if (parse_log_buff(rows ? rows : header, cl.summary != 0) != 0) {
         Debug("logstats", "Failed to parse log buffer.");
+        LogColumnar::free_segment(rows);
         return 1;
       }
+      LogColumnar::free_segment(rows);
     } else {
       Debug("logstats", "Skipping old buffer (age=%d, max=%d)", header->high_timestamp, max_age);
     }